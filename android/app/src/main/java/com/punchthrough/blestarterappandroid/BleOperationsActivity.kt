@@ -221,7 +221,7 @@ class BleOperationsActivity : AppCompatActivity() {
         onCharacteristicChanged = { _, characteristic, value -> // Handle notifications here
             when (characteristic.uuid) {
                 distanceCharacteristicUUID -> {
-                    val distance = value.toInt() // Assuming the value is in the correct format
+                    val distance = value.toIntLittleEndian() / 10 // Firmware sends mm
                     runOnUiThread {
                         binding.distanceLabel.text = "Distance: $distance cm"
                         updateRadarView()
@@ -265,6 +265,10 @@ class BleOperationsActivity : AppCompatActivity() {
         return this.toHexString().toInt(16)
     }
 
+    // Decode an unsigned little endian integer, as sent by the firmware
+    private fun ByteArray.toIntLittleEndian(): Int =
+        foldRight(0) { byte, acc -> (acc shl 8) or (byte.toInt() and 0xFF) }
+
     // Add helper method to update RadarView
     private fun updateRadarView() {
         val angle = binding.angleLabel.text.toString()
@@ -0,0 +1,533 @@
+#include "bluez_transport.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <systemd/sd-bus.h>
+
+namespace radar {
+
+namespace {
+
+constexpr char PREFIX[] = "ble:";
+constexpr size_t PREFIX_LENGTH = sizeof(PREFIX) - 1;
+/* AA:BB:CC:DD:EE:FF */
+constexpr size_t ADDRESS_LENGTH = 17;
+
+constexpr char BLUEZ[] = "org.bluez";
+constexpr char DEVICE_INTERFACE[] = "org.bluez.Device1";
+constexpr char CHARACTERISTIC_INTERFACE[] = "org.bluez.GattCharacteristic1";
+constexpr char PROPERTIES_INTERFACE[] = "org.freedesktop.DBus.Properties";
+
+/* BlueZ resolves the services after connecting, they are looked for again
+ * this often until they show */
+constexpr auto RESOLVE_PERIOD = std::chrono::milliseconds(500);
+constexpr unsigned RESOLVE_ATTEMPTS = 20;
+
+uint64_t monotonic_us()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+uint32_t poll_to_epoll(int events)
+{
+    // POLLIN and POLLOUT have the values of EPOLLIN and EPOLLOUT
+    return static_cast<uint32_t>(events) & (EPOLLIN | EPOLLOUT);
+}
+
+}
+
+/**
+ * Link to a radar paired with BlueZ.
+ *
+ * Replies and signals may outlive the session, they reach it through an
+ * anchor cleared when it goes.
+ */
+class BluezSession : public Session {
+public:
+    BluezSession(BluezTransport &transport, const char *address, SessionHandler &handler) :
+        _transport(transport),
+        _address(address),
+        _handler(handler),
+        _anchor(std::make_shared<Anchor>(Anchor{this}))
+    {
+        // /org/bluez/hci0/dev_AA_BB_CC_DD_EE_FF
+        _device_path = "/org/bluez/" + _transport._adapter + "/dev_" + std::string(address + PREFIX_LENGTH);
+        for (size_t i = _device_path.size() - ADDRESS_LENGTH; i < _device_path.size(); ++i) {
+            if (_device_path[i] == ':') {
+                _device_path[i] = '_';
+            }
+        }
+    }
+
+    ~BluezSession() override
+    {
+        _anchor->session = nullptr;
+        if (_resolve) {
+            _transport._loop.cancel(_resolve);
+        }
+        sd_bus_slot_unref(_signals);
+    }
+
+    void connect() override
+    {
+        if (_state != State::Idle) {
+            return;
+        }
+        if (!_signals && !watch()) {
+            fail();
+            return;
+        }
+        _state = State::Connecting;
+        _attempts = 0;
+        sd_bus_message *message = request(_device_path.c_str(), DEVICE_INTERFACE, "Connect");
+        if (!call(message, &BluezSession::on_connect_reply)) {
+            fail();
+        }
+    }
+
+    bool connected() const override
+    {
+        return _state == State::Connected;
+    }
+
+    bool subscribe(const protocol::Uuid &uuid) override
+    {
+        const char *path = characteristic(uuid);
+        return path && call(request(path, CHARACTERISTIC_INTERFACE, "StartNotify"), &BluezSession::on_reply);
+    }
+
+    bool write(const protocol::Uuid &uuid, const uint8_t *data, size_t size) override
+    {
+        const char *path = characteristic(uuid);
+        sd_bus_message *message = path ? request(path, CHARACTERISTIC_INTERFACE, "WriteValue") : nullptr;
+        if (!message || sd_bus_message_append_array(message, 'y', data, size) < 0 ||
+            !append_no_options(message)) {
+            sd_bus_message_unref(message);
+            return false;
+        }
+        return call(message, &BluezSession::on_reply);
+    }
+
+    bool read(const protocol::Uuid &uuid) override
+    {
+        const char *path = characteristic(uuid);
+        sd_bus_message *message = path ? request(path, CHARACTERISTIC_INTERFACE, "ReadValue") : nullptr;
+        if (!message || !append_no_options(message)) {
+            sd_bus_message_unref(message);
+            return false;
+        }
+        return call(message, &BluezSession::on_read_reply, uuid);
+    }
+
+    const char *address() const override
+    {
+        return _address.c_str();
+    }
+
+private:
+    enum class State {
+        Idle,
+        Connecting,     /* Device1.Connect() sent */
+        Resolving,      /* connected, waiting for the characteristics */
+        Connected,
+    };
+
+    struct Anchor {
+        BluezSession *session;
+    };
+
+    using Reply = int (BluezSession::*)(sd_bus_message *reply, const protocol::Uuid &uuid);
+
+    /**
+     * Userdata of a call in flight.
+     */
+    struct Call {
+        std::shared_ptr<Anchor> anchor;
+        Reply reply;
+        protocol::Uuid uuid;
+    };
+
+    struct Characteristic {
+        protocol::Uuid uuid;
+        std::string path;
+    };
+
+    static int dispatch(sd_bus_message *reply, void *userdata, sd_bus_error *)
+    {
+        Call *call = static_cast<Call *>(userdata);
+        BluezSession *session = call->anchor->session;
+        return session ? (session->*call->reply)(reply, call->uuid) : 0;
+    }
+
+    static int dispatch_signal(sd_bus_message *message, void *userdata, sd_bus_error *)
+    {
+        BluezSession *session = static_cast<std::shared_ptr<Anchor> *>(userdata)->get()->session;
+        return session ? session->on_properties_changed(message) : 0;
+    }
+
+    sd_bus_message *request(const char *path, const char *interface, const char *member)
+    {
+        sd_bus_message *message = nullptr;
+        if (sd_bus_message_new_method_call(_transport._bus, &message, BLUEZ, path, interface, member) < 0) {
+            return nullptr;
+        }
+        return message;
+    }
+
+    static bool append_no_options(sd_bus_message *message)
+    {
+        return sd_bus_message_open_container(message, 'a', "{sv}") >= 0 &&
+               sd_bus_message_close_container(message) >= 0;
+    }
+
+    /**
+     * Send message, taking it over, the reply goes to the member.
+     */
+    bool call(sd_bus_message *message, Reply reply, const protocol::Uuid &uuid = protocol::Uuid{})
+    {
+        if (!message) {
+            return false;
+        }
+        sd_bus_slot *slot = nullptr;
+        Call *userdata = new Call{_anchor, reply, uuid};
+        int result = sd_bus_call_async(_transport._bus, &slot, message, dispatch, userdata, 0);
+        sd_bus_message_unref(message);
+        if (result < 0) {
+            delete userdata;
+            return false;
+        }
+        // Owned by the bus until the reply, which frees the userdata
+        sd_bus_slot_set_destroy_callback(slot, [](void *userdata) { delete static_cast<Call *>(userdata); });
+        sd_bus_slot_set_floating(slot, 1);
+        sd_bus_slot_unref(slot);
+        _transport.kick();
+        return true;
+    }
+
+    /**
+     * Listen to the property changes of the device and its attributes.
+     */
+    bool watch()
+    {
+        std::string rule = "type='signal',sender='org.bluez',interface='org.freedesktop.DBus.Properties',"
+                           "member='PropertiesChanged',path_namespace='" + _device_path + "'";
+        std::shared_ptr<Anchor> *userdata = new std::shared_ptr<Anchor>(_anchor);
+        if (sd_bus_add_match(_transport._bus, &_signals, rule.c_str(), dispatch_signal, userdata) < 0) {
+            delete userdata;
+            _signals = nullptr;
+            return false;
+        }
+        sd_bus_slot_set_destroy_callback(_signals, [](void *userdata) {
+            delete static_cast<std::shared_ptr<Anchor> *>(userdata);
+        });
+        _transport.kick();
+        return true;
+    }
+
+    const char *characteristic(const protocol::Uuid &uuid) const
+    {
+        if (_state != State::Connected) {
+            return nullptr;
+        }
+        for (const Characteristic &characteristic : _characteristics) {
+            if (characteristic.uuid == uuid) {
+                return characteristic.path.c_str();
+            }
+        }
+        return nullptr;
+    }
+
+    void fail()
+    {
+        if (_resolve) {
+            _transport._loop.cancel(_resolve);
+            _resolve = 0;
+        }
+        _state = State::Idle;
+        _characteristics.clear();
+        _handler.on_disconnected(*this);
+    }
+
+    void resolve()
+    {
+        sd_bus_message *message = nullptr;
+        if (sd_bus_message_new_method_call(_transport._bus, &message, BLUEZ, "/", "org.freedesktop.DBus.ObjectManager",
+                                           "GetManagedObjects") < 0 ||
+            !call(message, &BluezSession::on_objects_reply)) {
+            fail();
+        }
+    }
+
+    int on_reply(sd_bus_message *reply, const protocol::Uuid &)
+    {
+        if (sd_bus_message_is_method_error(reply, nullptr)) {
+            fprintf(stderr, "%s: %s\r\n", _address.c_str(), sd_bus_message_get_error(reply)->message);
+        }
+        return 0;
+    }
+
+    int on_connect_reply(sd_bus_message *reply, const protocol::Uuid &)
+    {
+        if (_state != State::Connecting) {
+            return 0;
+        }
+        if (sd_bus_message_is_method_error(reply, nullptr)) {
+            fprintf(stderr, "%s: %s\r\n", _address.c_str(), sd_bus_message_get_error(reply)->message);
+            fail();
+            return 0;
+        }
+        _state = State::Resolving;
+        resolve();
+        return 0;
+    }
+
+    /**
+     * Characteristics of the device among the objects of BlueZ,
+     * a{oa{sa{sv}}}.
+     */
+    int on_objects_reply(sd_bus_message *reply, const protocol::Uuid &)
+    {
+        if (_state != State::Resolving) {
+            return 0;
+        }
+        std::vector<Characteristic> found;
+        bool parsed = !sd_bus_message_is_method_error(reply, nullptr) &&
+                      sd_bus_message_enter_container(reply, 'a', "{oa{sa{sv}}}") >= 0;
+        while (parsed && sd_bus_message_enter_container(reply, 'e', "oa{sa{sv}}") > 0) {
+            const char *path;
+            parsed = sd_bus_message_read(reply, "o", &path) >= 0 &&
+                     sd_bus_message_enter_container(reply, 'a', "{sa{sv}}") >= 0;
+            bool ours = parsed && !strncmp(path, _device_path.c_str(), _device_path.size()) &&
+                        path[_device_path.size()] == '/';
+            while (parsed && sd_bus_message_enter_container(reply, 'e', "sa{sv}") > 0) {
+                const char *interface;
+                parsed = sd_bus_message_read(reply, "s", &interface) >= 0;
+                if (parsed && ours && !strcmp(interface, CHARACTERISTIC_INTERFACE)) {
+                    const char *uuid = nullptr;
+                    parsed = read_uuid(reply, uuid);
+                    if (parsed && uuid) {
+                        found.push_back({protocol::parse_uuid(uuid), path});
+                    }
+                } else if (parsed) {
+                    parsed = sd_bus_message_skip(reply, "a{sv}") >= 0;
+                }
+                parsed = parsed && sd_bus_message_exit_container(reply) >= 0;
+            }
+            parsed = parsed && sd_bus_message_exit_container(reply) >= 0 &&
+                     sd_bus_message_exit_container(reply) >= 0;
+        }
+        if (!parsed) {
+            fail();
+            return 0;
+        }
+
+        if (found.empty()) {
+            if (++_attempts >= RESOLVE_ATTEMPTS) {
+                fprintf(stderr, "%s: no characteristics\r\n", _address.c_str());
+                fail();
+            } else {
+                _resolve = _transport._loop.call_in(RESOLVE_PERIOD, [this]() {
+                    _resolve = 0;
+                    resolve();
+                });
+            }
+            return 0;
+        }
+        _characteristics = std::move(found);
+        _state = State::Connected;
+        _handler.on_connected(*this);
+        return 0;
+    }
+
+    /**
+     * UUID property of a characteristic, a{sv}.
+     */
+    static bool read_uuid(sd_bus_message *message, const char *&uuid)
+    {
+        if (sd_bus_message_enter_container(message, 'a', "{sv}") < 0) {
+            return false;
+        }
+        while (sd_bus_message_enter_container(message, 'e', "sv") > 0) {
+            const char *key;
+            if (sd_bus_message_read(message, "s", &key) < 0) {
+                return false;
+            }
+            if (!strcmp(key, "UUID")) {
+                if (sd_bus_message_read(message, "v", "s", &uuid) < 0) {
+                    return false;
+                }
+            } else if (sd_bus_message_skip(message, "v") < 0) {
+                return false;
+            }
+            if (sd_bus_message_exit_container(message) < 0) {
+                return false;
+            }
+        }
+        return sd_bus_message_exit_container(message) >= 0;
+    }
+
+    int on_read_reply(sd_bus_message *reply, const protocol::Uuid &uuid)
+    {
+        const void *data;
+        size_t size;
+        if (_state != State::Connected) {
+            return 0;
+        }
+        if (sd_bus_message_is_method_error(reply, nullptr) ||
+            sd_bus_message_read_array(reply, 'y', &data, &size) < 0) {
+            return on_reply(reply, uuid);
+        }
+        _handler.on_value(*this, uuid, static_cast<const uint8_t *>(data), size, true);
+        return 0;
+    }
+
+    /**
+     * PropertiesChanged(s interface, a{sv} changed, as invalidated) of the
+     * device or one of its characteristics.
+     */
+    int on_properties_changed(sd_bus_message *message)
+    {
+        const char *interface;
+        if (_state == State::Idle || sd_bus_message_read(message, "s", &interface) < 0 ||
+            sd_bus_message_enter_container(message, 'a', "{sv}") < 0) {
+            return 0;
+        }
+        bool device = !strcmp(interface, DEVICE_INTERFACE);
+        bool value = !strcmp(interface, CHARACTERISTIC_INTERFACE) && _state == State::Connected;
+        const char *path = sd_bus_message_get_path(message);
+
+        while (sd_bus_message_enter_container(message, 'e', "sv") > 0) {
+            const char *key;
+            if (sd_bus_message_read(message, "s", &key) < 0) {
+                return 0;
+            }
+            if (device && !strcmp(key, "Connected")) {
+                int connected = 1;
+                if (sd_bus_message_read(message, "v", "b", &connected) < 0) {
+                    return 0;
+                }
+                if (!connected) {
+                    fail();
+                    return 0;
+                }
+            } else if (value && !strcmp(key, "Value")) {
+                const void *data;
+                size_t size;
+                if (sd_bus_message_enter_container(message, 'v', "ay") < 0 ||
+                    sd_bus_message_read_array(message, 'y', &data, &size) < 0 ||
+                    sd_bus_message_exit_container(message) < 0) {
+                    return 0;
+                }
+                for (const Characteristic &characteristic : _characteristics) {
+                    if (characteristic.path == path) {
+                        _handler.on_value(*this, characteristic.uuid, static_cast<const uint8_t *>(data), size,
+                                          false);
+                        break;
+                    }
+                }
+            } else if (sd_bus_message_skip(message, "v") < 0) {
+                return 0;
+            }
+            if (sd_bus_message_exit_container(message) < 0) {
+                return 0;
+            }
+        }
+        return 0;
+    }
+
+    BluezTransport &_transport;
+    std::string _address;
+    SessionHandler &_handler;
+    std::shared_ptr<Anchor> _anchor;
+    std::string _device_path;
+    State _state = State::Idle;
+    std::vector<Characteristic> _characteristics;
+    /* PropertiesChanged match */
+    sd_bus_slot *_signals = nullptr;
+    /* scheduled resolve(), 0 if none */
+    int _resolve = 0;
+    unsigned _attempts = 0;
+};
+
+BluezTransport::BluezTransport(EventLoop &loop, const char *adapter) :
+    _loop(loop),
+    _adapter(adapter)
+{
+    if (sd_bus_open_system(&_bus) < 0) {
+        _bus = nullptr;
+        return;
+    }
+    _fd = sd_bus_get_fd(_bus);
+    _loop.add(_fd, poll_to_epoll(sd_bus_get_events(_bus)), [this](uint32_t) { process(); });
+}
+
+BluezTransport::~BluezTransport()
+{
+    if (!_bus) {
+        return;
+    }
+    if (_timer) {
+        _loop.cancel(_timer);
+    }
+    _loop.remove(_fd);
+    sd_bus_flush_close_unref(_bus);
+}
+
+bool BluezTransport::accepts(const char *address) const
+{
+    return !strncmp(address, PREFIX, PREFIX_LENGTH);
+}
+
+std::unique_ptr<Session> BluezTransport::open(const char *address, SessionHandler &handler)
+{
+    if (!_bus || !accepts(address) || strlen(address + PREFIX_LENGTH) != ADDRESS_LENGTH) {
+        return nullptr;
+    }
+    return std::unique_ptr<Session>(new BluezSession(*this, address, handler));
+}
+
+void BluezTransport::kick()
+{
+    if (_kicked) {
+        return;
+    }
+    if (_timer) {
+        _loop.cancel(_timer);
+    }
+    _kicked = true;
+    _timer = _loop.call_in(EventLoop::clock::duration::zero(), [this]() {
+        _timer = 0;
+        process();
+    });
+}
+
+void BluezTransport::process()
+{
+    _kicked = false;
+    while (sd_bus_process(_bus, nullptr) > 0) {
+    }
+
+    // Watch for what the bus waits on now
+    _loop.modify(_fd, poll_to_epoll(sd_bus_get_events(_bus)));
+    if (_timer) {
+        _loop.cancel(_timer);
+        _timer = 0;
+    }
+    uint64_t timeout_us;
+    if (sd_bus_get_timeout(_bus, &timeout_us) >= 0 && timeout_us != UINT64_MAX) {
+        uint64_t now_us = monotonic_us();
+        auto delay = std::chrono::microseconds(timeout_us > now_us ? timeout_us - now_us : 0);
+        _timer = _loop.call_in(delay, [this]() {
+            _timer = 0;
+            process();
+        });
+    }
+}
+
+}
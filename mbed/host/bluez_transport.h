@@ -0,0 +1,66 @@
+/*
+ * Transport to radars over Bluetooth LE, through BlueZ on the system bus.
+ */
+#ifndef RADAR_HOST_BLUEZ_TRANSPORT_H
+#define RADAR_HOST_BLUEZ_TRANSPORT_H
+
+#include <string>
+
+#include "event_loop.h"
+#include "transport.h"
+
+struct sd_bus;
+
+namespace radar {
+
+/**
+ * Sessions to radars addressed ble:AA:BB:CC:DD:EE:FF, paired beforehand
+ * (bluetoothctl).
+ *
+ * Every session shares one connection to the system bus, served by the
+ * event loop: BlueZ keeps the links and the GATT discovery, the sessions
+ * call org.bluez.Device1 and org.bluez.GattCharacteristic1 and receive the
+ * notifications as PropertiesChanged signals of the Value property.
+ */
+class BluezTransport : public Transport {
+public:
+    /**
+     * @param adapter controller the radars are paired with.
+     */
+    explicit BluezTransport(EventLoop &loop, const char *adapter = "hci0");
+    BluezTransport(const BluezTransport &) = delete;
+    BluezTransport &operator=(const BluezTransport &) = delete;
+    ~BluezTransport() override;
+
+    /**
+     * Whether the system bus could be reached.
+     */
+    bool ready() const
+    {
+        return _bus != nullptr;
+    }
+
+    bool accepts(const char *address) const override;
+    std::unique_ptr<Session> open(const char *address, SessionHandler &handler) override;
+
+private:
+    friend class BluezSession;
+
+    /**
+     * Run the bus soon, after a session queued a call.
+     */
+    void kick();
+    void process();
+
+    EventLoop &_loop;
+    std::string _adapter;
+    sd_bus *_bus = nullptr;
+    int _fd = -1;
+    /* call_in() of the next bus timeout or kick(), 0 if none */
+    int _timer = 0;
+    bool _kicked = false;
+};
+
+}
+
+#endif // RADAR_HOST_BLUEZ_TRANSPORT_H
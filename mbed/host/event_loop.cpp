@@ -0,0 +1,133 @@
+#include "event_loop.h"
+
+#include <cerrno>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace radar {
+
+namespace {
+
+/* Events handled per epoll_wait(), more wait for the next round */
+constexpr int MAX_EVENTS = 64;
+
+}
+
+EventLoop::EventLoop()
+{
+    _epoll = epoll_create1(EPOLL_CLOEXEC);
+    _wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    add(_wakeup, EPOLLIN, [this](uint32_t) {
+        uint64_t count;
+        while (read(_wakeup, &count, sizeof(count)) > 0) {
+        }
+        _stopped = true;
+    });
+}
+
+EventLoop::~EventLoop()
+{
+    close(_wakeup);
+    close(_epoll);
+}
+
+bool EventLoop::add(int fd, uint32_t events, FdCallback callback)
+{
+    epoll_event event = {};
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &event) != 0) {
+        return false;
+    }
+    _callbacks[fd] = std::make_shared<FdCallback>(std::move(callback));
+    return true;
+}
+
+bool EventLoop::modify(int fd, uint32_t events)
+{
+    epoll_event event = {};
+    event.events = events;
+    event.data.fd = fd;
+    return epoll_ctl(_epoll, EPOLL_CTL_MOD, fd, &event) == 0;
+}
+
+void EventLoop::remove(int fd)
+{
+    epoll_ctl(_epoll, EPOLL_CTL_DEL, fd, nullptr);
+    _callbacks.erase(fd);
+}
+
+int EventLoop::call_in(clock::duration delay, std::function<void()> fn)
+{
+    int id = _next_timer_id++;
+    _timers.emplace(clock::now() + delay, Timer{id, std::move(fn)});
+    return id;
+}
+
+void EventLoop::cancel(int id)
+{
+    for (auto it = _timers.begin(); it != _timers.end(); ++it) {
+        if (it->second.id == id) {
+            _timers.erase(it);
+            return;
+        }
+    }
+}
+
+void EventLoop::run(clock::time_point deadline)
+{
+    _stopped = false;
+    epoll_event events[MAX_EVENTS];
+    while (!_stopped) {
+        run_timers();
+        clock::time_point now = clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        clock::time_point wake = deadline;
+        if (!_timers.empty() && _timers.begin()->first < wake) {
+            wake = _timers.begin()->first;
+        }
+        int timeout = -1;
+        if (wake != clock::time_point::max()) {
+            // Rounded up, a timer is never run early
+            auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(wake - now + std::chrono::microseconds(999));
+            timeout = static_cast<int>(delay.count());
+        }
+        int ready = epoll_wait(_epoll, events, MAX_EVENTS, timeout);
+        if (ready < 0 && errno != EINTR) {
+            break;
+        }
+        for (int i = 0; i < ready; ++i) {
+            auto callback = _callbacks.find(events[i].data.fd);
+            if (callback == _callbacks.end()) {
+                // Removed by an earlier callback of the round
+                continue;
+            }
+            // Kept alive should the callback remove its own fd
+            std::shared_ptr<FdCallback> keep = callback->second;
+            (*keep)(events[i].events);
+        }
+    }
+}
+
+void EventLoop::stop()
+{
+    uint64_t one = 1;
+    ssize_t written = write(_wakeup, &one, sizeof(one));
+    (void)written;
+}
+
+void EventLoop::run_timers()
+{
+    clock::time_point now = clock::now();
+    while (!_timers.empty() && _timers.begin()->first <= now) {
+        std::function<void()> fn = std::move(_timers.begin()->second.fn);
+        _timers.erase(_timers.begin());
+        fn();
+    }
+}
+
+}
@@ -0,0 +1,88 @@
+/*
+ * Single threaded event loop of the gateway, the sessions of every radar
+ * served from one epoll set.
+ */
+#ifndef RADAR_HOST_EVENT_LOOP_H
+#define RADAR_HOST_EVENT_LOOP_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+namespace radar {
+
+/**
+ * Calls back on file descriptor readiness and after delays.
+ *
+ * Everything but stop() runs on the thread of run(), callbacks included,
+ * so that the sessions need no locking. Callbacks may add and remove file
+ * descriptors and timers, their own included.
+ */
+class EventLoop {
+public:
+    using clock = std::chrono::steady_clock;
+    /* epoll events that occurred */
+    using FdCallback = std::function<void(uint32_t events)>;
+
+    EventLoop();
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+    ~EventLoop();
+
+    /**
+     * Watch fd for events (EPOLLIN, EPOLLOUT...), level triggered.
+     */
+    bool add(int fd, uint32_t events, FdCallback callback);
+
+    /**
+     * Change the events watched on fd.
+     */
+    bool modify(int fd, uint32_t events);
+
+    /**
+     * Stop watching fd, before closing it.
+     */
+    void remove(int fd);
+
+    /**
+     * Call fn once after delay.
+     *
+     * @return id for cancel().
+     */
+    int call_in(clock::duration delay, std::function<void()> fn);
+
+    void cancel(int id);
+
+    /**
+     * Run until stop(), or until the deadline when given.
+     */
+    void run(clock::time_point deadline = clock::time_point::max());
+
+    /**
+     * Make run() return, from any thread or a signal handler.
+     */
+    void stop();
+
+private:
+    struct Timer {
+        int id;
+        std::function<void()> fn;
+    };
+
+    void run_timers();
+
+    int _epoll = -1;
+    /* written by stop() */
+    int _wakeup = -1;
+    std::unordered_map<int, std::shared_ptr<FdCallback>> _callbacks;
+    std::multimap<clock::time_point, Timer> _timers;
+    int _next_timer_id = 1;
+    bool _stopped = false;
+};
+
+}
+
+#endif // RADAR_HOST_EVENT_LOOP_H
@@ -0,0 +1,437 @@
+#include "gateway.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace radar {
+
+using namespace protocol;
+
+namespace {
+
+/* Values are handed to the workers at most this late, waking them once for
+ * all the values of the meantime rather than once per value */
+constexpr auto FLUSH_DELAY = std::chrono::milliseconds(2);
+/* Times the loop lets a worker run before dropping a value for its full
+ * queue, which also lets a worker share the core of the loop */
+constexpr unsigned FULL_QUEUE_YIELDS = 64;
+/* Wait before reconnecting a device, doubled on every failure */
+constexpr auto FIRST_BACKOFF = std::chrono::milliseconds(250);
+constexpr auto MAX_BACKOFF = std::chrono::seconds(8);
+
+int64_t steady_us()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        EventLoop::clock::now().time_since_epoch()
+    ).count();
+}
+
+bool apply_sweep_frame(DeviceState &state, const uint8_t *data, size_t size)
+{
+    SweepFrameView frame;
+    if (!decode(SWEEP_FRAME, data, size, frame)) {
+        return false;
+    }
+    uint16_t sequence = frame.header().sequence;
+    if (state.sequenced) {
+        state.missed_frames += static_cast<uint16_t>(sequence - state.sequence - 1);
+    }
+    state.sequence = sequence;
+    state.sequenced = true;
+    ++state.frames;
+    state.samples += frame.size();
+    for (const SweepSample &sample : frame) {
+        if (sample.angle < SCENE_BINS) {
+            state.ranges_mm[sample.angle] = sample.distance;
+        }
+    }
+    return true;
+}
+
+bool apply_polar_map(DeviceState &state, const uint8_t *data, size_t size)
+{
+    PolarMapView map;
+    if (!decode(POLAR_MAP, data, size, map)) {
+        return false;
+    }
+    size_t bins = std::min(map.size(), SCENE_BINS);
+    for (size_t i = 0; i < bins; ++i) {
+        state.ranges_mm[i] = map[i].known() ? map[i].distance_mm() : 0;
+    }
+    return true;
+}
+
+bool apply_objects(DeviceState &state, const uint8_t *data, size_t size)
+{
+    ObjectListView objects;
+    if (!decode(OBJECTS, data, size, objects)) {
+        return false;
+    }
+    state.objects_header = objects.header();
+    state.objects.assign(objects.begin(), objects.end());
+    return true;
+}
+
+bool apply_tracks(DeviceState &state, const uint8_t *data, size_t size)
+{
+    TrackListView tracks;
+    if (!decode(TRACKS, data, size, tracks)) {
+        return false;
+    }
+    state.tracks_header = tracks.header();
+    state.tracks.assign(tracks.begin(), tracks.end());
+    return true;
+}
+
+bool apply_link(DeviceState &state, const uint8_t *data, size_t size)
+{
+    LinkStatusView link;
+    if (!decode(LINK, data, size, link)) {
+        return false;
+    }
+    state.link = link.value();
+    return true;
+}
+
+bool apply_buffer_stats(DeviceState &state, const uint8_t *data, size_t size)
+{
+    SampleBufferStatsView stats;
+    if (!decode(BUFFER_STATS, data, size, stats)) {
+        return false;
+    }
+    state.buffer_stats = stats.value();
+    return true;
+}
+
+/* How each characteristic updates the state of its device, in the order of
+ * SCHEMAS, nullptr for those the gateway leaves alone */
+bool (*const APPLY[])(DeviceState &, const uint8_t *, size_t) = {
+    nullptr,                // angle
+    nullptr,                // distance
+    nullptr,                // running
+    nullptr,                // threshold
+    apply_sweep_frame,
+    apply_buffer_stats,
+    nullptr,                // filter
+    nullptr,                // max range
+    nullptr,                // servo timing
+    apply_polar_map,
+    nullptr,                // background
+    apply_objects,
+    apply_tracks,
+    apply_link,
+    nullptr,                // trace
+    nullptr,                // profile
+    nullptr,                // calibration
+};
+
+static_assert(sizeof(APPLY) / sizeof(APPLY[0]) == SCHEMA_COUNT, "an entry per schema");
+
+/* Streams of every device, and what is read once on connection */
+const Schema *const SUBSCRIBED[] = {&SWEEP_FRAME, &OBJECTS, &TRACKS, &LINK, &BUFFER_STATS};
+const Schema *const READ_ON_CONNECTION[] = {&POLAR_MAP, &OBJECTS, &TRACKS, &LINK};
+
+/**
+ * Address made a file name.
+ */
+std::string file_name(const std::string &address)
+{
+    std::string name = address;
+    for (char &c : name) {
+        if (!isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '.') {
+            c = '_';
+        }
+    }
+    return name;
+}
+
+}
+
+Gateway::Gateway(EventLoop &loop, Scene &scene, const GatewayConfig &config) :
+    _loop(loop),
+    _scene(scene),
+    _config(config)
+{
+    for (size_t i = 0; i < SCHEMA_COUNT; ++i) {
+        _uuids[i] = parse_uuid(SCHEMAS[i].uuid);
+    }
+    _sweep_frame = std::find(_uuids, _uuids + SCHEMA_COUNT, parse_uuid(SWEEP_FRAME.uuid)) - _uuids;
+    if (!_config.workers) {
+        _config.workers = 1;
+    }
+}
+
+Gateway::~Gateway()
+{
+    stop();
+}
+
+void Gateway::add_transport(Transport &transport)
+{
+    _transports.push_back(&transport);
+}
+
+bool Gateway::add_device(const char *address)
+{
+    if (_started) {
+        return false;
+    }
+    for (Transport *transport : _transports) {
+        if (!transport->accepts(address)) {
+            continue;
+        }
+        std::unique_ptr<Session> session = transport->open(address, *this);
+        if (!session) {
+            return false;
+        }
+        _sessions[session.get()] = _devices.size();
+        _devices.emplace_back();
+        _devices.back().session = std::move(session);
+        _devices.back().backoff = FIRST_BACKOFF;
+        _scene.add(address);
+        return true;
+    }
+    return false;
+}
+
+bool Gateway::start()
+{
+    if (_started) {
+        return false;
+    }
+    _start_us = steady_us();
+
+    if (!_config.log_dir.empty()) {
+        uint64_t start_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+        for (Device &device : _devices) {
+            std::string path = _config.log_dir + "/" + file_name(device.session->address()) + ".rswl";
+            device.log.reset(new SweepLogWriter);
+            if (!device.log->open(path.c_str(), start_time_us)) {
+                for (Device &opened : _devices) {
+                    opened.log.reset();
+                }
+                return false;
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < _config.workers; ++i) {
+        _workers.emplace_back(new Worker);
+        Worker &worker = *_workers.back();
+        worker.wakeup = eventfd(0, EFD_CLOEXEC);
+        worker.thread = std::thread([this, &worker]() { run_worker(worker); });
+    }
+
+    _started = true;
+    for (Device &device : _devices) {
+        device.session->connect();
+    }
+    return true;
+}
+
+void Gateway::stop()
+{
+    if (!_started) {
+        return;
+    }
+    _started = false;
+
+    if (_flush) {
+        _loop.cancel(_flush);
+        _flush = 0;
+    }
+    for (Device &device : _devices) {
+        if (device.retry) {
+            _loop.cancel(device.retry);
+            device.retry = 0;
+        }
+    }
+
+    // Whatever is queued is still applied
+    for (std::unique_ptr<Worker> &worker : _workers) {
+        worker->stopping = true;
+        wake(*worker);
+    }
+    for (std::unique_ptr<Worker> &worker : _workers) {
+        worker->thread.join();
+        close(worker->wakeup);
+    }
+
+    for (Device &device : _devices) {
+        if (device.log) {
+            device.log->close();
+        }
+    }
+}
+
+GatewayStats Gateway::stats() const
+{
+    GatewayStats stats;
+    for (const std::unique_ptr<Worker> &worker : _workers) {
+        stats.queued += worker->queue.pushed();
+        stats.dropped += worker->queue.overflows();
+        stats.high_watermark = std::max(stats.high_watermark, worker->queue.high_watermark());
+        stats.wakeups += worker->wakeups.load(std::memory_order_relaxed);
+    }
+    for (const Device &device : _devices) {
+        stats.connected += device.session->connected();
+    }
+    return stats;
+}
+
+void Gateway::on_connected(Session &session)
+{
+    size_t index = device_of(session);
+    Device &device = _devices[index];
+    device.backoff = FIRST_BACKOFF;
+    _scene.update(index, [](DeviceState &state) {
+        state.connected = true;
+        ++state.connections;
+        // Sequence numbers start over with the session
+        state.sequenced = false;
+    });
+
+    for (const Schema *schema : SUBSCRIBED) {
+        session.subscribe(parse_uuid(schema->uuid));
+    }
+    for (const Schema *schema : READ_ON_CONNECTION) {
+        session.read(parse_uuid(schema->uuid));
+    }
+}
+
+void Gateway::on_value(Session &session, const Uuid &uuid, const uint8_t *data, size_t size, bool read)
+{
+    const Uuid *schema = std::find(_uuids, _uuids + SCHEMA_COUNT, uuid);
+    if (schema == _uuids + SCHEMA_COUNT || size > MAX_ATTRIBUTE_SIZE || !_started) {
+        return;
+    }
+    if (read && !size) {
+        // Nothing published yet, the lists before the first sweep
+        return;
+    }
+    size_t device = device_of(session);
+    Worker &worker = worker_of(device);
+
+    Value value;
+    value.device = static_cast<uint32_t>(device);
+    value.schema = static_cast<uint16_t>(schema - _uuids);
+    value.size = static_cast<uint16_t>(size);
+    value.received_us = steady_us();
+    memcpy(value.data, data, size);
+    // A full queue holds the loop back a little, the sockets buffer the rest
+    for (unsigned attempt = 0; worker.queue.size() == QUEUE_SIZE && attempt < FULL_QUEUE_YIELDS; ++attempt) {
+        wake(worker);
+        std::this_thread::yield();
+    }
+    if (!worker.queue.push(value)) {
+        return;
+    }
+
+    worker.pending = true;
+    if (worker.queue.size() >= QUEUE_SIZE / 2) {
+        // A burst, the worker cannot wait for the flush
+        worker.pending = false;
+        wake(worker);
+    } else if (!_flush) {
+        _flush = _loop.call_in(FLUSH_DELAY, [this]() {
+            _flush = 0;
+            flush();
+        });
+    }
+}
+
+void Gateway::on_disconnected(Session &session)
+{
+    size_t index = device_of(session);
+    Device &device = _devices[index];
+    _scene.update(index, [](DeviceState &state) {
+        state.connected = false;
+    });
+    if (!_started || device.retry) {
+        return;
+    }
+    device.retry = _loop.call_in(device.backoff, [&device]() {
+        device.retry = 0;
+        device.session->connect();
+    });
+    device.backoff = std::min<EventLoop::clock::duration>(device.backoff * 2, MAX_BACKOFF);
+}
+
+size_t Gateway::device_of(const Session &session) const
+{
+    return _sessions.at(&session);
+}
+
+Gateway::Worker &Gateway::worker_of(size_t device)
+{
+    return *_workers[device % _workers.size()];
+}
+
+void Gateway::flush()
+{
+    for (std::unique_ptr<Worker> &worker : _workers) {
+        if (worker->pending) {
+            worker->pending = false;
+            wake(*worker);
+        }
+    }
+}
+
+void Gateway::wake(Worker &worker)
+{
+    uint64_t one = 1;
+    ssize_t written = write(worker.wakeup, &one, sizeof(one));
+    (void)written;
+}
+
+void Gateway::run_worker(Worker &worker)
+{
+    Value value;
+    for (;;) {
+        bool stopping = worker.stopping.load();
+        while (worker.queue.pop(value)) {
+            apply(value);
+        }
+        if (stopping) {
+            return;
+        }
+        uint64_t count;
+        if (read(worker.wakeup, &count, sizeof(count)) > 0) {
+            worker.wakeups.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void Gateway::apply(const Value &value)
+{
+    bool (*apply_value)(DeviceState &, const uint8_t *, size_t) = APPLY[value.schema];
+    _scene.update(value.device, [&value, apply_value](DeviceState &state) {
+        ++state.values;
+        state.bytes += value.size;
+        state.updated_us = value.received_us;
+        if (apply_value && !apply_value(state, value.data, value.size)) {
+            ++state.rejected;
+        }
+    });
+
+    Device &device = _devices[value.device];
+    SweepFrameView frame;
+    if (!device.log || value.schema != _sweep_frame || !decode(SWEEP_FRAME, value.data, value.size, frame)) {
+        return;
+    }
+    static_assert(sizeof(SweepLogSample) == sizeof(SweepSample), "frame samples are logged as is");
+    const SweepLogSample *samples = reinterpret_cast<const SweepLogSample *>(frame.begin());
+    size_t count = frame.size();
+    device.log->append(value.received_us - _start_us, frame.header().sweep, frame.header().sequence,
+                       samples, count);
+}
+
+}
@@ -0,0 +1,152 @@
+/*
+ * Gateway keeping sessions to many radars and folding their values into a
+ * Scene.
+ *
+ *   event loop thread   every session, copies each value into the queue
+ *                       of the worker owning its device
+ *   worker threads      decode the values, update the Scene and the sweep
+ *                       logs of their devices
+ *
+ * A device always goes to the same worker, so its values are applied in
+ * the order they arrived and its sweep log has a single writer.
+ */
+#ifndef RADAR_HOST_GATEWAY_H
+#define RADAR_HOST_GATEWAY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "event_loop.h"
+#include "radar_protocol.h"
+#include "scene.h"
+#include "spsc_ring_buffer.h"
+#include "sweep_log.h"
+#include "transport.h"
+
+namespace radar {
+
+struct GatewayConfig {
+    unsigned workers = 1;
+    /* a sweep log per device is written there when not empty */
+    std::string log_dir;
+};
+
+struct GatewayStats {
+    uint64_t queued = 0;            /* values handed to the workers */
+    uint64_t dropped = 0;           /* values lost to a full worker queue */
+    size_t high_watermark = 0;      /* most values waiting in a queue */
+    uint64_t wakeups = 0;           /* times a worker was woken */
+    unsigned connected = 0;         /* devices with a session up */
+};
+
+class Gateway : public SessionHandler {
+public:
+    Gateway(EventLoop &loop, Scene &scene, const GatewayConfig &config);
+    Gateway(const Gateway &) = delete;
+    Gateway &operator=(const Gateway &) = delete;
+    ~Gateway() override;
+
+    /**
+     * Reach the devices with addresses accepted by transport.
+     */
+    void add_transport(Transport &transport);
+
+    /**
+     * Add a device, before start().
+     *
+     * @return false if no transport accepts the address.
+     */
+    bool add_device(const char *address);
+
+    /**
+     * Start the workers and connect every device, the sessions then run in
+     * the event loop.
+     *
+     * @return false if a sweep log cannot be created.
+     */
+    bool start();
+
+    /**
+     * Stop reconnecting, drain the queues and stop the workers, from the event
+     * loop thread once it stopped running.
+     */
+    void stop();
+
+    /**
+     * From the event loop thread.
+     */
+    GatewayStats stats() const;
+
+    void on_connected(Session &session) override;
+    void on_value(Session &session, const protocol::Uuid &uuid, const uint8_t *data, size_t size,
+                  bool read) override;
+    void on_disconnected(Session &session) override;
+
+private:
+    /* Values waiting per worker, at least a second of dozens of radars streaming */
+    static constexpr size_t QUEUE_SIZE = 2048;
+
+    /**
+     * A value as received, copied to a worker.
+     */
+    struct Value {
+        uint32_t device;
+        uint16_t schema;            /* index in protocol::SCHEMAS */
+        uint16_t size;
+        int64_t received_us;        /* steady clock */
+        uint8_t data[protocol::MAX_ATTRIBUTE_SIZE];
+    };
+
+    struct Worker {
+        SpscRingBuffer<Value, QUEUE_SIZE> queue;
+        /* eventfd the worker sleeps on */
+        int wakeup = -1;
+        /* values pushed since the last wakeup, event loop thread only */
+        bool pending = false;
+        std::atomic<bool> stopping{false};
+        std::atomic<uint64_t> wakeups{0};
+        std::thread thread;
+    };
+
+    struct Device {
+        std::unique_ptr<Session> session;
+        /* scheduled connect(), 0 if none */
+        int retry = 0;
+        EventLoop::clock::duration backoff;
+        /* owned by the worker of the device */
+        std::unique_ptr<SweepLogWriter> log;
+    };
+
+    size_t device_of(const Session &session) const;
+    Worker &worker_of(size_t device);
+    void flush();
+    void wake(Worker &worker);
+    void run_worker(Worker &worker);
+    void apply(const Value &value);
+
+    EventLoop &_loop;
+    Scene &_scene;
+    GatewayConfig _config;
+    std::vector<Transport *> _transports;
+    std::vector<Device> _devices;
+    std::unordered_map<const Session *, size_t> _sessions;
+    std::vector<std::unique_ptr<Worker>> _workers;
+    /* UUID of each schema, parsed once */
+    protocol::Uuid _uuids[protocol::SCHEMA_COUNT];
+    size_t _sweep_frame;
+    /* steady clock, sweep log timestamps count from there */
+    int64_t _start_us = 0;
+    /* flush() is scheduled for the end of the current loop round */
+    int _flush = 0;
+    bool _started = false;
+};
+
+}
+
+#endif // RADAR_HOST_GATEWAY_H
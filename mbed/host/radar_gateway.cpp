@@ -0,0 +1,260 @@
+/*
+ * Gateway daemon aggregating many radars into one scene.
+ *
+ * Usage: radar_gateway [--workers N] [--report S] [--log-dir DIR]
+ *                      [--seconds S] [--adapter hciN] DEVICE...
+ *
+ * Each DEVICE is the address of a radar, unix:PATH for radar_sim --socket
+ * PATH, ble:AA:BB:CC:DD:EE:FF for a radar paired with BlueZ or
+ * serial:PATH[@BAUD] for a wired radar (see transport.h). Sessions are kept up, reconnecting with a growing delay.
+ *
+ * One thread serves every session, --workers threads (1 by default) decode
+ * the values into the scene. --log-dir records the sweep frames of every
+ * device in a sweep log of its own, named after its address.
+ *
+ * Every --report seconds (5 by default) the state of each device and the
+ * CPU time of the gateway go to stdout. Runs until SIGINT or SIGTERM, or
+ * for --seconds; the totals then go to stderr.
+ */
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "event_loop.h"
+#include "gateway.h"
+#include "scene.h"
+#include "serial_transport.h"
+#include "socket_transport.h"
+#if RADAR_GATEWAY_BLUEZ
+#include "bluez_transport.h"
+#endif
+
+namespace {
+
+radar::EventLoop *running_loop;
+
+void on_signal(int)
+{
+    if (running_loop) {
+        running_loop->stop();
+    }
+}
+
+void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--workers N] [--report S] [--log-dir DIR] [--seconds S] [--adapter hciN] "
+                    "DEVICE...\r\n", program);
+}
+
+double cpu_seconds()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+struct Totals {
+    uint64_t values = 0;
+    uint64_t bytes = 0;
+    uint64_t samples = 0;
+    uint64_t frames = 0;
+    uint64_t missed_frames = 0;
+    uint64_t rejected = 0;
+};
+
+/**
+ * Print the state of every device, rates since the previous report.
+ */
+class Reporter {
+public:
+    Reporter(radar::Scene &scene, radar::Gateway &gateway) :
+        _scene(scene),
+        _gateway(gateway),
+        _previous(scene.size(), Counts{0, 0}),
+        _time(std::chrono::steady_clock::now()),
+        _cpu(cpu_seconds())
+    {
+    }
+
+    void report()
+    {
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - _time).count();
+        double cpu = cpu_seconds();
+        if (elapsed <= 0) {
+            return;
+        }
+
+        Totals totals;
+        for (size_t i = 0; i < _scene.size(); ++i) {
+            radar::DeviceState state = _scene.snapshot(i);
+            unsigned known = 0;
+            for (uint16_t range : state.ranges_mm) {
+                known += range != 0;
+            }
+            printf("%-28s %-4s %7.1f values/s %6.1f frames/s %5llu missed  %3u bins  %2zu objects  %2zu tracks\n",
+                   state.address.c_str(), state.connected ? "up" : "down",
+                   (state.values - _previous[i].values) / elapsed, (state.frames - _previous[i].frames) / elapsed,
+                   static_cast<unsigned long long>(state.missed_frames), known, state.objects.size(),
+                   state.tracks.size());
+            _previous[i] = {state.values, state.frames};
+            totals.values += state.values;
+            totals.samples += state.samples;
+        }
+
+        radar::GatewayStats stats = _gateway.stats();
+        printf("gateway: %u/%zu up, %.0f values/s, %.0f samples/s, cpu %.1f%% of a core, "
+               "queue peak %zu, %llu dropped, %.0f wakeups/s\n",
+               stats.connected, _scene.size(), (totals.values - _values) / elapsed,
+               (totals.samples - _samples) / elapsed, 100.0 * (cpu - _cpu) / elapsed, stats.high_watermark,
+               static_cast<unsigned long long>(stats.dropped), (stats.wakeups - _wakeups) / elapsed);
+        fflush(stdout);
+
+        _values = totals.values;
+        _samples = totals.samples;
+        _wakeups = stats.wakeups;
+        _time = now;
+        _cpu = cpu;
+    }
+
+private:
+    struct Counts {
+        uint64_t values;
+        uint64_t frames;
+    };
+
+    radar::Scene &_scene;
+    radar::Gateway &_gateway;
+    /* of each device at the previous report */
+    std::vector<Counts> _previous;
+    std::chrono::steady_clock::time_point _time;
+    double _cpu;
+    uint64_t _values = 0;
+    uint64_t _samples = 0;
+    uint64_t _wakeups = 0;
+};
+
+}
+
+int main(int argc, char **argv)
+{
+    radar::GatewayConfig config;
+    double report_s = 5.0;
+    double seconds = 0.0;
+    const char *adapter = "hci0";
+    std::vector<const char *> addresses;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--workers") && i + 1 < argc) {
+            config.workers = static_cast<unsigned>(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--report") && i + 1 < argc) {
+            report_s = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--log-dir") && i + 1 < argc) {
+            config.log_dir = argv[++i];
+        } else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--adapter") && i + 1 < argc) {
+            adapter = argv[++i];
+        } else if (argv[i][0] != '-') {
+            addresses.push_back(argv[i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (addresses.empty() || !config.workers || report_s <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    radar::EventLoop loop;
+    radar::SocketTransport socket_transport(loop);
+    radar::SerialTransport serial_transport(loop);
+#if RADAR_GATEWAY_BLUEZ
+    radar::BluezTransport bluez_transport(loop, adapter);
+#else
+    (void)adapter;
+#endif
+    radar::Scene scene;
+    radar::Gateway gateway(loop, scene, config);
+    gateway.add_transport(socket_transport);
+    gateway.add_transport(serial_transport);
+#if RADAR_GATEWAY_BLUEZ
+    if (bluez_transport.ready()) {
+        gateway.add_transport(bluez_transport);
+    }
+#endif
+    for (const char *address : addresses) {
+        if (!gateway.add_device(address)) {
+            fprintf(stderr, "cannot reach %s\r\n", address);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!gateway.start()) {
+        fprintf(stderr, "cannot write sweep logs in %s\r\n", config.log_dir.c_str());
+        return EXIT_FAILURE;
+    }
+
+    running_loop = &loop;
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    Reporter reporter(scene, gateway);
+    auto report_period = std::chrono::duration_cast<radar::EventLoop::clock::duration>(
+        std::chrono::duration<double>(report_s)
+    );
+    std::function<void()> report = [&]() {
+        reporter.report();
+        loop.call_in(report_period, report);
+    };
+    loop.call_in(report_period, report);
+
+    auto start = radar::EventLoop::clock::now();
+    double cpu_start = cpu_seconds();
+    if (seconds > 0) {
+        loop.run(start + std::chrono::duration_cast<radar::EventLoop::clock::duration>(
+            std::chrono::duration<double>(seconds)
+        ));
+    } else {
+        loop.run();
+    }
+    running_loop = nullptr;
+    gateway.stop();
+
+    double wall_s = std::chrono::duration<double>(radar::EventLoop::clock::now() - start).count();
+    double cpu_s = cpu_seconds() - cpu_start;
+    radar::GatewayStats stats = gateway.stats();
+    Totals totals;
+    for (size_t i = 0; i < scene.size(); ++i) {
+        radar::DeviceState state = scene.snapshot(i);
+        totals.values += state.values;
+        totals.bytes += state.bytes;
+        totals.samples += state.samples;
+        totals.frames += state.frames;
+        totals.missed_frames += state.missed_frames;
+        totals.rejected += state.rejected;
+    }
+    fprintf(stderr, "devices:         %zu\r\n", scene.size());
+    fprintf(stderr, "wall time:       %.3f s\r\n", wall_s);
+    fprintf(stderr, "cpu time:        %.3f s (%.1f%% of a core)\r\n", cpu_s, wall_s > 0 ? 100.0 * cpu_s / wall_s : 0.0);
+    fprintf(stderr, "values:          %llu (%.1f/s), %llu bytes, %llu rejected\r\n",
+            static_cast<unsigned long long>(totals.values), wall_s > 0 ? totals.values / wall_s : 0.0,
+            static_cast<unsigned long long>(totals.bytes), static_cast<unsigned long long>(totals.rejected));
+    fprintf(stderr, "sweep frames:    %llu, %llu samples, %llu missed\r\n",
+            static_cast<unsigned long long>(totals.frames), static_cast<unsigned long long>(totals.samples),
+            static_cast<unsigned long long>(totals.missed_frames));
+    fprintf(stderr, "queues:          %zu peak, %llu dropped, %llu wakeups (%.1f values each)\r\n",
+            stats.high_watermark, static_cast<unsigned long long>(stats.dropped),
+            static_cast<unsigned long long>(stats.wakeups),
+            stats.wakeups ? static_cast<double>(stats.queued) / stats.wakeups : 0.0);
+    if (totals.values) {
+        fprintf(stderr, "cost:            %.2f us of cpu per value\r\n", cpu_s * 1e6 / totals.values);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,19 @@
+#include "scene.h"
+
+namespace radar {
+
+size_t Scene::add(const std::string &address)
+{
+    _devices.emplace_back(new Device);
+    _devices.back()->state.address = address;
+    return _devices.size() - 1;
+}
+
+DeviceState Scene::snapshot(size_t device) const
+{
+    const Device &entry = *_devices[device];
+    std::lock_guard<std::mutex> lock(entry.mutex);
+    return entry.state;
+}
+
+}
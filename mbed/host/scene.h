@@ -0,0 +1,93 @@
+/*
+ * What the gateway knows of the surroundings of every radar, shared between
+ * the pipeline writing it and the readers reporting it.
+ */
+#ifndef RADAR_HOST_SCENE_H
+#define RADAR_HOST_SCENE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "radar_protocol.h"
+
+namespace radar {
+
+/* Bins of the range map of a device, one per degree */
+constexpr size_t SCENE_BINS = 181;
+
+/**
+ * State of one radar.
+ */
+struct DeviceState {
+    std::string address;
+    bool connected = false;
+    uint32_t connections = 0;       /* sessions brought up */
+    uint64_t values = 0;            /* values decoded */
+    uint64_t bytes = 0;
+    uint64_t rejected = 0;          /* values failing to decode */
+    uint64_t frames = 0;            /* sweep frames */
+    uint64_t samples = 0;
+    uint64_t missed_frames = 0;     /* gaps in the frame sequence numbers */
+    uint16_t sequence = 0;          /* of the last frame */
+    bool sequenced = false;         /* a frame of the current session was seen */
+    int64_t updated_us = 0;         /* last value, steady clock */
+    /* latest distance per degree, 0 when unknown */
+    uint16_t ranges_mm[SCENE_BINS] = {};
+    protocol::ObjectListHeader objects_header = {};
+    std::vector<protocol::SweepObject> objects;
+    protocol::TrackListHeader tracks_header = {};
+    std::vector<protocol::ObjectTrack> tracks;
+    protocol::LinkStatus link = {};
+    protocol::SampleBufferStats buffer_stats = {};
+};
+
+/**
+ * The state of every radar, each behind its own lock.
+ *
+ * Devices are added before the pipeline starts, then updated and read from
+ * any thread.
+ */
+class Scene {
+public:
+    /**
+     * @return index of the device.
+     */
+    size_t add(const std::string &address);
+
+    size_t size() const
+    {
+        return _devices.size();
+    }
+
+    /**
+     * Call fn with the state of the device, locked.
+     */
+    template<typename F>
+    void update(size_t device, F fn)
+    {
+        Device &entry = *_devices[device];
+        std::lock_guard<std::mutex> lock(entry.mutex);
+        fn(entry.state);
+    }
+
+    /**
+     * Copy of the state of the device.
+     */
+    DeviceState snapshot(size_t device) const;
+
+private:
+    struct Device {
+        mutable std::mutex mutex;
+        DeviceState state;
+    };
+
+    std::vector<std::unique_ptr<Device>> _devices;
+};
+
+}
+
+#endif // RADAR_HOST_SCENE_H
@@ -0,0 +1,259 @@
+#include "serial_transport.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "serial_protocol.h"
+
+namespace radar {
+
+namespace {
+
+constexpr char PREFIX[] = "serial:";
+constexpr size_t PREFIX_LENGTH = sizeof(PREFIX) - 1;
+
+constexpr unsigned DEFAULT_BAUD = 921600;
+
+/* Bytes taken per read(), the sessions take turns beyond that */
+constexpr size_t RECEIVE_CHUNK = 4096;
+
+struct BaudRate {
+    unsigned baud;
+    speed_t speed;
+};
+
+const BaudRate BAUD_RATES[] = {
+    {115200, B115200}, {230400, B230400}, {460800, B460800}, {500000, B500000}, {576000, B576000},
+    {921600, B921600}, {1000000, B1000000}, {1152000, B1152000}, {1500000, B1500000}, {2000000, B2000000},
+    {2500000, B2500000}, {3000000, B3000000}, {3500000, B3500000}, {4000000, B4000000},
+};
+
+/**
+ * Split PATH[@BAUD].
+ *
+ * @return false if the baud rate is not one of the line.
+ */
+bool parse_address(const char *address, std::string &path, speed_t &speed)
+{
+    const char *at = strrchr(address, '@');
+    path.assign(address, at ? at - address : strlen(address));
+    unsigned baud = at ? static_cast<unsigned>(strtoul(at + 1, nullptr, 10)) : DEFAULT_BAUD;
+    for (const BaudRate &rate : BAUD_RATES) {
+        if (rate.baud == baud) {
+            speed = rate.speed;
+            return !path.empty();
+        }
+    }
+    return false;
+}
+
+/* UUID of each schema, in the order of SCHEMAS */
+struct SchemaUuids {
+    protocol::Uuid uuids[protocol::SCHEMA_COUNT];
+
+    SchemaUuids()
+    {
+        for (size_t i = 0; i < protocol::SCHEMA_COUNT; ++i) {
+            uuids[i] = protocol::parse_uuid(protocol::SCHEMAS[i].uuid);
+        }
+    }
+
+    /**
+     * Index of uuid in SCHEMAS, SCHEMA_COUNT if none.
+     */
+    size_t find(const protocol::Uuid &uuid) const
+    {
+        for (size_t i = 0; i < protocol::SCHEMA_COUNT; ++i) {
+            if (uuids[i] == uuid) {
+                return i;
+            }
+        }
+        return protocol::SCHEMA_COUNT;
+    }
+};
+
+const SchemaUuids schema_uuids;
+
+class SerialSession : public Session {
+public:
+    SerialSession(EventLoop &loop, const char *address, const std::string &path, speed_t speed,
+                  SessionHandler &handler) :
+        _loop(loop),
+        _address(address),
+        _path(path),
+        _speed(speed),
+        _handler(handler)
+    {
+    }
+
+    ~SerialSession() override
+    {
+        if (_pending) {
+            _loop.cancel(_pending);
+        }
+        close_line();
+    }
+
+    void connect() override
+    {
+        if (_fd >= 0 || _pending) {
+            return;
+        }
+        bool opened = open_line();
+        if (!opened) {
+            close_line();
+        }
+        // Reported from the loop, the caller may not expect the handler to run yet
+        _pending = _loop.call_in(EventLoop::clock::duration::zero(), [this, opened]() {
+            _pending = 0;
+            if (opened) {
+                _handler.on_connected(*this);
+            } else {
+                _handler.on_disconnected(*this);
+            }
+        });
+    }
+
+    bool connected() const override
+    {
+        return _fd >= 0;
+    }
+
+    bool subscribe(const protocol::Uuid &uuid) override
+    {
+        return _fd >= 0 && schema_uuids.find(uuid) < protocol::SCHEMA_COUNT;
+    }
+
+    bool write(const protocol::Uuid &uuid, const uint8_t *data, size_t size) override
+    {
+        return send(protocol::SerialFrameType::Write, uuid, data, size);
+    }
+
+    bool read(const protocol::Uuid &uuid) override
+    {
+        return send(protocol::SerialFrameType::Read, uuid, nullptr, 0);
+    }
+
+    const char *address() const override
+    {
+        return _address.c_str();
+    }
+
+private:
+    bool open_line()
+    {
+        _fd = ::open(_path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+        if (_fd < 0) {
+            return false;
+        }
+
+        // Frames are binary: no echo, no line editing, no translation of CR and LF
+        termios attributes;
+        if (tcgetattr(_fd, &attributes) != 0) {
+            return false;
+        }
+        cfmakeraw(&attributes);
+        cfsetspeed(&attributes, _speed);
+        attributes.c_cflag |= CLOCAL | CREAD;
+        if (tcsetattr(_fd, TCSANOW, &attributes) != 0) {
+            return false;
+        }
+        // Whatever was received before is stale, the decoder starts on a frame boundary
+        tcflush(_fd, TCIFLUSH);
+        _decoder = protocol::SerialFrameDecoder();
+        return _loop.add(_fd, EPOLLIN, [this](uint32_t events) { on_ready(events); });
+    }
+
+    bool send(protocol::SerialFrameType type, const protocol::Uuid &uuid, const uint8_t *data, size_t size)
+    {
+        size_t characteristic = schema_uuids.find(uuid);
+        if (_fd < 0 || characteristic == protocol::SCHEMA_COUNT || size > protocol::MAX_ATTRIBUTE_SIZE) {
+            return false;
+        }
+        uint8_t frame[protocol::SERIAL_ENCODED_MAX_SIZE];
+        protocol::SerialFrameHeader header = {
+            static_cast<uint8_t>(type), 0, static_cast<uint8_t>(characteristic)
+        };
+        size_t encoded = protocol::encode_serial_frame(header, data, size, frame);
+        // A frame cut short is rejected by the radar, as if lost on the line
+        return ::write(_fd, frame, encoded) == static_cast<ssize_t>(encoded);
+    }
+
+    void on_ready(uint32_t events)
+    {
+        uint8_t chunk[RECEIVE_CHUNK];
+        ssize_t received = ::read(_fd, chunk, sizeof(chunk));
+        if (received <= 0) {
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) &&
+                !(events & (EPOLLHUP | EPOLLERR))) {
+                return;
+            }
+            // Unplugged, or the other side of the pseudo terminal closed
+            disconnect();
+            return;
+        }
+        for (ssize_t i = 0; i < received; ++i) {
+            if (!_decoder.push(chunk[i])) {
+                continue;
+            }
+            const protocol::SerialFrameHeader &header = _decoder.header();
+            if (header.type != static_cast<uint8_t>(protocol::SerialFrameType::Value) ||
+                header.characteristic >= protocol::SCHEMA_COUNT) {
+                continue;
+            }
+            _handler.on_value(*this, schema_uuids.uuids[header.characteristic], _decoder.value(), _decoder.size(),
+                              header.flags & protocol::SERIAL_VALUE_READ);
+        }
+    }
+
+    void disconnect()
+    {
+        close_line();
+        _handler.on_disconnected(*this);
+    }
+
+    void close_line()
+    {
+        if (_fd >= 0) {
+            _loop.remove(_fd);
+            close(_fd);
+            _fd = -1;
+        }
+    }
+
+    EventLoop &_loop;
+    std::string _address;
+    std::string _path;
+    speed_t _speed;
+    SessionHandler &_handler;
+    int _fd = -1;
+    /* timer reporting the outcome of connect() */
+    int _pending = 0;
+    protocol::SerialFrameDecoder _decoder;
+};
+
+}
+
+bool SerialTransport::accepts(const char *address) const
+{
+    return !strncmp(address, PREFIX, PREFIX_LENGTH);
+}
+
+std::unique_ptr<Session> SerialTransport::open(const char *address, SessionHandler &handler)
+{
+    std::string path;
+    speed_t speed;
+    if (!accepts(address) || !parse_address(address + PREFIX_LENGTH, path, speed)) {
+        return nullptr;
+    }
+    return std::unique_ptr<Session>(new SerialSession(_loop, address, path, speed, handler));
+}
+
+}
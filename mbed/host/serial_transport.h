@@ -0,0 +1,36 @@
+/*
+ * Transport to wired radars, over a serial line.
+ */
+#ifndef RADAR_HOST_SERIAL_TRANSPORT_H
+#define RADAR_HOST_SERIAL_TRANSPORT_H
+
+#include "event_loop.h"
+#include "transport.h"
+
+namespace radar {
+
+/**
+ * Sessions over the frames of serial_protocol.h, addressed
+ * serial:PATH[@BAUD] with the tty of the line (921600 baud by default), or
+ * the pseudo terminal of radar_sim --serial.
+ *
+ * A wired radar streams whatever it has without being asked, subscribe()
+ * only checks that the line is open.
+ */
+class SerialTransport : public Transport {
+public:
+    explicit SerialTransport(EventLoop &loop) :
+        _loop(loop)
+    {
+    }
+
+    bool accepts(const char *address) const override;
+    std::unique_ptr<Session> open(const char *address, SessionHandler &handler) override;
+
+private:
+    EventLoop &_loop;
+};
+
+}
+
+#endif // RADAR_HOST_SERIAL_TRANSPORT_H
@@ -0,0 +1,47 @@
+/*
+ * Messages of the UNIX socket standing in for the BLE link between a radar
+ * and a gateway, served by radar_sim --socket.
+ *
+ * The socket is SOCK_SEQPACKET: the boundaries of the messages are kept,
+ * one message per packet. A message is a SocketMessageHeader naming the
+ * characteristic by its UUID, followed by the value when it carries one.
+ *
+ *   gateway -> radar   Subscribe, Write (value), Read
+ *   radar -> gateway   Value (value), in reply to a Read or as a notification
+ */
+#ifndef RADAR_HOST_SOCKET_PROTOCOL_H
+#define RADAR_HOST_SOCKET_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "radar_protocol.h"
+
+namespace radar {
+
+enum class SocketMessageType : uint8_t {
+    Subscribe = 1,
+    Write = 2,
+    Read = 3,
+    Value = 4,
+};
+
+/* SocketMessageHeader::flags of a Value */
+constexpr uint8_t SOCKET_VALUE_READ = 0x01;     /* the reply to a Read, a notification otherwise */
+
+#pragma pack(push, 1)
+
+struct SocketMessageHeader {
+    uint8_t type;           /* SocketMessageType */
+    uint8_t flags;
+    uint8_t uuid[16];       /* characteristic, as radar::protocol::Uuid */
+};
+
+#pragma pack(pop)
+
+/* Longest message, a header and the longest attribute value */
+constexpr size_t SOCKET_MESSAGE_MAX_SIZE = sizeof(SocketMessageHeader) + protocol::MAX_ATTRIBUTE_SIZE;
+
+}
+
+#endif // RADAR_HOST_SOCKET_PROTOCOL_H
@@ -0,0 +1,201 @@
+#include "socket_transport.h"
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "socket_protocol.h"
+
+namespace radar {
+
+namespace {
+
+constexpr char PREFIX[] = "unix:";
+constexpr size_t PREFIX_LENGTH = sizeof(PREFIX) - 1;
+
+/* Messages taken per recvmmsg(), the sessions take turns beyond that */
+constexpr unsigned RECEIVE_BATCH = 16;
+
+/* Buffers of recvmmsg(), shared by the sessions of the event loop thread */
+struct ReceiveBatch {
+    uint8_t messages[RECEIVE_BATCH][SOCKET_MESSAGE_MAX_SIZE];
+    iovec vectors[RECEIVE_BATCH];
+    mmsghdr headers[RECEIVE_BATCH];
+
+    ReceiveBatch()
+    {
+        memset(headers, 0, sizeof(headers));
+        for (unsigned i = 0; i < RECEIVE_BATCH; ++i) {
+            vectors[i] = {messages[i], sizeof(messages[i])};
+            headers[i].msg_hdr.msg_iov = &vectors[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+};
+
+class SocketSession : public Session {
+public:
+    SocketSession(EventLoop &loop, const char *address, SessionHandler &handler) :
+        _loop(loop),
+        _address(address),
+        _handler(handler)
+    {
+    }
+
+    ~SocketSession() override
+    {
+        if (_pending) {
+            _loop.cancel(_pending);
+        }
+        close_socket();
+    }
+
+    void connect() override
+    {
+        if (_fd >= 0 || _pending) {
+            return;
+        }
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        const char *path = _address.c_str() + PREFIX_LENGTH;
+        bool opened = false;
+        if (strlen(path) < sizeof(address.sun_path)) {
+            strcpy(address.sun_path, path);
+            _fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            opened = _fd >= 0 &&
+                     ::connect(_fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0 &&
+                     _loop.add(_fd, EPOLLIN, [this](uint32_t events) { on_ready(events); });
+        }
+        if (!opened) {
+            close_socket();
+        }
+        // Reported from the loop, the caller may not expect the handler to run yet
+        _pending = _loop.call_in(EventLoop::clock::duration::zero(), [this, opened]() {
+            _pending = 0;
+            if (opened) {
+                _handler.on_connected(*this);
+            } else {
+                _handler.on_disconnected(*this);
+            }
+        });
+    }
+
+    bool connected() const override
+    {
+        return _fd >= 0;
+    }
+
+    bool subscribe(const protocol::Uuid &uuid) override
+    {
+        return send(SocketMessageType::Subscribe, uuid, nullptr, 0);
+    }
+
+    bool write(const protocol::Uuid &uuid, const uint8_t *data, size_t size) override
+    {
+        return send(SocketMessageType::Write, uuid, data, size);
+    }
+
+    bool read(const protocol::Uuid &uuid) override
+    {
+        return send(SocketMessageType::Read, uuid, nullptr, 0);
+    }
+
+    const char *address() const override
+    {
+        return _address.c_str();
+    }
+
+private:
+    bool send(SocketMessageType type, const protocol::Uuid &uuid, const uint8_t *data, size_t size)
+    {
+        if (_fd < 0 || size > protocol::MAX_ATTRIBUTE_SIZE) {
+            return false;
+        }
+        uint8_t message[SOCKET_MESSAGE_MAX_SIZE];
+        SocketMessageHeader header = {static_cast<uint8_t>(type), 0, {}};
+        memcpy(header.uuid, uuid.bytes, sizeof(header.uuid));
+        memcpy(message, &header, sizeof(header));
+        if (size) {
+            memcpy(message + sizeof(header), data, size);
+        }
+        return ::send(_fd, message, sizeof(header) + size, MSG_NOSIGNAL) >= 0;
+    }
+
+    void on_ready(uint32_t events)
+    {
+        static ReceiveBatch batch;
+        int received = recvmmsg(_fd, batch.headers, RECEIVE_BATCH, 0, nullptr);
+        if (received <= 0) {
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) &&
+                !(events & (EPOLLHUP | EPOLLERR))) {
+                return;
+            }
+            disconnect();
+            return;
+        }
+        for (int i = 0; i < received; ++i) {
+            size_t size = batch.headers[i].msg_len;
+            if (!size) {
+                // End of file, messages are never empty
+                disconnect();
+                return;
+            }
+            if (size < sizeof(SocketMessageHeader)) {
+                continue;
+            }
+            const uint8_t *message = batch.messages[i];
+            const SocketMessageHeader *header = reinterpret_cast<const SocketMessageHeader *>(message);
+            if (header->type != static_cast<uint8_t>(SocketMessageType::Value)) {
+                continue;
+            }
+            protocol::Uuid uuid;
+            memcpy(uuid.bytes, header->uuid, sizeof(uuid.bytes));
+            _handler.on_value(*this, uuid, message + sizeof(SocketMessageHeader), size - sizeof(SocketMessageHeader),
+                              header->flags & SOCKET_VALUE_READ);
+        }
+    }
+
+    void disconnect()
+    {
+        close_socket();
+        _handler.on_disconnected(*this);
+    }
+
+    void close_socket()
+    {
+        if (_fd >= 0) {
+            _loop.remove(_fd);
+            close(_fd);
+            _fd = -1;
+        }
+    }
+
+    EventLoop &_loop;
+    std::string _address;
+    SessionHandler &_handler;
+    int _fd = -1;
+    /* timer reporting the outcome of connect() */
+    int _pending = 0;
+};
+
+}
+
+bool SocketTransport::accepts(const char *address) const
+{
+    return !strncmp(address, PREFIX, PREFIX_LENGTH);
+}
+
+std::unique_ptr<Session> SocketTransport::open(const char *address, SessionHandler &handler)
+{
+    if (!accepts(address) || !address[PREFIX_LENGTH]) {
+        return nullptr;
+    }
+    return std::unique_ptr<Session>(new SocketSession(_loop, address, handler));
+}
+
+}
@@ -0,0 +1,32 @@
+/*
+ * Transport to the simulated radars of radar_sim --socket.
+ */
+#ifndef RADAR_HOST_SOCKET_TRANSPORT_H
+#define RADAR_HOST_SOCKET_TRANSPORT_H
+
+#include "event_loop.h"
+#include "transport.h"
+
+namespace radar {
+
+/**
+ * Sessions over the SOCK_SEQPACKET UNIX sockets of socket_protocol.h,
+ * addressed unix:PATH.
+ */
+class SocketTransport : public Transport {
+public:
+    explicit SocketTransport(EventLoop &loop) :
+        _loop(loop)
+    {
+    }
+
+    bool accepts(const char *address) const override;
+    std::unique_ptr<Session> open(const char *address, SessionHandler &handler) override;
+
+private:
+    EventLoop &_loop;
+};
+
+}
+
+#endif // RADAR_HOST_SOCKET_TRANSPORT_H
@@ -0,0 +1,211 @@
+#include "sweep_log.h"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace radar {
+
+namespace {
+
+/* stdio buffer of the writer, blocks are a few hundred bytes */
+constexpr size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+}
+
+bool SweepLogWriter::open(const char *path, uint64_t start_time_us)
+{
+    close();
+
+    _file = fopen(path, "wb");
+    if (!_file) {
+        return false;
+    }
+    _buffer.resize(WRITE_BUFFER_SIZE);
+    setvbuf(_file, _buffer.data(), _IOFBF, _buffer.size());
+
+    _index.clear();
+    _offset = 0;
+    _blocks = 0;
+    _samples = 0;
+    _failed = false;
+
+    SweepLogHeader header = {
+        SWEEP_LOG_MAGIC,
+        SWEEP_LOG_VERSION,
+        sizeof(SweepLogHeader),
+        start_time_us,
+        sizeof(SweepLogSample),
+        sizeof(SweepLogBlock)
+    };
+    return write(&header, sizeof(header));
+}
+
+bool SweepLogWriter::append(uint64_t timestamp_us, uint16_t sweep, uint16_t sequence,
+                            const SweepLogSample *samples, size_t count)
+{
+    if (!_file || _failed || count > UINT16_MAX) {
+        return false;
+    }
+
+    if (_index.empty() || sweep != _sweep) {
+        _index.push_back(SweepLogIndexEntry{timestamp_us, _offset});
+        _sweep = sweep;
+    }
+
+    SweepLogBlock block = {
+        SWEEP_LOG_BLOCK_MAGIC,
+        timestamp_us,
+        sweep,
+        sequence,
+        static_cast<uint16_t>(count)
+    };
+    if (!write(&block, sizeof(block)) || !write(samples, count * sizeof(SweepLogSample))) {
+        return false;
+    }
+
+    ++_blocks;
+    _samples += count;
+    return true;
+}
+
+bool SweepLogWriter::close()
+{
+    if (!_file) {
+        return false;
+    }
+
+    SweepLogFooter footer = {_offset, static_cast<uint32_t>(_index.size()), SWEEP_LOG_INDEX_MAGIC};
+    bool ok = write(_index.data(), _index.size() * sizeof(SweepLogIndexEntry)) && write(&footer, sizeof(footer));
+    ok = (fclose(_file) == 0) && ok;
+    _file = nullptr;
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+    return ok;
+}
+
+bool SweepLogWriter::write(const void *data, size_t size)
+{
+    if (_failed) {
+        return false;
+    }
+    if (size && fwrite(data, 1, size, _file) != size) {
+        _failed = true;
+        return false;
+    }
+    _offset += size;
+    return true;
+}
+
+bool SweepLogReader::open(const char *path)
+{
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SweepLogHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps the file
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    _data = static_cast<const uint8_t *>(data);
+    _size = st.st_size;
+    // Blocks are mostly scanned front to back
+    madvise(data, _size, MADV_SEQUENTIAL);
+
+    const SweepLogHeader &h = header();
+    if (h.magic != SWEEP_LOG_MAGIC || h.version > SWEEP_LOG_VERSION || h.header_size < sizeof(SweepLogHeader) ||
+        h.header_size > _size || h.sample_size != sizeof(SweepLogSample) || h.block_size != sizeof(SweepLogBlock)) {
+        close();
+        return false;
+    }
+
+    _end = _size;
+    if (_size >= h.header_size + sizeof(SweepLogFooter)) {
+        const SweepLogFooter *footer = reinterpret_cast<const SweepLogFooter *>(_data + _size - sizeof(SweepLogFooter));
+        uint64_t index_bytes = static_cast<uint64_t>(footer->entries) * sizeof(SweepLogIndexEntry);
+        if (footer->magic == SWEEP_LOG_INDEX_MAGIC && footer->index_offset >= h.header_size &&
+            footer->index_offset + index_bytes + sizeof(SweepLogFooter) == _size) {
+            _end = footer->index_offset;
+            _index = reinterpret_cast<const SweepLogIndexEntry *>(_data + footer->index_offset);
+            _index_size = footer->entries;
+        }
+    }
+    return true;
+}
+
+void SweepLogReader::close()
+{
+    if (_data) {
+        munmap(const_cast<uint8_t *>(_data), _size);
+    }
+    _data = nullptr;
+    _size = 0;
+    _end = 0;
+    _index = nullptr;
+    _index_size = 0;
+}
+
+uint64_t SweepLogReader::seek(uint64_t timestamp_us) const
+{
+    if (!_index) {
+        // Cut short: walk the blocks, remembering where the sweep started
+        uint64_t sweep_start = begin();
+        uint16_t sweep = 0;
+        SweepLogView view;
+        uint64_t cursor = begin();
+        for (uint64_t at = cursor; next(cursor, view); at = cursor) {
+            if (view.block->timestamp_us > timestamp_us) {
+                break;
+            }
+            if (at == begin() || view.block->sweep != sweep) {
+                sweep_start = at;
+                sweep = view.block->sweep;
+            }
+        }
+        return sweep_start;
+    }
+
+    // Last sweep started at or before timestamp_us
+    size_t low = 0;
+    size_t high = _index_size;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (_index[middle].timestamp_us <= timestamp_us) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low ? _index[low - 1].offset : begin();
+}
+
+bool SweepLogReader::next(uint64_t &cursor, SweepLogView &view) const
+{
+    if (cursor + sizeof(SweepLogBlock) > _end) {
+        return false;
+    }
+    const SweepLogBlock *block = reinterpret_cast<const SweepLogBlock *>(_data + cursor);
+    uint64_t end = cursor + sizeof(SweepLogBlock) + block->count * sizeof(SweepLogSample);
+    if (block->magic != SWEEP_LOG_BLOCK_MAGIC || end > _end) {
+        return false;
+    }
+
+    view.block = block;
+    view.samples = reinterpret_cast<const SweepLogSample *>(block + 1);
+    cursor = end;
+    return true;
+}
+
+}
@@ -0,0 +1,254 @@
+/*
+ * Binary recording of radar sweeps, for offline analysis, replay and
+ * regression runs.
+ *
+ * A sweep log is appended to while the radar streams and read back through
+ * a memory map, the reader handing out pointers into the file rather than
+ * copies so that scanning a recording costs little more than paging it in.
+ *
+ * Layout, little endian, no padding:
+ *
+ *   SweepLogHeader
+ *   SweepLogBlock, count SweepLogSample     repeated, in time order
+ *   SweepLogIndexEntry                      one per sweep
+ *   SweepLogFooter
+ *
+ * The index and footer are written when the log is closed. A log cut short
+ * (crash, power loss) has neither, its blocks are still read up to the last
+ * complete one.
+ */
+#ifndef RADAR_HOST_SWEEP_LOG_H
+#define RADAR_HOST_SWEEP_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+namespace radar {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "sweep logs are little endian and mapped as is");
+
+/* "RSWL", start of the file */
+static constexpr uint32_t SWEEP_LOG_MAGIC = 0x4c575352;
+/* "RSWB", start of every block, lets a scan tell a torn block from data */
+static constexpr uint32_t SWEEP_LOG_BLOCK_MAGIC = 0x42575352;
+/* "RSWI", end of a closed log */
+static constexpr uint32_t SWEEP_LOG_INDEX_MAGIC = 0x49575352;
+/* incremented on changes older readers cannot skip */
+static constexpr uint16_t SWEEP_LOG_VERSION = 1;
+
+#pragma pack(push, 1)
+
+/**
+ * Start of a sweep log.
+ */
+struct SweepLogHeader {
+    uint32_t magic;             /* SWEEP_LOG_MAGIC */
+    uint16_t version;           /* SWEEP_LOG_VERSION */
+    uint16_t header_size;       /* the blocks start there, fields added later are skipped */
+    uint64_t start_time_us;     /* UNIX time of the start of the recording */
+    uint16_t sample_size;       /* sizeof(SweepLogSample) of the writer */
+    uint16_t block_size;        /* sizeof(SweepLogBlock) of the writer */
+};
+
+/**
+ * Samples received together, a sweep frame, followed by count
+ * SweepLogSample.
+ */
+struct SweepLogBlock {
+    uint32_t magic;             /* SWEEP_LOG_BLOCK_MAGIC */
+    uint64_t timestamp_us;      /* reception, since start_time_us */
+    uint16_t sweep;             /* sweeps completed before the block, wraps */
+    uint16_t sequence;          /* frame sequence number of the firmware */
+    uint16_t count;
+};
+
+/**
+ * Sample of a block, the layout of SweepSample in a sweep frame.
+ */
+struct SweepLogSample {
+    uint8_t angle;              /* degrees */
+    uint16_t distance_mm;
+};
+
+/**
+ * First block of a sweep.
+ */
+struct SweepLogIndexEntry {
+    uint64_t timestamp_us;
+    uint64_t offset;            /* of the block from the start of the file */
+};
+
+/**
+ * End of a closed log.
+ */
+struct SweepLogFooter {
+    uint64_t index_offset;
+    uint32_t entries;
+    uint32_t magic;             /* SWEEP_LOG_INDEX_MAGIC */
+};
+
+#pragma pack(pop)
+
+/**
+ * Appends blocks to a new sweep log.
+ *
+ * Blocks go through a large stdio buffer, the file is only complete, index
+ * included, once close() returned true. Not thread safe.
+ */
+class SweepLogWriter {
+public:
+    SweepLogWriter() = default;
+    SweepLogWriter(const SweepLogWriter &) = delete;
+    SweepLogWriter &operator=(const SweepLogWriter &) = delete;
+
+    ~SweepLogWriter()
+    {
+        close();
+    }
+
+    /**
+     * Create path, replacing any file there, and write the header.
+     */
+    bool open(const char *path, uint64_t start_time_us);
+
+    /**
+     * Append a block, a change of sweep adds an index entry.
+     *
+     * @return false once a write failed, the log then stays cut there.
+     */
+    bool append(uint64_t timestamp_us, uint16_t sweep, uint16_t sequence,
+                const SweepLogSample *samples, size_t count);
+
+    /**
+     * Write the index and footer and close the file.
+     */
+    bool close();
+
+    bool is_open() const
+    {
+        return _file != nullptr;
+    }
+
+    uint64_t blocks() const
+    {
+        return _blocks;
+    }
+
+    uint64_t samples() const
+    {
+        return _samples;
+    }
+
+private:
+    bool write(const void *data, size_t size);
+
+    FILE *_file = nullptr;
+    std::vector<char> _buffer;
+    std::vector<SweepLogIndexEntry> _index;
+    uint64_t _offset = 0;
+    uint64_t _blocks = 0;
+    uint64_t _samples = 0;
+    uint16_t _sweep = 0;
+    bool _failed = false;
+};
+
+/**
+ * Block of a mapped log, pointers into the mapping.
+ */
+struct SweepLogView {
+    const SweepLogBlock *block;
+    const SweepLogSample *samples;
+};
+
+/**
+ * Memory mapped, read only view of a sweep log.
+ *
+ * Blocks are walked with a cursor, an offset in the file:
+ *
+ *     SweepLogView view;
+ *     for (uint64_t cursor = log.begin(); log.next(cursor, view);) {
+ *         ...
+ *     }
+ *
+ * The views stay valid until the reader is closed. Reading is thread safe,
+ * each thread keeping its own cursor.
+ */
+class SweepLogReader {
+public:
+    SweepLogReader() = default;
+    SweepLogReader(const SweepLogReader &) = delete;
+    SweepLogReader &operator=(const SweepLogReader &) = delete;
+
+    ~SweepLogReader()
+    {
+        close();
+    }
+
+    /**
+     * Map path and check its header, and its index if it was closed.
+     */
+    bool open(const char *path);
+    void close();
+
+    const SweepLogHeader &header() const
+    {
+        return *reinterpret_cast<const SweepLogHeader *>(_data);
+    }
+
+    /**
+     * false for a log cut short, seek() then scans from the start.
+     */
+    bool indexed() const
+    {
+        return _index != nullptr;
+    }
+
+    const SweepLogIndexEntry *index() const
+    {
+        return _index;
+    }
+
+    size_t index_size() const
+    {
+        return _index_size;
+    }
+
+    /**
+     * Size of the mapping, in bytes.
+     */
+    uint64_t size() const
+    {
+        return _size;
+    }
+
+    uint64_t begin() const
+    {
+        return header().header_size;
+    }
+
+    /**
+     * Cursor of the first block of the sweep in progress at timestamp_us.
+     */
+    uint64_t seek(uint64_t timestamp_us) const;
+
+    /**
+     * View the block at cursor and move the cursor to the next one.
+     *
+     * @return false at the end of the blocks, or at a block torn or
+     * corrupted.
+     */
+    bool next(uint64_t &cursor, SweepLogView &view) const;
+
+private:
+    const uint8_t *_data = nullptr;
+    uint64_t _size = 0;
+    uint64_t _end = 0;          /* of the blocks */
+    const SweepLogIndexEntry *_index = nullptr;
+    size_t _index_size = 0;
+};
+
+}
+
+#endif // RADAR_HOST_SWEEP_LOG_H
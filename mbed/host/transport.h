@@ -0,0 +1,111 @@
+/*
+ * Link between the gateway and a radar, abstracted from the radio.
+ *
+ * A radar is reached at an address naming its transport:
+ *
+ *   unix:PATH             radar_sim --socket PATH (see SocketTransport)
+ *   ble:AA:BB:CC:DD:EE:FF a radar paired with BlueZ (see BluezTransport)
+ *   serial:PATH[@BAUD]    a wired radar, or radar_sim --serial (see
+ *                         SerialTransport)
+ *
+ * Characteristics are named by their UUID, as in radar_protocol.h, the
+ * handles being private to each link.
+ */
+#ifndef RADAR_HOST_TRANSPORT_H
+#define RADAR_HOST_TRANSPORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "radar_protocol.h"
+
+namespace radar {
+
+class Session;
+
+/**
+ * Told of the events of a session, on the thread of its event loop.
+ */
+class SessionHandler {
+public:
+    virtual ~SessionHandler() = default;
+
+    /**
+     * The link is up, the session can subscribe, write and read.
+     */
+    virtual void on_connected(Session &session) = 0;
+
+    /**
+     * A value of a characteristic, notified or in reply to read().
+     *
+     * The data is only valid during the call.
+     */
+    virtual void on_value(Session &session, const protocol::Uuid &uuid, const uint8_t *data, size_t size,
+                          bool read) = 0;
+
+    /**
+     * The link went down, or could not be brought up. The session can
+     * connect() again.
+     */
+    virtual void on_disconnected(Session &session) = 0;
+};
+
+/**
+ * Link to one radar.
+ *
+ * Nothing blocks, the requests are queued on the link and fail only when it
+ * is down.
+ */
+class Session {
+public:
+    virtual ~Session() = default;
+
+    /**
+     * Bring the link up, on_connected() or on_disconnected() follows.
+     */
+    virtual void connect() = 0;
+
+    virtual bool connected() const = 0;
+
+    /**
+     * Have the values of the characteristic notified.
+     */
+    virtual bool subscribe(const protocol::Uuid &uuid) = 0;
+
+    virtual bool write(const protocol::Uuid &uuid, const uint8_t *data, size_t size) = 0;
+
+    /**
+     * Request the value of the characteristic, given to on_value().
+     */
+    virtual bool read(const protocol::Uuid &uuid) = 0;
+
+    /**
+     * Address the session was opened with.
+     */
+    virtual const char *address() const = 0;
+};
+
+/**
+ * Opens sessions to the radars of one kind of link.
+ */
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    /**
+     * Whether address is one of this transport.
+     */
+    virtual bool accepts(const char *address) const = 0;
+
+    /**
+     * A session to the radar at address, not connected yet.
+     *
+     * @return nullptr if the address is malformed.
+     */
+    virtual std::unique_ptr<Session> open(const char *address, SessionHandler &handler) = 0;
+};
+
+}
+
+#endif // RADAR_HOST_TRANSPORT_H
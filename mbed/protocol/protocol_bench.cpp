@@ -0,0 +1,217 @@
+/*
+ * Decode throughput of the radar protocol.
+ *
+ * Builds a stream of values as a gateway receives them from a radar
+ * streaming at an ATT MTU of 247 (full sweep frames, object and track
+ * lists, trace batches, link and buffer updates) and decodes it in a loop,
+ * reading every field. Reports per characteristic the values and bytes
+ * decoded per second and the time per value, then the same for the mixed
+ * stream.
+ *
+ * Usage: radar_protocol_bench [--seconds S]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "radar_protocol.h"
+
+using namespace radar::protocol;
+
+namespace {
+
+/* ATT MTU of the stream, less the notification header */
+constexpr size_t NOTIFICATION_SIZE = 247 - 3;
+
+struct Value {
+    uint32_t (*decode)(const Value &value);    /* with the view of its characteristic */
+    std::vector<uint8_t> bytes;
+};
+
+/**
+ * A value of the schema holding count elements, with random contents.
+ */
+Value make_value(const Schema &schema, uint32_t (*decode)(const Value &value), size_t count, std::mt19937 &random)
+{
+    Value value = {decode, std::vector<uint8_t>(schema.header_size + count * schema.element_size)};
+    for (uint8_t &byte : value.bytes) {
+        byte = static_cast<uint8_t>(random());
+    }
+    if (schema.is_list()) {
+        value.bytes[schema.count_offset] = static_cast<uint8_t>(count);
+    }
+    return value;
+}
+
+size_t fitting(const Schema &schema)
+{
+    size_t count = (NOTIFICATION_SIZE - schema.header_size) / schema.element_size;
+    return count < schema.max_elements() ? count : schema.max_elements();
+}
+
+uint32_t consume(const SweepFrameView &frame)
+{
+    uint32_t total = frame.header().sequence;
+    for (const SweepSample &sample : frame) {
+        total += sample.angle + sample.distance;
+    }
+    return total;
+}
+
+uint32_t consume(const ObjectListView &objects)
+{
+    uint32_t total = objects.header().sweep;
+    for (const SweepObject &object : objects) {
+        total += object.start_angle + object.end_angle + object.min_distance + object.mean_distance;
+    }
+    return total;
+}
+
+uint32_t consume(const TrackListView &tracks)
+{
+    uint32_t total = tracks.header().sweep;
+    for (const ObjectTrack &track : tracks) {
+        total += track.id + track.bearing + track.range + track.velocity + track.hits;
+    }
+    return total;
+}
+
+uint32_t consume(const TraceListView &trace)
+{
+    uint32_t total = trace.header().dropped;
+    for (const TraceRecord &record : trace) {
+        total += record.timestamp_us + record.event + record.a + record.b;
+    }
+    return total;
+}
+
+uint32_t consume(const PolarMapView &map)
+{
+    uint32_t total = map.header().sweep;
+    for (const PolarCell &cell : map) {
+        total += cell.known() ? cell.distance_mm() + cell.age() : 0;
+    }
+    return total;
+}
+
+uint32_t consume(const LinkStatusView &link)
+{
+    LinkStatus status = link.value();
+    return status.att_mtu + status.interval + status.latency;
+}
+
+uint32_t consume(const SampleBufferStatsView &stats)
+{
+    SampleBufferStats value = stats.value();
+    return value.pushed + value.overflows;
+}
+
+uint32_t consume(const DistanceView &distance)
+{
+    return distance.value();
+}
+
+template<typename View>
+uint32_t decode_and_consume(const Payload<View> &payload, const Value &value)
+{
+    View view;
+    if (!decode(payload, value.bytes.data(), value.bytes.size(), view)) {
+        abort();
+    }
+    return consume(view);
+}
+
+volatile uint32_t sink;
+
+struct Result {
+    double values_per_s;
+    double mb_per_s;
+    double ns_per_value;
+};
+
+Result run(const std::vector<Value> &stream, double seconds)
+{
+    size_t bytes = 0;
+    for (const Value &value : stream) {
+        bytes += value.bytes.size();
+    }
+
+    using clock = std::chrono::steady_clock;
+    auto start = clock::now();
+    auto deadline = start + std::chrono::duration<double>(seconds);
+    uint64_t passes = 0;
+    uint32_t total = 0;
+    do {
+        // Checking the clock every pass would be measured as well
+        for (int repeat = 0; repeat < 16; ++repeat) {
+            for (const Value &value : stream) {
+                total += value.decode(value);
+            }
+        }
+        passes += 16;
+    } while (clock::now() < deadline);
+    double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    sink = total;
+
+    double values = static_cast<double>(passes) * stream.size();
+    return Result{values / elapsed, passes * bytes / elapsed / 1e6, elapsed * 1e9 / values};
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 1.0;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--seconds S]\r\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::mt19937 random(1);
+    struct Kind {
+        const Schema &schema;
+        uint32_t (*decode)(const Value &value);
+        size_t count;
+        unsigned share;     /* values of this kind per 100 of the mixed stream */
+    };
+    const Kind kinds[] = {
+        {SWEEP_FRAME, [](const Value &value) { return decode_and_consume(SWEEP_FRAME, value); },
+         fitting(SWEEP_FRAME), 70},
+        {OBJECTS, [](const Value &value) { return decode_and_consume(OBJECTS, value); }, 6, 6},
+        {TRACKS, [](const Value &value) { return decode_and_consume(TRACKS, value); }, 4, 6},
+        {TRACE, [](const Value &value) { return decode_and_consume(TRACE, value); }, fitting(TRACE), 4},
+        // Read on connection rather than notified
+        {POLAR_MAP, [](const Value &value) { return decode_and_consume(POLAR_MAP, value); }, 181, 1},
+        {LINK, [](const Value &value) { return decode_and_consume(LINK, value); }, 0, 1},
+        {BUFFER_STATS, [](const Value &value) { return decode_and_consume(BUFFER_STATS, value); }, 0, 6},
+        {DISTANCE, [](const Value &value) { return decode_and_consume(DISTANCE, value); }, 0, 6},
+    };
+
+    printf("%-14s %12s %10s %10s\n", "", "values/s", "MB/s", "ns/value");
+    std::vector<Value> mixed;
+    for (const Kind &kind : kinds) {
+        std::vector<Value> stream;
+        for (int i = 0; i < 64; ++i) {
+            stream.push_back(make_value(kind.schema, kind.decode, kind.count, random));
+        }
+        Result result = run(stream, seconds / 10);
+        printf("%-14s %12.0f %10.1f %10.1f\n", kind.schema.name, result.values_per_s, result.mb_per_s,
+               result.ns_per_value);
+        for (unsigned i = 0; i < kind.share; ++i) {
+            mixed.push_back(stream[i % stream.size()]);
+        }
+    }
+    std::shuffle(mixed.begin(), mixed.end(), random);
+    Result result = run(mixed, seconds / 2);
+    printf("%-14s %12.0f %10.1f %10.1f\n", "mixed", result.values_per_s, result.mb_per_s, result.ns_per_value);
+
+    return EXIT_SUCCESS;
+}
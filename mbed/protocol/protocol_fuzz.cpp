@@ -0,0 +1,268 @@
+/*
+ * Fuzz target of the radar protocol decoders.
+ *
+ * The first byte of an input picks the characteristic, the rest is its
+ * value. Every decoder must agree with validate(), and a decoded view must
+ * cover exactly the value; all its fields are read so that the sanitizers
+ * see any access outside the input. The input is also parsed as a UUID,
+ * and read as a serial stream: every frame decoded from it must encode back
+ * to itself, and the value must go through a serial frame unchanged.
+ *
+ * Built with libFuzzer when RADAR_PROTOCOL_LIBFUZZER is defined (clang,
+ * -fsanitize=fuzzer). Otherwise a standalone driver runs the files given
+ * on the command line, or random mutations of valid values:
+ *
+ *     radar_protocol_fuzz [--runs N] [--seed S] [FILE...]
+ */
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "radar_protocol.h"
+#include "serial_protocol.h"
+
+using namespace radar::protocol;
+
+namespace {
+
+volatile uint32_t sink;
+
+uint32_t sum(const void *data, size_t size)
+{
+    uint32_t total = 0;
+    const uint8_t *bytes = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        total += bytes[i];
+    }
+    return total;
+}
+
+template<typename T>
+void read_all(const ValueView<T> &view, const uint8_t *data, size_t size)
+{
+    T value = view.value();
+    sink += sum(&value, sizeof(value));
+}
+
+template<typename Header, typename Element>
+void read_all(const ListView<Header, Element> &view, const uint8_t *data, size_t size)
+{
+    if (reinterpret_cast<const uint8_t *>(&view.header()) != data ||
+        reinterpret_cast<const uint8_t *>(view.end()) != data + size) {
+        abort();
+    }
+    sink += sum(&view.header(), sizeof(Header));
+    for (const Element &element : view) {
+        sink += sum(&element, sizeof(element));
+    }
+}
+
+template<typename View>
+void check(const Payload<View> &payload, const uint8_t *data, size_t size)
+{
+    View view;
+    bool decoded = decode(payload, data, size, view);
+    if (decoded != validate(payload, data, size)) {
+        abort();
+    }
+    if (decoded) {
+        read_all(view, data, size);
+    }
+}
+
+/* One per schema, in the order of SCHEMAS */
+void (*const CHECKS[])(const uint8_t *, size_t) = {
+    [](const uint8_t *data, size_t size) { check(ANGLE, data, size); },
+    [](const uint8_t *data, size_t size) { check(DISTANCE, data, size); },
+    [](const uint8_t *data, size_t size) { check(RUNNING, data, size); },
+    [](const uint8_t *data, size_t size) { check(THRESHOLD, data, size); },
+    [](const uint8_t *data, size_t size) { check(SWEEP_FRAME, data, size); },
+    [](const uint8_t *data, size_t size) { check(BUFFER_STATS, data, size); },
+    [](const uint8_t *data, size_t size) { check(FILTER, data, size); },
+    [](const uint8_t *data, size_t size) { check(MAX_RANGE, data, size); },
+    [](const uint8_t *data, size_t size) { check(SERVO_TIMING, data, size); },
+    [](const uint8_t *data, size_t size) { check(POLAR_MAP, data, size); },
+    [](const uint8_t *data, size_t size) { check(BACKGROUND, data, size); },
+    [](const uint8_t *data, size_t size) { check(OBJECTS, data, size); },
+    [](const uint8_t *data, size_t size) { check(TRACKS, data, size); },
+    [](const uint8_t *data, size_t size) { check(LINK, data, size); },
+    [](const uint8_t *data, size_t size) { check(TRACE, data, size); },
+    [](const uint8_t *data, size_t size) { check(PROFILE, data, size); },
+    [](const uint8_t *data, size_t size) { check(CALIBRATION, data, size); },
+};
+
+static_assert(sizeof(CHECKS) / sizeof(CHECKS[0]) == SCHEMA_COUNT, "a check per schema");
+
+/**
+ * Decode the frames of data and check that each one encodes back to a
+ * frame decoding to the same header and value.
+ */
+size_t check_serial_stream(const uint8_t *data, size_t size)
+{
+    SerialFrameDecoder decoder;
+    size_t frames = 0;
+    for (size_t i = 0; i < size; ++i) {
+        if (!decoder.push(data[i])) {
+            continue;
+        }
+        if (decoder.size() > MAX_ATTRIBUTE_SIZE) {
+            abort();
+        }
+        std::vector<uint8_t> value(decoder.value(), decoder.value() + decoder.size());
+        SerialFrameHeader header = decoder.header();
+        uint8_t encoded[SERIAL_ENCODED_MAX_SIZE];
+        size_t encoded_size = encode_serial_frame(header, value.data(), value.size(), encoded);
+        if (encoded_size > serial_frame_encoded_size(value.size()) ||
+            memchr(encoded, SERIAL_DELIMITER, encoded_size - 1)) {
+            abort();
+        }
+
+        SerialFrameDecoder again;
+        size_t decoded = 0;
+        for (size_t j = 0; j < encoded_size; ++j) {
+            decoded += again.push(encoded[j]);
+        }
+        if (decoded != 1 || again.size() != value.size() || memcmp(&again.header(), &header, sizeof(header)) ||
+            memcmp(again.value(), value.data(), value.size())) {
+            abort();
+        }
+        ++frames;
+    }
+    return frames;
+}
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (!size) {
+        return 0;
+    }
+
+    // A copy of its own size, so that reading past the value is caught
+    std::vector<uint8_t> value(data + 1, data + size);
+    CHECKS[data[0] % SCHEMA_COUNT](value.data(), value.size());
+
+    sink += check_serial_stream(data, size);
+    if (value.size() <= MAX_ATTRIBUTE_SIZE) {
+        uint8_t frame[SERIAL_ENCODED_MAX_SIZE];
+        SerialFrameHeader header = {static_cast<uint8_t>(SerialFrameType::Value), 0, data[0]};
+        if (check_serial_stream(frame, encode_serial_frame(header, value.data(), value.size(), frame)) != 1) {
+            abort();
+        }
+    }
+
+    std::vector<char> text(data, data + size);
+    text.push_back('\0');
+    const Schema *schema = find_schema(parse_uuid(text.data()));
+    sink += schema ? schema->header_size : 0;
+    return 0;
+}
+
+#ifndef RADAR_PROTOCOL_LIBFUZZER
+
+namespace {
+
+/**
+ * A valid value of the schema, lists with a random element count.
+ */
+std::vector<uint8_t> valid_value(const Schema &schema, std::mt19937 &random)
+{
+    std::vector<uint8_t> value(schema.header_size);
+    for (uint8_t &byte : value) {
+        byte = static_cast<uint8_t>(random());
+    }
+    if (schema.is_list()) {
+        size_t count = random() % (schema.max_elements() + 1);
+        value[schema.count_offset] = static_cast<uint8_t>(count);
+        value.resize(schema.header_size + count * schema.element_size, static_cast<uint8_t>(random()));
+    }
+    return value;
+}
+
+void mutate(std::vector<uint8_t> &input, std::mt19937 &random)
+{
+    switch (random() % 4) {
+        case 0:
+            // Keep it valid
+            break;
+        case 1:
+            if (input.size() > 1) {
+                input[1 + random() % (input.size() - 1)] = static_cast<uint8_t>(random());
+            }
+            break;
+        case 2:
+            input.resize(1 + random() % input.size());
+            break;
+        case 3:
+            input.resize(input.size() + 1 + random() % 16, static_cast<uint8_t>(random()));
+            break;
+    }
+}
+
+bool run_file(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> input;
+    uint8_t buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        input.insert(input.end(), buffer, buffer + length);
+    }
+    fclose(file);
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+    return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long runs = 1000000;
+    unsigned long seed = 1;
+    std::vector<const char *> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--runs") && i + 1 < argc) {
+            runs = strtoul(argv[++i], nullptr, 10);
+        } else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 10);
+        } else if (argv[i][0] != '-') {
+            paths.push_back(argv[i]);
+        } else {
+            fprintf(stderr, "usage: %s [--runs N] [--seed S] [FILE...]\r\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (const char *path : paths) {
+        if (!run_file(path)) {
+            fprintf(stderr, "cannot read %s\r\n", path);
+            return EXIT_FAILURE;
+        }
+    }
+    if (!paths.empty()) {
+        fprintf(stderr, "%zu inputs run\r\n", paths.size());
+        return EXIT_SUCCESS;
+    }
+
+    std::mt19937 random(seed);
+    unsigned long decoded = 0;
+    for (unsigned long run = 0; run < runs; ++run) {
+        size_t index = random() % SCHEMA_COUNT;
+        std::vector<uint8_t> input(1, static_cast<uint8_t>(index));
+        std::vector<uint8_t> value = valid_value(SCHEMAS[index], random);
+        input.insert(input.end(), value.begin(), value.end());
+        mutate(input, random);
+        decoded += validate(SCHEMAS[index], input.data() + 1, input.size() - 1);
+        LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    fprintf(stderr, "%lu inputs run, %lu valid\r\n", runs, decoded);
+    return EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,609 @@
+/*
+ * GATT protocol of the radar service.
+ *
+ * The UUIDs, properties and value layouts of every radar characteristic
+ * are defined here once: the firmware declares its characteristics and
+ * fills its values from these definitions, host consumers (simulator,
+ * gateways, tools) decode notifications and reads with them.
+ *
+ * Header only, C++14, without dependency on mbed so that it builds on any
+ * host. Values are little endian and packed.
+ *
+ * A characteristic is described by a constexpr Payload: its Schema (name,
+ * UUID, properties, fixed header and element sizes) and the view type its
+ * values decode to. Views point into the decoded buffer, nothing is copied:
+ *
+ *     radar::protocol::SweepFrameView frame;
+ *     if (radar::protocol::decode(radar::protocol::SWEEP_FRAME, data, size, frame)) {
+ *         for (const radar::protocol::SweepSample &sample : frame) {
+ *             ...
+ *         }
+ *     }
+ *
+ * Decoding checks the length of the value against the schema and the
+ * element count it carries, a view never reaches past the buffer.
+ */
+#ifndef RADAR_PROTOCOL_H
+#define RADAR_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace radar {
+namespace protocol {
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "radar values are little endian and read in place");
+
+/* Longest attribute value */
+constexpr size_t MAX_ATTRIBUTE_SIZE = 512;
+
+/* ATT MTU in use before any exchange */
+constexpr uint16_t DEFAULT_ATT_MTU = 23;
+/* opcode and handle of a notification */
+constexpr uint16_t NOTIFICATION_OVERHEAD = 3;
+
+/**
+ * Bytes left for the elements of a list notified at att_mtu, after its
+ * header of header_size bytes.
+ */
+constexpr size_t notification_payload(uint16_t att_mtu, size_t header_size)
+{
+    return att_mtu > NOTIFICATION_OVERHEAD + header_size ? att_mtu - NOTIFICATION_OVERHEAD - header_size : 0;
+}
+
+/* Characteristic properties, as declared in GATT */
+constexpr uint8_t PROPERTY_READ = 0x02;
+constexpr uint8_t PROPERTY_WRITE = 0x08;
+constexpr uint8_t PROPERTY_NOTIFY = 0x10;
+constexpr uint8_t PROPERTY_INDICATE = 0x20;
+
+constexpr char SERVICE_UUID[] = "51311102-030e-485f-b122-f8f381aa84ed";
+
+/* Stages of the cycle profile, see ProfileStage in the firmware */
+constexpr size_t PROFILE_STAGES = 6;
+/* log2 histogram: bucket 0 counts durations under 2^9 cycles, bucket i the
+ * ones from 2^(i + 8) to 2^(i + 9) and the last one everything longer */
+constexpr size_t PROFILE_BUCKETS = 16;
+constexpr uint8_t PROFILE_FIRST_BUCKET_LOG2 = 9;
+
+/* Polar map cell: distance in the low bits, sweeps since the update above */
+constexpr uint16_t POLAR_CELL_UNKNOWN = 0x0FFF;
+constexpr uint16_t POLAR_CELL_MAX_AGE = 15;
+constexpr unsigned POLAR_CELL_AGE_SHIFT = 12;
+
+/* Temperature of a SoundCalibration nobody measured or wrote */
+constexpr int16_t TEMPERATURE_UNKNOWN = INT16_MIN;
+/* SoundCalibration::flags: where the speed of sound in use comes from */
+constexpr uint8_t CALIBRATION_TEMPERATURE = 0x01;   /* compensated for the temperature */
+constexpr uint8_t CALIBRATION_THERMOMETER = 0x02;   /* the temperature is measured by the board */
+constexpr uint8_t CALIBRATION_REFERENCE = 0x04;     /* measured on the reference reflector */
+constexpr uint8_t CALIBRATION_PENDING = 0x08;       /* the reference reflector is being measured */
+constexpr uint8_t CALIBRATION_FAILED = 0x10;        /* the last measurement of the reference was rejected */
+
+#pragma pack(push, 1)
+
+/**
+ * Sample of a sweep frame.
+ */
+struct SweepSample {
+    uint8_t angle;          /* degrees */
+    uint16_t distance;      /* mm */
+};
+
+/**
+ * Header of a sweep frame, followed by count SweepSample.
+ */
+struct SweepFrameHeader {
+    uint16_t sequence;      /* incremented for every frame sent */
+    uint16_t sweep;         /* sweep the samples were measured in */
+    uint8_t count;          /* number of samples in the frame */
+};
+
+/**
+ * Health of the sample buffer, as exposed to clients.
+ */
+struct SampleBufferStats {
+    uint32_t pushed;            /* samples produced */
+    uint32_t overflows;         /* samples dropped, the radio did not keep up */
+    uint16_t high_watermark;    /* most samples waiting at once */
+    uint16_t capacity;
+};
+
+/**
+ * Filter settings, as exchanged with clients.
+ */
+struct DistanceFilterConfig {
+    uint8_t median_window;  /* readings in the sliding median, 1 disables it */
+    uint8_t ema_weight;     /* weight of a new median in the average, /256, 0 disables it */
+};
+
+/**
+ * Timing of the servo, as exchanged with clients.
+ */
+struct ServoTiming {
+    uint16_t slew_us_per_deg;   /* travel time per degree */
+    uint16_t settle_us;         /* ringing once the travel is over */
+};
+
+/**
+ * Header of the polar map, followed by one PolarCell per angle bin.
+ */
+struct PolarMapHeader {
+    uint16_t sweep;         /* sweeps completed when the map was last updated */
+    uint8_t bins;           /* number of cells, one per degree from 0 */
+};
+
+/**
+ * Cell of the polar map.
+ */
+struct PolarCell {
+    uint16_t value;
+
+    bool known() const
+    {
+        return (value & POLAR_CELL_UNKNOWN) != POLAR_CELL_UNKNOWN;
+    }
+
+    uint16_t distance_mm() const
+    {
+        return value & POLAR_CELL_UNKNOWN;
+    }
+
+    /* sweeps since the bin was measured, saturated at POLAR_CELL_MAX_AGE */
+    uint8_t age() const
+    {
+        return static_cast<uint8_t>(value >> POLAR_CELL_AGE_SHIFT);
+    }
+};
+
+/**
+ * Settings of the background subtraction, as exchanged with clients.
+ */
+struct BackgroundConfig {
+    uint16_t margin_mm;         /* change from the background worth sending, 0 sends everything */
+    uint8_t keyframe_sweeps;    /* a full sweep is sent every keyframe_sweeps, 0 never */
+};
+
+/**
+ * Object found by a sweep, as exchanged with clients.
+ */
+struct SweepObject {
+    uint8_t start_angle;    /* degrees */
+    uint8_t end_angle;      /* degrees, inclusive */
+    uint16_t min_distance;  /* mm */
+    uint16_t mean_distance; /* mm */
+};
+
+/**
+ * Header of an object list, followed by count SweepObject.
+ */
+struct ObjectListHeader {
+    uint16_t sweep;         /* sweep the objects were seen in */
+    uint8_t count;          /* objects in the list, nearest first */
+    uint8_t total;          /* objects found, the farthest ones may not fit */
+};
+
+/**
+ * Track of an object, as exchanged with clients.
+ */
+struct ObjectTrack {
+    uint8_t id;             /* stable across sweeps, never 0 */
+    uint8_t bearing;        /* degrees, centre of the object */
+    uint16_t range;         /* mm, nearest point */
+    int16_t velocity;       /* mm/s, negative when approaching */
+    uint8_t hits;           /* sweeps the object was seen in, saturated */
+};
+
+/**
+ * Header of a track list, followed by count ObjectTrack.
+ */
+struct TrackListHeader {
+    uint16_t sweep;         /* sweep the tracks were updated with */
+    uint8_t count;          /* tracks in the list, nearest first */
+};
+
+/**
+ * Parameters of the link in use, as exchanged with clients.
+ */
+struct LinkStatus {
+    uint16_t att_mtu;       /* bytes, a notification carries att_mtu - 3 */
+    uint16_t tx_octets;     /* largest link layer payload sent */
+    uint16_t rx_octets;     /* largest link layer payload received */
+    uint8_t tx_phy;         /* 1: 1M, 2: 2M, 3: coded */
+    uint8_t rx_phy;
+    uint16_t interval;      /* connection interval, 1.25 ms units */
+    uint16_t latency;       /* connection events the peripheral may skip */
+};
+
+/**
+ * One traced event as stored and sent to clients.
+ */
+struct TraceRecord {
+    uint32_t timestamp_us;
+    uint8_t event;          /* TraceEvent */
+    uint8_t level;
+    uint16_t a;
+    uint32_t b;
+};
+
+/**
+ * Header of a batch of trace records.
+ */
+struct TraceListHeader {
+    uint16_t dropped;       /* records lost to a full buffer since boot, saturated */
+    uint8_t count;
+};
+
+/**
+ * Cycle counts of one stage as exchanged with clients.
+ */
+struct StageProfile {
+    uint32_t count;
+    uint32_t min_cycles;
+    uint32_t max_cycles;
+    uint32_t mean_cycles;
+    uint16_t histogram[PROFILE_BUCKETS];    /* saturated */
+};
+
+/**
+ * Header of the profile, followed by one StageProfile per stage.
+ */
+struct ProfileHeader {
+    uint32_t core_hz;           /* cycles per second */
+    uint8_t stages;
+    uint8_t buckets;
+    uint8_t first_bucket_log2;  /* bucket 1 starts at 2^first_bucket_log2 cycles */
+};
+
+/**
+ * Calibration of the speed of sound, as exchanged with clients.
+ *
+ * A write sets the air temperature unless TEMPERATURE_UNKNOWN, and starts a
+ * measurement of the reference reflector unless reference_mm is 0; a write
+ * of neither restores the speed of sound at 20 degrees Celsius. Flags and
+ * sound_speed are ignored.
+ */
+struct SoundCalibration {
+    int16_t temperature;        /* air temperature, 0.01 degree Celsius */
+    uint16_t reference_mm;      /* distance of the reference reflector, 0 if none */
+    uint8_t reference_angle;    /* degrees, bearing of the reference reflector */
+    uint8_t flags;              /* CALIBRATION_* */
+    uint32_t sound_speed;       /* mm/s, in use */
+};
+
+#pragma pack(pop)
+
+/**
+ * 128 bit UUID, bytes in the order they are written.
+ */
+struct Uuid {
+    uint8_t bytes[16];
+
+    bool operator==(const Uuid &other) const
+    {
+        return memcmp(bytes, other.bytes, sizeof(bytes)) == 0;
+    }
+};
+
+constexpr int hex_digit(char c)
+{
+    return c >= '0' && c <= '9' ? c - '0' :
+           c >= 'a' && c <= 'f' ? c - 'a' + 10 :
+           c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+/**
+ * UUID of its "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx" form, all zero if
+ * malformed.
+ */
+constexpr Uuid parse_uuid(const char *text)
+{
+    Uuid uuid = {};
+    size_t byte = 0;
+    for (size_t i = 0; text[i] && byte < sizeof(uuid.bytes); ++i) {
+        if (text[i] == '-') {
+            continue;
+        }
+        int high = hex_digit(text[i]);
+        int low = text[i + 1] ? hex_digit(text[i + 1]) : -1;
+        if (high < 0 || low < 0) {
+            return Uuid{};
+        }
+        uuid.bytes[byte++] = static_cast<uint8_t>(high << 4 | low);
+        ++i;
+    }
+    return byte == sizeof(uuid.bytes) ? uuid : Uuid{};
+}
+
+/**
+ * Layout of a characteristic value: a fixed size value, or a header
+ * followed by the number of elements given by its count byte.
+ */
+struct Schema {
+    const char *name;
+    const char *uuid;
+    uint8_t properties;
+    uint16_t header_size;       /* the whole value when element_size is 0 */
+    uint16_t element_size;
+    uint16_t count_offset;      /* of the element count, a byte of the header */
+
+    constexpr bool is_list() const
+    {
+        return element_size != 0;
+    }
+
+    /* as many as fit in an attribute value and the count byte */
+    constexpr size_t max_elements() const
+    {
+        return !is_list() ? 0 :
+               (MAX_ATTRIBUTE_SIZE - header_size) / element_size > UINT8_MAX ? UINT8_MAX :
+               (MAX_ATTRIBUTE_SIZE - header_size) / element_size;
+    }
+
+    constexpr size_t max_size() const
+    {
+        return header_size + max_elements() * element_size;
+    }
+};
+
+/**
+ * Check a value against a schema without decoding it.
+ */
+inline bool validate(const Schema &schema, const uint8_t *data, size_t size)
+{
+    if (!schema.is_list()) {
+        return size == schema.header_size;
+    }
+    if (size < schema.header_size) {
+        return false;
+    }
+    size_t count = data[schema.count_offset];
+    return count <= schema.max_elements() && size == schema.header_size + count * schema.element_size;
+}
+
+/**
+ * Schema of a characteristic tied to the view its values decode to.
+ */
+template<typename View>
+struct Payload : Schema {
+    constexpr Payload(const Schema &schema) : Schema(schema)
+    {
+    }
+};
+
+/**
+ * Fixed size value, copied out on access as it may not be aligned.
+ */
+template<typename T>
+class ValueView {
+public:
+    static bool decode(const Schema &schema, const uint8_t *data, size_t size, ValueView &view)
+    {
+        if (!validate(schema, data, size)) {
+            return false;
+        }
+        view._data = data;
+        return true;
+    }
+
+    T value() const
+    {
+        T value;
+        memcpy(&value, _data, sizeof(value));
+        return value;
+    }
+
+private:
+    const uint8_t *_data = nullptr;
+};
+
+/**
+ * Header and elements of a list value, in place.
+ *
+ * Header and Element are packed, they can be read through the view
+ * whatever the alignment of the buffer.
+ */
+template<typename Header, typename Element>
+class ListView {
+public:
+    static bool decode(const Schema &schema, const uint8_t *data, size_t size, ListView &view)
+    {
+        if (!validate(schema, data, size)) {
+            return false;
+        }
+        view._header = reinterpret_cast<const Header *>(data);
+        view._elements = reinterpret_cast<const Element *>(data + schema.header_size);
+        view._count = data[schema.count_offset];
+        return true;
+    }
+
+    const Header &header() const
+    {
+        return *_header;
+    }
+
+    size_t size() const
+    {
+        return _count;
+    }
+
+    bool empty() const
+    {
+        return _count == 0;
+    }
+
+    const Element &operator[](size_t i) const
+    {
+        return _elements[i];
+    }
+
+    const Element *begin() const
+    {
+        return _elements;
+    }
+
+    const Element *end() const
+    {
+        return _elements + _count;
+    }
+
+private:
+    const Header *_header = nullptr;
+    const Element *_elements = nullptr;
+    size_t _count = 0;
+};
+
+template<typename T>
+constexpr Payload<ValueView<T>> value_payload(const char *name, const char *uuid, uint8_t properties)
+{
+    return Schema{name, uuid, properties, sizeof(T), 0, 0};
+}
+
+template<typename Header, typename Element>
+constexpr Payload<ListView<Header, Element>> list_payload(const char *name, const char *uuid, uint8_t properties,
+                                                           size_t count_offset)
+{
+    return Schema{name, uuid, properties, sizeof(Header), sizeof(Element), static_cast<uint16_t>(count_offset)};
+}
+
+using AngleView = ValueView<uint8_t>;
+using DistanceView = ValueView<uint16_t>;
+using RunningView = ValueView<uint8_t>;
+using ThresholdView = ValueView<uint8_t>;
+using MaxRangeView = ValueView<uint16_t>;
+using SampleBufferStatsView = ValueView<SampleBufferStats>;
+using DistanceFilterConfigView = ValueView<DistanceFilterConfig>;
+using ServoTimingView = ValueView<ServoTiming>;
+using BackgroundConfigView = ValueView<BackgroundConfig>;
+using LinkStatusView = ValueView<LinkStatus>;
+using SoundCalibrationView = ValueView<SoundCalibration>;
+using SweepFrameView = ListView<SweepFrameHeader, SweepSample>;
+using PolarMapView = ListView<PolarMapHeader, PolarCell>;
+using ObjectListView = ListView<ObjectListHeader, SweepObject>;
+using TrackListView = ListView<TrackListHeader, ObjectTrack>;
+using TraceListView = ListView<TraceListHeader, TraceRecord>;
+using ProfileView = ListView<ProfileHeader, StageProfile>;
+
+/* What the legacy characteristics allow, clients may write any of them */
+constexpr uint8_t PROPERTIES_ALL = PROPERTY_READ | PROPERTY_WRITE | PROPERTY_NOTIFY | PROPERTY_INDICATE;
+constexpr uint8_t PROPERTIES_CONFIG = PROPERTY_READ | PROPERTY_WRITE;
+constexpr uint8_t PROPERTIES_STREAM = PROPERTY_READ | PROPERTY_NOTIFY;
+
+/* Last angle measured, degrees */
+constexpr auto ANGLE = value_payload<uint8_t>(
+    "angle", "485f4145-52b9-4644-af1f-7a6b9322490f", PROPERTIES_ALL
+);
+/* Last distance measured, mm */
+constexpr auto DISTANCE = value_payload<uint16_t>(
+    "distance", "0a924ca7-87cd-4699-a3bd-abdcd9cf126a", PROPERTIES_ALL
+);
+/* Sweeping when not 0 */
+constexpr auto RUNNING = value_payload<uint8_t>(
+    "running", "8dd6a1b7-bc75-4741-8a26-264af75807de", PROPERTIES_ALL
+);
+/* The LED lights up for echoes closer than this, cm */
+constexpr auto THRESHOLD = value_payload<uint8_t>(
+    "threshold", "beb5483e-36e1-4688-b7f5-ea07361b26a8", PROPERTIES_ALL
+);
+constexpr auto SWEEP_FRAME = list_payload<SweepFrameHeader, SweepSample>(
+    "sweep frame", "c1a9e5d2-4b7f-4e36-9d0a-3f8b6e2c71a4", PROPERTIES_STREAM, offsetof(SweepFrameHeader, count)
+);
+constexpr auto BUFFER_STATS = value_payload<SampleBufferStats>(
+    "buffer stats", "5e3b0f7a-2c41-4d8e-b6a9-81f4c0d2e357", PROPERTIES_STREAM
+);
+constexpr auto FILTER = value_payload<DistanceFilterConfig>(
+    "filter", "7d2c9a61-3e58-4f0b-a4c7-52e1b9d8f036", PROPERTIES_CONFIG
+);
+/* Farthest echo reported, mm */
+constexpr auto MAX_RANGE = value_payload<uint16_t>(
+    "max range", "a4e1c3f8-6b2d-4a97-8e05-d9c2b7f1a360", PROPERTIES_CONFIG
+);
+constexpr auto SERVO_TIMING = value_payload<ServoTiming>(
+    "servo timing", "3f6b8d2e-95c4-4a1b-bf73-0e8a2d5c914b", PROPERTIES_CONFIG
+);
+constexpr auto POLAR_MAP = list_payload<PolarMapHeader, PolarCell>(
+    "polar map", "9b7e2f14-6c3a-4d85-a1f0-3e6d8c2b5a97", PROPERTY_READ, offsetof(PolarMapHeader, bins)
+);
+constexpr auto BACKGROUND = value_payload<BackgroundConfig>(
+    "background", "e62d7a4b-1f93-4c58-9b0e-7a3c5d8f2e16", PROPERTIES_CONFIG
+);
+constexpr auto OBJECTS = list_payload<ObjectListHeader, SweepObject>(
+    "objects", "2c8f5e91-7a4d-4b36-8e1c-5d9a3f6b0e72", PROPERTIES_STREAM, offsetof(ObjectListHeader, count)
+);
+constexpr auto TRACKS = list_payload<TrackListHeader, ObjectTrack>(
+    "tracks", "6a1d4f83-2b9e-4c07-95e8-d3f6a0c7b142", PROPERTIES_STREAM, offsetof(TrackListHeader, count)
+);
+constexpr auto LINK = value_payload<LinkStatus>(
+    "link", "d0c4a7e2-5b19-4f63-8a2d-1e7b9c3f6a85", PROPERTIES_STREAM
+);
+constexpr auto TRACE = list_payload<TraceListHeader, TraceRecord>(
+    "trace", "f3a85c1e-0d7b-4e92-b6c4-8a1f5e2d9b03", PROPERTIES_STREAM, offsetof(TraceListHeader, count)
+);
+/* A write of any value starts a new profile */
+constexpr auto PROFILE = list_payload<ProfileHeader, StageProfile>(
+    "profile", "84c2e9f0-3a6d-4b15-97e8-c0d4f1a25b63", PROPERTIES_CONFIG, offsetof(ProfileHeader, stages)
+);
+
+/* Notified when a measurement of the reference reflector is over */
+constexpr auto CALIBRATION = value_payload<SoundCalibration>(
+    "calibration", "b85e1d36-4f0a-4c92-a7d3-6e2f9c0b1a58", PROPERTIES_CONFIG | PROPERTY_NOTIFY
+);
+
+/* Every characteristic, in the order of the service */
+constexpr Schema SCHEMAS[] = {
+    ANGLE, DISTANCE, RUNNING, THRESHOLD, SWEEP_FRAME, BUFFER_STATS, FILTER, MAX_RANGE,
+    SERVO_TIMING, POLAR_MAP, BACKGROUND, OBJECTS, TRACKS, LINK, TRACE, PROFILE,
+    CALIBRATION
+};
+constexpr size_t SCHEMA_COUNT = sizeof(SCHEMAS) / sizeof(SCHEMAS[0]);
+
+/**
+ * Position of the characteristic in SCHEMAS, SCHEMA_COUNT if it is not one
+ * of the service.
+ */
+constexpr size_t schema_index(const Schema &schema)
+{
+    for (size_t i = 0; i < SCHEMA_COUNT; ++i) {
+        const char *a = SCHEMAS[i].uuid;
+        const char *b = schema.uuid;
+        while (*a && *a == *b) {
+            ++a;
+            ++b;
+        }
+        if (*a == *b) {
+            return i;
+        }
+    }
+    return SCHEMA_COUNT;
+}
+
+/**
+ * Decode a value of payload, the view points into data.
+ *
+ * @return false if size does not match the layout.
+ */
+template<typename View>
+bool decode(const Payload<View> &payload, const uint8_t *data, size_t size, View &view)
+{
+    return View::decode(payload, data, size, view);
+}
+
+/**
+ * Schema of the characteristic with this UUID, nullptr if it is not one of
+ * the service.
+ */
+inline const Schema *find_schema(const Uuid &uuid)
+{
+    for (const Schema &schema : SCHEMAS) {
+        if (parse_uuid(schema.uuid) == uuid) {
+            return &schema;
+        }
+    }
+    return nullptr;
+}
+
+}
+}
+
+#endif // RADAR_PROTOCOL_H
@@ -0,0 +1,338 @@
+/*
+ * Framing of the radar characteristics over a serial line.
+ *
+ * Wired radars stream the values of their characteristics over a UART
+ * instead of notifying them over BLE. Each value travels in a frame naming
+ * the characteristic by its index in SCHEMAS:
+ *
+ *   host -> radar   Write (value), Read
+ *   radar -> host   Value (value), streamed or in reply to a Read
+ *
+ * On the wire a frame is a SerialFrameHeader, the value and the CRC-16 of
+ * both (CCITT, little endian), COBS encoded and followed by a 0 delimiter.
+ * The delimiter never appears inside a frame, a receiver joining the stream
+ * or losing bytes resynchronizes on the next one and the CRC rejects what
+ * was cut.
+ *
+ * Header only, C++14, without dependency on mbed like radar_protocol.h.
+ */
+#ifndef RADAR_SERIAL_PROTOCOL_H
+#define RADAR_SERIAL_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "radar_protocol.h"
+
+namespace radar {
+namespace protocol {
+
+enum class SerialFrameType : uint8_t {
+    Write = 2,
+    Read = 3,
+    Value = 4,
+};
+
+/* SerialFrameHeader::flags of a Value */
+constexpr uint8_t SERIAL_VALUE_READ = 0x01;     /* the reply to a Read, streamed otherwise */
+
+#pragma pack(push, 1)
+
+struct SerialFrameHeader {
+    uint8_t type;           /* SerialFrameType */
+    uint8_t flags;
+    uint8_t characteristic; /* index in SCHEMAS */
+};
+
+#pragma pack(pop)
+
+constexpr uint8_t SERIAL_DELIMITER = 0x00;
+
+/* Longest frame before encoding: header, value and CRC */
+constexpr size_t SERIAL_FRAME_MAX_SIZE = sizeof(SerialFrameHeader) + MAX_ATTRIBUTE_SIZE + sizeof(uint16_t);
+
+/**
+ * Most bytes COBS makes of size bytes: one code byte per block of 254.
+ */
+constexpr size_t cobs_max_size(size_t size)
+{
+    return size + size / 254 + 1;
+}
+
+/**
+ * Most bytes sent for a value of size bytes, delimiter included.
+ */
+constexpr size_t serial_frame_encoded_size(size_t size)
+{
+    return cobs_max_size(sizeof(SerialFrameHeader) + size + sizeof(uint16_t)) + 1;
+}
+
+constexpr size_t SERIAL_ENCODED_MAX_SIZE = serial_frame_encoded_size(MAX_ATTRIBUTE_SIZE);
+
+/* CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF */
+constexpr uint16_t CRC16_INIT = 0xFFFF;
+
+struct Crc16Table {
+    uint16_t entries[256];
+};
+
+constexpr Crc16Table make_crc16_table()
+{
+    Crc16Table table = {};
+    for (unsigned i = 0; i < 256; ++i) {
+        uint16_t crc = static_cast<uint16_t>(i << 8);
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = static_cast<uint16_t>(crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1);
+        }
+        table.entries[i] = crc;
+    }
+    return table;
+}
+
+constexpr Crc16Table CRC16_TABLE = make_crc16_table();
+
+/**
+ * CRC of size bytes, continuing from crc.
+ */
+inline uint16_t crc16(const uint8_t *data, size_t size, uint16_t crc = CRC16_INIT)
+{
+    for (size_t i = 0; i < size; ++i) {
+        crc = static_cast<uint16_t>(crc << 8) ^ CRC16_TABLE.entries[(crc >> 8) ^ data[i]];
+    }
+    return crc;
+}
+
+/**
+ * COBS encoder writing a frame piece by piece.
+ *
+ * Each block starts with a code byte: the distance to the next 0 of the
+ * input, or 0xFF for 254 bytes without any 0. The code of a block is
+ * written once the block is over.
+ */
+class CobsEncoder {
+public:
+    /**
+     * @param dst room for cobs_max_size() of everything put.
+     */
+    explicit CobsEncoder(uint8_t *dst) :
+        _dst(dst)
+    {
+        open();
+    }
+
+    void put(uint8_t byte)
+    {
+        if (!_open) {
+            open();
+        }
+        if (byte) {
+            _dst[_size++] = byte;
+            if (++_code == 0xFF) {
+                close();
+            }
+        } else {
+            // The 0 is implied by the end of the block
+            close();
+            open();
+        }
+    }
+
+    void put(const uint8_t *data, size_t size)
+    {
+        for (size_t i = 0; i < size; ++i) {
+            put(data[i]);
+        }
+    }
+
+    /**
+     * Close the last block.
+     *
+     * @return size of the encoded bytes.
+     */
+    size_t finish()
+    {
+        if (_open) {
+            close();
+        }
+        return _size;
+    }
+
+private:
+    void open()
+    {
+        _code_at = _size++;
+        _code = 1;
+        _open = true;
+    }
+
+    void close()
+    {
+        _dst[_code_at] = _code;
+        _open = false;
+    }
+
+    uint8_t *_dst;
+    size_t _size = 0;
+    size_t _code_at = 0;
+    uint8_t _code = 1;
+    bool _open = false;
+};
+
+/**
+ * Encode a frame into dst, which has room for serial_frame_encoded_size()
+ * of the value.
+ *
+ * @return bytes to send, delimiter included.
+ */
+inline size_t encode_serial_frame(const SerialFrameHeader &header, const uint8_t *value, size_t size, uint8_t *dst)
+{
+    const uint8_t *header_bytes = reinterpret_cast<const uint8_t *>(&header);
+    uint16_t crc = crc16(value, size, crc16(header_bytes, sizeof(header)));
+    uint8_t trailer[sizeof(crc)] = {static_cast<uint8_t>(crc), static_cast<uint8_t>(crc >> 8)};
+
+    CobsEncoder encoder(dst);
+    encoder.put(header_bytes, sizeof(header));
+    encoder.put(value, size);
+    encoder.put(trailer, sizeof(trailer));
+    size_t encoded = encoder.finish();
+    dst[encoded] = SERIAL_DELIMITER;
+    return encoded + 1;
+}
+
+/**
+ * Frames out of the bytes received, one byte at a time.
+ *
+ * Bytes are COBS decoded as they come, a frame is checked when its
+ * delimiter arrives. Frames too long, malformed or failing their CRC are
+ * dropped and counted.
+ */
+class SerialFrameDecoder {
+public:
+    /**
+     * @return true if byte completes a valid frame, its header and value
+     * are then valid until the next push().
+     */
+    bool push(uint8_t byte)
+    {
+        if (byte == SERIAL_DELIMITER) {
+            return end_frame();
+        }
+        if (_discard) {
+            return false;
+        }
+
+        if (!_remaining) {
+            // Code byte, the previous block ended with an implied 0 unless it was full
+            if (_started && _code != 0xFF && !append(0)) {
+                return false;
+            }
+            _code = byte;
+            _remaining = byte - 1;
+            _started = true;
+            return false;
+        }
+
+        --_remaining;
+        append(byte);
+        return false;
+    }
+
+    const SerialFrameHeader &header() const
+    {
+        return *reinterpret_cast<const SerialFrameHeader *>(_frame);
+    }
+
+    const uint8_t *value() const
+    {
+        return _frame + sizeof(SerialFrameHeader);
+    }
+
+    size_t size() const
+    {
+        return _value_size;
+    }
+
+    /* valid frames decoded */
+    uint32_t frames() const
+    {
+        return _frames;
+    }
+
+    /* frames failing their CRC */
+    uint32_t crc_errors() const
+    {
+        return _crc_errors;
+    }
+
+    /* frames malformed, too short or too long */
+    uint32_t framing_errors() const
+    {
+        return _framing_errors;
+    }
+
+private:
+    bool append(uint8_t byte)
+    {
+        if (_decoded >= sizeof(_frame)) {
+            ++_framing_errors;
+            _discard = true;
+            return false;
+        }
+        _frame[_decoded++] = byte;
+        return true;
+    }
+
+    bool end_frame()
+    {
+        bool discard = _discard;
+        bool started = _started;
+        bool complete = !_remaining;
+        size_t size = _decoded;
+        reset();
+
+        if (discard || !started) {
+            // Already counted, or back to back delimiters
+            return false;
+        }
+        if (!complete || size < sizeof(SerialFrameHeader) + sizeof(uint16_t)) {
+            ++_framing_errors;
+            return false;
+        }
+        size_t covered = size - sizeof(uint16_t);
+        uint16_t crc = static_cast<uint16_t>(_frame[covered] | _frame[covered + 1] << 8);
+        if (crc16(_frame, covered) != crc) {
+            ++_crc_errors;
+            return false;
+        }
+        _value_size = covered - sizeof(SerialFrameHeader);
+        ++_frames;
+        return true;
+    }
+
+    void reset()
+    {
+        _decoded = 0;
+        _remaining = 0;
+        _code = 0xFF;
+        _started = false;
+        _discard = false;
+    }
+
+    uint8_t _frame[SERIAL_FRAME_MAX_SIZE];
+    size_t _decoded = 0;
+    size_t _value_size = 0;
+    /* data bytes left in the current block */
+    unsigned _remaining = 0;
+    uint8_t _code = 0xFF;
+    bool _started = false;
+    bool _discard = false;
+    uint32_t _frames = 0;
+    uint32_t _crc_errors = 0;
+    uint32_t _framing_errors = 0;
+};
+
+}
+}
+
+#endif // RADAR_SERIAL_PROTOCOL_H
@@ -0,0 +1,378 @@
+/*
+ * Benchmark of the radar firmware logic on the host.
+ *
+ * Runs RadarService through a fixed set of scenes, and optionally recorded
+ * echo traces, on the virtual clock and reports per scenario:
+ *
+ *  - samples/s and notifications/s in virtual time,
+ *  - bytes notified and the radio time they take,
+ *  - host CPU time per ping, the measurement tick of the firmware.
+ *
+ * Usage: radar_bench [--seconds N] [--trace NAME=FILE]... [--mtu N]
+ *                    [--save-baseline FILE] [--baseline FILE] [--tolerance PCT]
+ *
+ * Every scenario runs in a child process so that each starts from a fresh
+ * clock and GattServer. --save-baseline stores the results, --baseline
+ * compares against stored ones: deterministic figures that changed are
+ * listed, and the exit status is 1 when the CPU time per ping grew by more
+ * than --tolerance percent (10 by default).
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "mbed.h"
+#include "ble/BLE.h"
+#include "events/EventQueue.h"
+#include "radar_protocol.h"
+#include "radar_service.h"
+#include "sim/radar_world.h"
+#include "sim/virtual_clock.h"
+
+namespace {
+
+struct Scenario {
+    std::string name;
+    sim::Scene scene;
+    std::vector<uint8_t> bearings;
+    bool fixed;
+    float spike_rate;
+    std::string trace_path;     /* replayed instead of the scene when set */
+};
+
+struct BenchResult {
+    double samples_per_s;
+    double notifications_per_s;
+    double bytes_per_s;
+    double airtime_percent;
+    double cpu_us_per_ping;
+    uint64_t pings;
+};
+
+const UUID BUFFER_STATS_UUID(radar::protocol::BUFFER_STATS.uuid);
+
+void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--seconds N] [--trace NAME=FILE]... [--mtu N] [--save-baseline FILE] "
+                    "[--baseline FILE] [--tolerance PCT]\r\n", program);
+}
+
+double cpu_time_us()
+{
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+std::vector<Scenario> default_scenarios()
+{
+    std::vector<Scenario> scenarios;
+
+    // The default scene of radar_sim: a wall and a closer object
+    Scenario room{"room", {}, {0}, false, 0.0f, ""};
+    room.scene.set_background(25.0f);
+    room.scene.add_target({60.0f, 80.0f, 12.0f, 0.0f});
+    scenarios.push_back(room);
+
+    // Nothing in range, every ping times out
+    Scenario open{"open", {}, {0}, false, 0.0f, ""};
+    scenarios.push_back(open);
+
+    // Someone walking away in front of a far wall
+    Scenario walker{"walker", {}, {0}, false, 0.0f, ""};
+    walker.scene.set_background(28.0f);
+    walker.scene.add_target({40.0f, 70.0f, 10.0f, 1.0f});
+    scenarios.push_back(walker);
+
+    // Many small objects, the sweep stays fine almost everywhere
+    Scenario clutter{"clutter", {}, {0}, false, 0.0f, ""};
+    clutter.scene.set_background(27.0f);
+    for (int i = 0; i < 9; ++i) {
+        clutter.scene.add_target({i * 20.0f, i * 20.0f + 8.0f, 8.0f + i * 2.0f, 0.0f});
+    }
+    scenarios.push_back(clutter);
+
+    // The room with multipath spikes
+    Scenario spikes = room;
+    spikes.name = "spikes";
+    spikes.spike_rate = 0.05f;
+    scenarios.push_back(spikes);
+
+    // Fixed array of four sensors
+    Scenario array{"array", {}, {0, 45, 90, 135}, true, 0.0f, ""};
+    array.scene.set_background(25.0f);
+    array.scene.add_target({40.0f, 50.0f, 12.0f, 0.0f});
+    scenarios.push_back(array);
+
+    return scenarios;
+}
+
+/**
+ * Run one scenario in this process.
+ */
+BenchResult run(const Scenario &scenario, int seconds, uint16_t att_mtu)
+{
+    sim::EchoTrace trace;
+    if (!scenario.trace_path.empty() && !trace.load(scenario.trace_path.c_str())) {
+        fprintf(stderr, "cannot read echo trace %s\r\n", scenario.trace_path.c_str());
+        exit(EXIT_FAILURE);
+    }
+
+    PwmOut servoPin(D5);
+    DigitalOut ledPin(D10);
+    static const PinName TRIG_PINS[MAX_SENSORS] = {D6, D7, D8, D11};
+    static const PinName ECHO_PINS[MAX_SENSORS] = {D9, D12, D13, D14};
+    std::deque<DigitalOut> trigPins;
+    std::deque<InterruptIn> echoPins;
+    std::vector<RangingSensor> sensors;
+
+    sim::ServoModel servo(servoPin);
+    sim::Airspace airspace;
+    std::deque<sim::Hcsr04Model> sensor_models;
+    for (size_t i = 0; i < scenario.bearings.size() && i < MAX_SENSORS; ++i) {
+        trigPins.emplace_back(TRIG_PINS[i]);
+        echoPins.emplace_back(ECHO_PINS[i]);
+        sensors.push_back({trigPins.back(), echoPins.back(), scenario.bearings[i]});
+        sensor_models.emplace_back(trigPins.back(), echoPins.back(), servo, scenario.scene, airspace,
+                                   scenario.bearings[i]);
+        sensor_models.back().set_spike_rate(scenario.spike_rate);
+        if (!trace.empty()) {
+            sensor_models.back().replay(&trace);
+        }
+    }
+
+    BLE &ble = BLE::Instance();
+    events::EventQueue event_queue;
+    events::EventQueue sensor_queue;
+    RadarService radar_service(
+        {scenario.fixed ? nullptr : &servoPin, mbed::make_Span(sensors.data(), sensors.size()), ledPin, nullptr},
+        sensor_queue
+    );
+
+    sim::LinkCapabilities capabilities;
+    capabilities.client_att_mtu = att_mtu;
+    ble.gap().sim_set_capabilities(capabilities);
+    radar_service.start(ble, event_queue);
+
+    GattServer &server = ble.gattServer();
+    ble.gap().sim_connect();
+    server.sim_connect();
+
+    double cpu_start = cpu_time_us();
+    event_queue.dispatch_for(std::chrono::seconds(seconds));
+    double cpu_us = cpu_time_us() - cpu_start;
+
+    uint64_t pings = 0;
+    for (const sim::Hcsr04Model &sensor : sensor_models) {
+        pings += sensor.pings();
+    }
+
+    SampleBufferStats buffer_stats = {};
+    server.sim_client_read(server.sim_find(BUFFER_STATS_UUID), reinterpret_cast<uint8_t *>(&buffer_stats),
+                           sizeof(buffer_stats));
+
+    const sim::GattStats &stats = server.sim_stats();
+    double virtual_s = sim::VirtualClock::instance().now().count() / 1e6;
+
+    BenchResult result;
+    result.samples_per_s = buffer_stats.pushed / virtual_s;
+    result.notifications_per_s = stats.notifications / virtual_s;
+    result.bytes_per_s = stats.notified_bytes / virtual_s;
+    result.airtime_percent = 100.0 * stats.airtime_us / 1e6 / virtual_s;
+    result.cpu_us_per_ping = pings ? cpu_us / pings : 0.0;
+    result.pings = pings;
+    return result;
+}
+
+/**
+ * Run one scenario in a child process.
+ */
+bool run_isolated(const Scenario &scenario, int seconds, uint16_t att_mtu, BenchResult &result)
+{
+    int fds[2];
+    if (pipe(fds)) {
+        return false;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    pid_t child = fork();
+    if (child < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+
+    if (child == 0) {
+        close(fds[0]);
+        // The firmware log is not part of the benchmark
+        if (!freopen("/dev/null", "w", stdout)) {
+            _exit(EXIT_FAILURE);
+        }
+        BenchResult child_result = run(scenario, seconds, att_mtu);
+        bool written = write(fds[1], &child_result, sizeof(child_result)) == sizeof(child_result);
+        _exit(written ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(fds[1]);
+    bool received = read(fds[0], &result, sizeof(result)) == sizeof(result);
+    close(fds[0]);
+
+    int status = 0;
+    waitpid(child, &status, 0);
+    return received && WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS;
+}
+
+/**
+ * Baseline file: one "scenario metric value" line per figure.
+ */
+typedef std::map<std::string, double> Baseline;
+
+std::map<std::string, double> figures(const BenchResult &result)
+{
+    return {
+        {"samples_per_s", result.samples_per_s},
+        {"notifications_per_s", result.notifications_per_s},
+        {"bytes_per_s", result.bytes_per_s},
+        {"airtime_percent", result.airtime_percent},
+        {"cpu_us_per_ping", result.cpu_us_per_ping},
+    };
+}
+
+bool load_baseline(const char *path, Baseline &baseline)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char scenario[64];
+        char metric[64];
+        double value;
+        if (line[0] == '#' || sscanf(line, "%63s %63s %lf", scenario, metric, &value) != 3) {
+            continue;
+        }
+        baseline[std::string(scenario) + " " + metric] = value;
+    }
+    fclose(file);
+    return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = 60;
+    // The MTU the firmware asks for, which most centrals grant
+    uint16_t att_mtu = 247;
+    const char *save_path = nullptr;
+    const char *baseline_path = nullptr;
+    double tolerance = 10.0;
+    std::vector<Scenario> scenarios = default_scenarios();
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--mtu") && i + 1 < argc) {
+            att_mtu = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--trace") && i + 1 < argc) {
+            const char *arg = argv[++i];
+            const char *equal = strchr(arg, '=');
+            if (!equal || equal == arg) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            Scenario replay{std::string(arg, equal - arg), {}, {0}, false, 0.0f, equal + 1};
+            scenarios.push_back(replay);
+        } else if (!strcmp(argv[i], "--save-baseline") && i + 1 < argc) {
+            save_path = argv[++i];
+        } else if (!strcmp(argv[i], "--baseline") && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    Baseline baseline;
+    if (baseline_path && !load_baseline(baseline_path, baseline)) {
+        fprintf(stderr, "cannot read baseline %s\r\n", baseline_path);
+        return EXIT_FAILURE;
+    }
+
+    FILE *save = nullptr;
+    if (save_path) {
+        save = fopen(save_path, "w");
+        if (!save) {
+            fprintf(stderr, "cannot write baseline %s\r\n", save_path);
+            return EXIT_FAILURE;
+        }
+        fprintf(save, "# radar_bench --seconds %d --mtu %u\n", seconds, att_mtu);
+    }
+
+    printf("%-10s %10s %10s %10s %9s %12s\r\n", "scenario", "samples/s", "notif/s", "bytes/s", "airtime", "cpu us/ping");
+
+    bool regressed = false;
+    std::vector<std::string> changes;
+    for (const Scenario &scenario : scenarios) {
+        BenchResult result;
+        if (!run_isolated(scenario, seconds, att_mtu, result)) {
+            fprintf(stderr, "scenario %s failed\r\n", scenario.name.c_str());
+            return EXIT_FAILURE;
+        }
+
+        printf("%-10s %10.1f %10.1f %10.1f %8.2f%% %12.2f\r\n", scenario.name.c_str(), result.samples_per_s,
+               result.notifications_per_s, result.bytes_per_s, result.airtime_percent, result.cpu_us_per_ping);
+
+        for (const auto &figure : figures(result)) {
+            std::string key = scenario.name + " " + figure.first;
+            if (save) {
+                fprintf(save, "%s %.6g\n", key.c_str(), figure.second);
+            }
+
+            auto stored = baseline.find(key);
+            if (stored == baseline.end()) {
+                continue;
+            }
+
+            double delta = stored->second ? 100.0 * (figure.second - stored->second) / stored->second : 0.0;
+            if (figure.first == "cpu_us_per_ping") {
+                // Host timing is noisy, only a clear slow down fails
+                if (delta > tolerance) {
+                    regressed = true;
+                    changes.push_back(key + ": " + std::to_string(stored->second) + " -> " +
+                                      std::to_string(figure.second) + " (regression)");
+                }
+            } else if (delta > 0.01 || delta < -0.01) {
+                changes.push_back(key + ": " + std::to_string(stored->second) + " -> " +
+                                  std::to_string(figure.second));
+            }
+        }
+    }
+
+    if (save) {
+        fclose(save);
+    }
+
+    if (baseline_path) {
+        printf("\r\nagainst %s:%s\r\n", baseline_path, changes.empty() ? " no change" : "");
+        for (const std::string &change : changes) {
+            printf("  %s\r\n", change.c_str());
+        }
+    }
+
+    return regressed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
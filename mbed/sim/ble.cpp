@@ -0,0 +1,411 @@
+#include <algorithm>
+#include <cctype>
+
+#include "ble/BLE.h"
+#include "sim/virtual_clock.h"
+
+namespace {
+
+int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = static_cast<char>(tolower(static_cast<unsigned char>(c)));
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+}
+
+UUID::UUID(const char *string)
+{
+    // Bytes are stored in little endian order like the mbed implementation
+    uint8_t parsed[LENGTH_OF_LONG_UUID];
+    unsigned count = 0;
+    int high = -1;
+
+    for (const char *c = string; *c && count < LENGTH_OF_LONG_UUID; ++c) {
+        int nibble = hex_value(*c);
+        if (nibble < 0) {
+            continue;
+        }
+        if (high < 0) {
+            high = nibble;
+        } else {
+            parsed[count++] = static_cast<uint8_t>((high << 4) | nibble);
+            high = -1;
+        }
+    }
+
+    if (count != LENGTH_OF_LONG_UUID) {
+        return;
+    }
+
+    for (unsigned i = 0; i < LENGTH_OF_LONG_UUID; ++i) {
+        _bytes[i] = parsed[LENGTH_OF_LONG_UUID - 1 - i];
+    }
+    _length = LENGTH_OF_LONG_UUID;
+}
+
+namespace ble {
+
+uint32_t GattServer::airtime_us(uint16_t size) const
+{
+    // The ATT PDU (opcode and handle) travels in an L2CAP frame which the
+    // link layer splits in PDUs of at most tx_octets bytes
+    const uint32_t inter_frame_space_us = 150;
+    const uint32_t us_per_byte = _phy_2m ? 4 : 8;
+    uint32_t remaining = size + 3 + 4;
+    uint32_t airtime = 0;
+
+    while (remaining) {
+        uint32_t pdu = remaining < _tx_octets ? remaining : _tx_octets;
+        remaining -= pdu;
+        // Preamble, access address, header and CRC, then the empty ack PDU
+        airtime += (pdu + 10 + (_phy_2m ? 1 : 0)) * us_per_byte + inter_frame_space_us;
+        airtime += (10 + (_phy_2m ? 1 : 0)) * us_per_byte + inter_frame_space_us;
+    }
+
+    return airtime;
+}
+
+bool Gap::isFeatureSupported(controller_supported_features_t::type feature) const
+{
+    switch (feature) {
+        case controller_supported_features_t::LE_DATA_PACKET_LENGTH_EXTENSION:
+            return _capabilities.data_length_extension;
+        case controller_supported_features_t::LE_2M_PHY:
+            return _capabilities.phy_2m;
+    }
+    return false;
+}
+
+ble_error_t Gap::setPhy(connection_handle_t connection, const phy_set_t *txPhys, const phy_set_t *rxPhys,
+                        coded_symbol_per_bit_t::type codedSymbol)
+{
+    bool phy_2m = _capabilities.phy_2m && txPhys && txPhys->get_2m() && rxPhys && rxPhys->get_2m();
+    if (!phy_2m) {
+        return BLE_ERROR_NONE;
+    }
+
+    sim::VirtualClock::instance().schedule_in(std::chrono::milliseconds(30), [this, connection]() {
+        _phy_2m = true;
+        _server.sim_set_link(_tx_octets, _phy_2m);
+        if (_handler) {
+            _handler->onPhyUpdateComplete(BLE_ERROR_NONE, connection, phy_t::LE_2M, phy_t::LE_2M);
+        }
+    });
+    return BLE_ERROR_NONE;
+}
+
+void Gap::sim_connect(connection_handle_t connection)
+{
+    _tx_octets = 27;
+    _phy_2m = false;
+    _server.sim_set_link(_tx_octets, _phy_2m);
+    _interval = conn_interval_t(_capabilities.interval);
+    _latency = slave_latency_t(0);
+    _parameters_since = sim::VirtualClock::instance().now();
+    _events_before = 0;
+    _server.sim_set_connection_events(_parameters_since, std::chrono::microseconds(_interval.valueInUs()));
+
+    if (_handler) {
+        _handler->onConnectionComplete(ConnectionCompleteEvent(
+            BLE_ERROR_NONE, connection, _interval, _latency, supervision_timeout_t(500)
+        ));
+    }
+
+    if (_capabilities.data_length_extension) {
+        sim::VirtualClock::instance().schedule_in(std::chrono::milliseconds(30), [this, connection]() {
+            _tx_octets = 251;
+            _server.sim_set_link(_tx_octets, _phy_2m);
+            if (_handler) {
+                _handler->onDataLengthChange(connection, _tx_octets, _tx_octets);
+            }
+        });
+    }
+}
+
+ble_error_t Gap::updateConnectionParameters(connection_handle_t connectionHandle,
+                                            conn_interval_t minConnectionInterval,
+                                            conn_interval_t maxConnectionInterval,
+                                            slave_latency_t slaveLatency,
+                                            supervision_timeout_t supervisionTimeout,
+                                            conn_event_length_t minConnectionEventLength,
+                                            conn_event_length_t maxConnectionEventLength)
+{
+    if (minConnectionInterval.value() > maxConnectionInterval.value()) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    // The central takes the longest interval allowed, it applies from an
+    // instant a few connection events later
+    sim::VirtualClock &clock = sim::VirtualClock::instance();
+    std::chrono::microseconds delay(6 * _interval.valueInUs());
+    clock.schedule_in(delay, [this, connectionHandle, maxConnectionInterval, slaveLatency, supervisionTimeout]() {
+        if (!_capabilities.accept_parameters) {
+            if (_handler) {
+                _handler->onConnectionParametersUpdateComplete(ConnectionParametersUpdateCompleteEvent(
+                    BLE_ERROR_OPERATION_NOT_PERMITTED, connectionHandle, _interval, _latency, supervisionTimeout
+                ));
+            }
+            return;
+        }
+
+        _events_before = sim_connection_events();
+        _parameters_since = sim::VirtualClock::instance().now();
+        _interval = maxConnectionInterval;
+        _latency = slaveLatency;
+        _server.sim_set_connection_events(_parameters_since, std::chrono::microseconds(_interval.valueInUs()));
+        if (_handler) {
+            _handler->onConnectionParametersUpdateComplete(ConnectionParametersUpdateCompleteEvent(
+                BLE_ERROR_NONE, connectionHandle, _interval, _latency, supervisionTimeout
+            ));
+        }
+    });
+    return BLE_ERROR_NONE;
+}
+
+uint64_t Gap::sim_connection_events() const
+{
+    if (!_interval.value()) {
+        return _events_before;
+    }
+    std::chrono::microseconds elapsed = sim::VirtualClock::instance().now() - _parameters_since;
+    return _events_before + elapsed.count() / (static_cast<uint64_t>(_interval.valueInUs()) * (_latency.value() + 1));
+}
+
+ble_error_t GattClient::negotiateAttMtu(connection_handle_t connection)
+{
+    const sim::LinkCapabilities &capabilities = _gap.sim_capabilities();
+    uint16_t att_mtu = std::min(capabilities.server_att_mtu, capabilities.client_att_mtu);
+
+    sim::VirtualClock::instance().schedule_in(std::chrono::milliseconds(15), [this, att_mtu]() {
+        _server.sim_set_att_mtu(att_mtu);
+    });
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t GattServer::addService(GattService &service)
+{
+    // Leave room for the service declaration
+    ++_next_handle;
+
+    for (unsigned i = 0; i < service.getCharacteristicCount(); ++i) {
+        GattCharacteristic *characteristic = service.getCharacteristic(i);
+        if (!characteristic) {
+            return BLE_ERROR_INVALID_PARAM;
+        }
+
+        // Characteristic declaration, value and CCCD
+        GattAttribute::Handle_t handle = _next_handle + 1;
+        _next_handle += 3;
+        characteristic->_handle = handle;
+
+        Attribute attribute{characteristic, {}, false, 0};
+        if (characteristic->_value) {
+            attribute.value.assign(characteristic->_value, characteristic->_value + characteristic->_len);
+        }
+        _attributes.emplace(handle, std::move(attribute));
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t GattServer::write(GattAttribute::Handle_t attributeHandle, const uint8_t *value, uint16_t size, bool localOnly)
+{
+    Attribute *attribute = find(attributeHandle);
+    if (!attribute) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    GattCharacteristic &characteristic = *attribute->characteristic;
+    if (size > characteristic._max_len) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    attribute->value.assign(value, value + size);
+    ++_stats.local_writes;
+
+    if (localOnly || !attribute->subscribed) {
+        return BLE_ERROR_NONE;
+    }
+
+    // A notification carries at most ATT_MTU - 3 bytes of value
+    if (size > _att_mtu - 3) {
+        size = _att_mtu - 3;
+        ++_stats.truncated_notifications;
+    }
+
+    ++attribute->notifications;
+    ++_stats.notifications;
+    _stats.notified_bytes += size;
+    _stats.airtime_us += airtime_us(size);
+    if (_interval.count()) {
+        // Queued until the next connection event
+        std::chrono::microseconds since_anchor = sim::VirtualClock::instance().now() - _anchor;
+        _stats.notification_wait_us += ((_interval - since_anchor % _interval) % _interval).count();
+    }
+
+    if (_notify_observer) {
+        _notify_observer(attributeHandle, value, size);
+    }
+
+    if (_handler) {
+        // The stack reports the transmission asynchronously
+        GattDataSentCallbackParams params{_connection, attributeHandle};
+        EventHandler *handler = _handler;
+        sim::VirtualClock::instance().schedule_in(std::chrono::microseconds::zero(), [handler, params]() {
+            handler->onDataSent(params);
+        });
+    }
+
+    return BLE_ERROR_NONE;
+}
+
+ble_error_t GattServer::read(GattAttribute::Handle_t attributeHandle, uint8_t buffer[], uint16_t *lengthP)
+{
+    Attribute *attribute = find(attributeHandle);
+    if (!attribute) {
+        return BLE_ERROR_INVALID_PARAM;
+    }
+
+    if (*lengthP < attribute->value.size()) {
+        *lengthP = static_cast<uint16_t>(attribute->value.size());
+        return BLE_ERROR_PARAM_OUT_OF_RANGE;
+    }
+
+    std::copy(attribute->value.begin(), attribute->value.end(), buffer);
+    *lengthP = static_cast<uint16_t>(attribute->value.size());
+    return BLE_ERROR_NONE;
+}
+
+void GattServer::sim_connect(connection_handle_t connection)
+{
+    _connection = connection;
+
+    for (auto &entry : _attributes) {
+        sim_subscribe(entry.first);
+    }
+}
+
+void GattServer::sim_subscribe(GattAttribute::Handle_t handle)
+{
+    Attribute *attribute = find(handle);
+    if (!attribute || attribute->subscribed) {
+        return;
+    }
+
+    uint8_t props = attribute->characteristic->_props;
+    if (!(props & (GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY |
+                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_INDICATE))) {
+        return;
+    }
+
+    attribute->subscribed = true;
+    if (_handler) {
+        GattUpdatesEnabledCallbackParams params{_connection, handle, static_cast<GattAttribute::Handle_t>(handle - 1)};
+        _handler->onUpdatesEnabled(params);
+    }
+}
+
+void GattServer::sim_set_att_mtu(uint16_t att_mtu)
+{
+    _att_mtu = att_mtu;
+    if (_handler) {
+        _handler->onAttMtuChange(_connection, att_mtu);
+    }
+}
+
+GattAuthCallbackReply_t GattServer::sim_client_write(GattAttribute::Handle_t handle, const uint8_t *data, uint16_t len)
+{
+    Attribute *attribute = find(handle);
+    if (!attribute) {
+        return AUTH_CALLBACK_REPLY_ATTERR_INVALID_HANDLE;
+    }
+
+    GattCharacteristic &characteristic = *attribute->characteristic;
+    if (!(characteristic._props & (GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE |
+                                   GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE))) {
+        return AUTH_CALLBACK_REPLY_ATTERR_WRITE_NOT_PERMITTED;
+    }
+
+    if (len > characteristic._max_len || (!characteristic._variable_len && len != characteristic._max_len)) {
+        return AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH;
+    }
+
+    if (characteristic._write_auth) {
+        GattWriteAuthCallbackParams auth{_connection, handle, 0, len, data, AUTH_CALLBACK_REPLY_SUCCESS};
+        characteristic._write_auth(&auth);
+        if (auth.authorizationReply != AUTH_CALLBACK_REPLY_SUCCESS) {
+            return auth.authorizationReply;
+        }
+    }
+
+    attribute->value.assign(data, data + len);
+    ++_stats.client_writes;
+
+    if (_handler) {
+        GattWriteCallbackParams params{
+            _connection, handle, GattWriteCallbackParams::OP_WRITE_REQ, 0, len, attribute->value.data()
+        };
+        _handler->onDataWritten(params);
+    }
+
+    return AUTH_CALLBACK_REPLY_SUCCESS;
+}
+
+uint16_t GattServer::sim_client_read(GattAttribute::Handle_t handle, uint8_t *buffer, uint16_t len)
+{
+    Attribute *attribute = find(handle);
+    if (!attribute) {
+        return 0;
+    }
+
+    GattCharacteristic &characteristic = *attribute->characteristic;
+    if (characteristic._read_auth) {
+        GattReadAuthCallbackParams auth{_connection, handle, 0, len, buffer, AUTH_CALLBACK_REPLY_SUCCESS};
+        characteristic._read_auth(&auth);
+        if (auth.authorizationReply != AUTH_CALLBACK_REPLY_SUCCESS) {
+            return 0;
+        }
+    }
+
+    uint16_t copied = static_cast<uint16_t>(std::min<size_t>(len, attribute->value.size()));
+    std::copy(attribute->value.begin(), attribute->value.begin() + copied, buffer);
+    ++_stats.client_reads;
+
+    if (_handler) {
+        GattReadCallbackParams params{_connection, handle, 0, copied, buffer};
+        _handler->onDataRead(params);
+    }
+
+    return copied;
+}
+
+GattAttribute::Handle_t GattServer::sim_find(const UUID &uuid) const
+{
+    for (const auto &entry : _attributes) {
+        if (entry.second.characteristic->_uuid == uuid) {
+            return entry.first;
+        }
+    }
+    return GattAttribute::INVALID_HANDLE;
+}
+
+GattServer::Attribute *GattServer::find(GattAttribute::Handle_t handle)
+{
+    auto it = _attributes.find(handle);
+    return it == _attributes.end() ? nullptr : &it->second;
+}
+
+} // namespace ble
+
+BLE &BLE::Instance()
+{
+    static BLE instance;
+    return instance;
+}
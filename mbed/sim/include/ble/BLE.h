@@ -0,0 +1,728 @@
+/*
+ * Host stand-in for the mbed-os BLE API.
+ *
+ * The GattServer keeps the attribute values in memory and plays the role of
+ * a single connected client: it accounts for the notifications that would go
+ * on air and lets the simulator issue client reads and writes. The Gap and
+ * GattClient negotiate the link with that client according to the
+ * capabilities given to Gap::sim_connect().
+ */
+#ifndef RADAR_SIM_BLE_BLE_H
+#define RADAR_SIM_BLE_BLE_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "platform/Callback.h"
+
+enum ble_error_t {
+    BLE_ERROR_NONE = 0,
+    BLE_ERROR_BUFFER_OVERFLOW = 1,
+    BLE_ERROR_NOT_IMPLEMENTED = 2,
+    BLE_ERROR_PARAM_OUT_OF_RANGE = 3,
+    BLE_ERROR_INVALID_PARAM = 4,
+    BLE_STACK_BUSY = 5,
+    BLE_ERROR_INVALID_STATE = 6,
+    BLE_ERROR_NO_MEM = 7,
+    BLE_ERROR_OPERATION_NOT_PERMITTED = 8,
+    BLE_ERROR_INITIALIZATION_INCOMPLETE = 9,
+    BLE_ERROR_ALREADY_INITIALIZED = 10,
+    BLE_ERROR_UNSPECIFIED = 11,
+    BLE_ERROR_INTERNAL_STACK_FAILURE = 12,
+    BLE_ERROR_NOT_FOUND = 13
+};
+
+namespace ble {
+typedef uint16_t connection_handle_t;
+class GattServer;
+
+struct phy_t {
+    enum type {
+        NONE = 0,
+        LE_1M = 1,
+        LE_2M = 2,
+        LE_CODED = 3
+    };
+
+    phy_t(type value) : _value(value) {}
+
+    uint8_t value() const
+    {
+        return static_cast<uint8_t>(_value);
+    }
+
+private:
+    type _value;
+};
+
+class phy_set_t {
+public:
+    phy_set_t(bool phy_1m, bool phy_2m, bool phy_coded) :
+        _value((phy_1m ? 1 : 0) | (phy_2m ? 2 : 0) | (phy_coded ? 4 : 0))
+    {
+    }
+
+    bool get_2m() const
+    {
+        return _value & 2;
+    }
+
+private:
+    uint8_t _value;
+};
+
+struct coded_symbol_per_bit_t {
+    enum type {
+        UNDEFINED,
+        S2,
+        S8
+    };
+};
+
+/**
+ * Duration counted in units of TB us.
+ */
+template<typename Rep, uint32_t TB>
+class Duration {
+public:
+    Duration(Rep value = 0) : _value(value) {}
+
+    Rep value() const
+    {
+        return _value;
+    }
+
+    uint32_t valueInUs() const
+    {
+        return _value * TB;
+    }
+
+    uint32_t valueInMs() const
+    {
+        return _value * TB / 1000;
+    }
+
+private:
+    Rep _value;
+};
+
+typedef Duration<uint16_t, 1250> conn_interval_t;
+typedef Duration<uint16_t, 10000> supervision_timeout_t;
+typedef Duration<uint16_t, 625> conn_event_length_t;
+
+class slave_latency_t {
+public:
+    slave_latency_t(uint16_t value = 0) : _value(value) {}
+
+    uint16_t value() const
+    {
+        return _value;
+    }
+
+private:
+    uint16_t _value;
+};
+
+struct controller_supported_features_t {
+    enum type {
+        LE_DATA_PACKET_LENGTH_EXTENSION,
+        LE_2M_PHY
+    };
+};
+
+class ConnectionCompleteEvent {
+public:
+    ConnectionCompleteEvent(ble_error_t status, connection_handle_t handle, conn_interval_t interval,
+                            slave_latency_t latency, supervision_timeout_t timeout) :
+        _status(status), _handle(handle), _interval(interval), _latency(latency), _timeout(timeout)
+    {
+    }
+
+    ble_error_t getStatus() const
+    {
+        return _status;
+    }
+
+    connection_handle_t getConnectionHandle() const
+    {
+        return _handle;
+    }
+
+    conn_interval_t getConnectionInterval() const
+    {
+        return _interval;
+    }
+
+    slave_latency_t getConnectionLatency() const
+    {
+        return _latency;
+    }
+
+    supervision_timeout_t getSupervisionTimeout() const
+    {
+        return _timeout;
+    }
+
+private:
+    ble_error_t _status;
+    connection_handle_t _handle;
+    conn_interval_t _interval;
+    slave_latency_t _latency;
+    supervision_timeout_t _timeout;
+};
+
+class ConnectionParametersUpdateCompleteEvent {
+public:
+    ConnectionParametersUpdateCompleteEvent(ble_error_t status, connection_handle_t handle,
+                                            conn_interval_t interval, slave_latency_t latency,
+                                            supervision_timeout_t timeout) :
+        _status(status), _handle(handle), _interval(interval), _latency(latency), _timeout(timeout)
+    {
+    }
+
+    ble_error_t getStatus() const
+    {
+        return _status;
+    }
+
+    connection_handle_t getConnectionHandle() const
+    {
+        return _handle;
+    }
+
+    conn_interval_t getConnectionInterval() const
+    {
+        return _interval;
+    }
+
+    slave_latency_t getSlaveLatency() const
+    {
+        return _latency;
+    }
+
+    supervision_timeout_t getSupervisionTimeout() const
+    {
+        return _timeout;
+    }
+
+private:
+    ble_error_t _status;
+    connection_handle_t _handle;
+    conn_interval_t _interval;
+    slave_latency_t _latency;
+    supervision_timeout_t _timeout;
+};
+
+class DisconnectionCompleteEvent {
+public:
+    explicit DisconnectionCompleteEvent(connection_handle_t handle) : _handle(handle) {}
+
+    connection_handle_t getConnectionHandle() const
+    {
+        return _handle;
+    }
+
+private:
+    connection_handle_t _handle;
+};
+}
+
+enum GattAuthCallbackReply_t {
+    AUTH_CALLBACK_REPLY_SUCCESS = 0x00,
+    AUTH_CALLBACK_REPLY_ATTERR_INVALID_HANDLE = 0x0101,
+    AUTH_CALLBACK_REPLY_ATTERR_READ_NOT_PERMITTED = 0x0102,
+    AUTH_CALLBACK_REPLY_ATTERR_WRITE_NOT_PERMITTED = 0x0103,
+    AUTH_CALLBACK_REPLY_ATTERR_INVALID_OFFSET = 0x0107,
+    AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH = 0x010D,
+    AUTH_CALLBACK_REPLY_ATTERR_UNLIKELY_ERROR = 0x010E
+};
+
+class UUID {
+public:
+    typedef uint16_t ShortUUIDBytes_t;
+    static const unsigned LENGTH_OF_LONG_UUID = 16;
+
+    UUID(const char *string);
+
+    UUID(ShortUUIDBytes_t short_uuid) : _length(2)
+    {
+        _bytes[0] = short_uuid >> 8;
+        _bytes[1] = short_uuid & 0xFF;
+    }
+
+    const uint8_t *getBaseUUID() const
+    {
+        return _bytes;
+    }
+
+    uint8_t getLen() const
+    {
+        return _length;
+    }
+
+    bool operator==(const UUID &other) const
+    {
+        return _length == other._length && memcmp(_bytes, other._bytes, _length) == 0;
+    }
+
+private:
+    uint8_t _bytes[LENGTH_OF_LONG_UUID] = {};
+    uint8_t _length = 0;
+};
+
+class GattAttribute {
+public:
+    typedef uint16_t Handle_t;
+    static const Handle_t INVALID_HANDLE = 0x0000;
+};
+
+struct GattWriteCallbackParams {
+    enum WriteOp_t {
+        OP_INVALID = 0x00,
+        OP_WRITE_REQ = 0x01,
+        OP_WRITE_CMD = 0x02
+    };
+
+    ble::connection_handle_t connHandle;
+    GattAttribute::Handle_t handle;
+    WriteOp_t writeOp;
+    uint16_t offset;
+    uint16_t len;
+    const uint8_t *data;
+};
+
+struct GattReadCallbackParams {
+    ble::connection_handle_t connHandle;
+    GattAttribute::Handle_t handle;
+    uint16_t offset;
+    uint16_t len;
+    const uint8_t *data;
+};
+
+struct GattWriteAuthCallbackParams {
+    ble::connection_handle_t connHandle;
+    GattAttribute::Handle_t handle;
+    uint16_t offset;
+    uint16_t len;
+    const uint8_t *data;
+    GattAuthCallbackReply_t authorizationReply;
+};
+
+struct GattReadAuthCallbackParams {
+    ble::connection_handle_t connHandle;
+    GattAttribute::Handle_t handle;
+    uint16_t offset;
+    uint16_t len;
+    uint8_t *data;
+    GattAuthCallbackReply_t authorizationReply;
+};
+
+struct GattDataSentCallbackParams {
+    ble::connection_handle_t connHandle;
+    GattAttribute::Handle_t attHandle;
+};
+
+struct GattUpdatesEnabledCallbackParams {
+    ble::connection_handle_t connHandle;
+    GattAttribute::Handle_t attHandle;
+    GattAttribute::Handle_t charHandle;
+};
+
+typedef GattUpdatesEnabledCallbackParams GattUpdatesDisabledCallbackParams;
+typedef GattDataSentCallbackParams GattConfirmationReceivedCallbackParams;
+
+class GattCharacteristic {
+public:
+    enum Properties_t {
+        BLE_GATT_CHAR_PROPERTIES_NONE = 0x00,
+        BLE_GATT_CHAR_PROPERTIES_BROADCAST = 0x01,
+        BLE_GATT_CHAR_PROPERTIES_READ = 0x02,
+        BLE_GATT_CHAR_PROPERTIES_WRITE_WITHOUT_RESPONSE = 0x04,
+        BLE_GATT_CHAR_PROPERTIES_WRITE = 0x08,
+        BLE_GATT_CHAR_PROPERTIES_NOTIFY = 0x10,
+        BLE_GATT_CHAR_PROPERTIES_INDICATE = 0x20
+    };
+
+    GattCharacteristic(
+        const UUID &uuid,
+        uint8_t *valuePtr = nullptr,
+        uint16_t len = 0,
+        uint16_t maxLen = 0,
+        uint8_t props = BLE_GATT_CHAR_PROPERTIES_NONE,
+        GattAttribute *descriptors[] = nullptr,
+        unsigned numDescriptors = 0,
+        bool hasVariableLen = true
+    ) :
+        _uuid(uuid),
+        _value(valuePtr),
+        _len(len),
+        _max_len(maxLen),
+        _props(props),
+        _variable_len(hasVariableLen)
+    {
+    }
+
+    GattCharacteristic(const GattCharacteristic &) = delete;
+    GattCharacteristic &operator=(const GattCharacteristic &) = delete;
+
+    GattAttribute::Handle_t getValueHandle() const
+    {
+        return _handle;
+    }
+
+    const UUID &getUUID() const
+    {
+        return _uuid;
+    }
+
+    uint8_t getProperties() const
+    {
+        return _props;
+    }
+
+    template<typename T>
+    void setWriteAuthorizationCallback(T *object, void (T::*member)(GattWriteAuthCallbackParams *))
+    {
+        _write_auth = mbed::callback(object, member);
+    }
+
+    template<typename T>
+    void setReadAuthorizationCallback(T *object, void (T::*member)(GattReadAuthCallbackParams *))
+    {
+        _read_auth = mbed::callback(object, member);
+    }
+
+private:
+    friend class ble::GattServer;
+
+    UUID _uuid;
+    uint8_t *_value;
+    uint16_t _len;
+    uint16_t _max_len;
+    uint8_t _props;
+    bool _variable_len;
+    GattAttribute::Handle_t _handle = GattAttribute::INVALID_HANDLE;
+    mbed::Callback<void(GattWriteAuthCallbackParams *)> _write_auth;
+    mbed::Callback<void(GattReadAuthCallbackParams *)> _read_auth;
+};
+
+class GattService {
+public:
+    GattService(const UUID &uuid, GattCharacteristic *characteristics[], unsigned numCharacteristics) :
+        _uuid(uuid),
+        _characteristics(characteristics),
+        _count(numCharacteristics)
+    {
+    }
+
+    GattCharacteristic *getCharacteristic(unsigned index) const
+    {
+        return index < _count ? _characteristics[index] : nullptr;
+    }
+
+    unsigned getCharacteristicCount() const
+    {
+        return _count;
+    }
+
+private:
+    UUID _uuid;
+    GattCharacteristic **_characteristics;
+    unsigned _count;
+};
+
+namespace sim {
+
+/**
+ * Traffic accounted by the simulated GattServer.
+ */
+struct GattStats {
+    uint64_t airtime_us = 0;        /* radio time of the notifications, see Gap */
+    uint64_t notifications = 0;
+    uint64_t notification_wait_us = 0;     /* until the connection event carrying them */
+    uint64_t notified_bytes = 0;
+    uint64_t truncated_notifications = 0;
+    uint64_t local_writes = 0;
+    uint64_t client_writes = 0;
+    uint64_t client_reads = 0;
+};
+
+}
+
+namespace ble {
+
+class GattServer {
+public:
+    class EventHandler {
+    public:
+        virtual void onDataSent(const GattDataSentCallbackParams &params) {}
+        virtual void onDataWritten(const GattWriteCallbackParams &params) {}
+        virtual void onDataRead(const GattReadCallbackParams &params) {}
+        virtual void onShutdown(const GattServer &server) {}
+        virtual void onUpdatesEnabled(const GattUpdatesEnabledCallbackParams &params) {}
+        virtual void onUpdatesDisabled(const GattUpdatesDisabledCallbackParams &params) {}
+        virtual void onConfirmationReceived(const GattConfirmationReceivedCallbackParams &params) {}
+        virtual void onAttMtuChange(connection_handle_t connectionHandle, uint16_t attMtuSize) {}
+
+    protected:
+        ~EventHandler() = default;
+    };
+
+    ble_error_t addService(GattService &service);
+
+    ble_error_t write(GattAttribute::Handle_t attributeHandle, const uint8_t *value, uint16_t size, bool localOnly = false);
+
+    ble_error_t read(GattAttribute::Handle_t attributeHandle, uint8_t buffer[], uint16_t *lengthP);
+
+    void setEventHandler(EventHandler *handler)
+    {
+        _handler = handler;
+    }
+
+    /**
+     * Connect the simulated client and subscribe it to every characteristic
+     * that can notify.
+     */
+    void sim_connect(connection_handle_t connection = 0);
+
+    /**
+     * Subscribe the simulated client to the notifications of a single
+     * characteristic.
+     */
+    void sim_subscribe(GattAttribute::Handle_t handle);
+
+    /**
+     * Exchange the ATT MTU with the simulated client, notifications longer
+     * than the MTU allows are truncated like on air.
+     */
+    void sim_set_att_mtu(uint16_t att_mtu);
+
+    /**
+     * Write from the simulated client, goes through the write authorization
+     * callback like an over the air write.
+     */
+    GattAuthCallbackReply_t sim_client_write(GattAttribute::Handle_t handle, const uint8_t *data, uint16_t len);
+
+    /**
+     * Read from the simulated client.
+     *
+     * @return Number of bytes copied into buffer.
+     */
+    uint16_t sim_client_read(GattAttribute::Handle_t handle, uint8_t *buffer, uint16_t len);
+
+    /**
+     * Observe every notification sent to the simulated client.
+     */
+    void sim_on_notify(std::function<void(GattAttribute::Handle_t, const uint8_t *, uint16_t)> observer)
+    {
+        _notify_observer = std::move(observer);
+    }
+
+    const sim::GattStats &sim_stats() const
+    {
+        return _stats;
+    }
+
+    /**
+     * Notifications sent for a single characteristic.
+     */
+    uint64_t sim_notifications(GattAttribute::Handle_t handle) const
+    {
+        auto it = _attributes.find(handle);
+        return it == _attributes.end() ? 0 : it->second.notifications;
+    }
+
+    /**
+     * Find the value handle of a registered characteristic.
+     */
+    GattAttribute::Handle_t sim_find(const UUID &uuid) const;
+
+    /**
+     * Link layer parameters the notifications go out with.
+     */
+    void sim_set_link(uint16_t tx_octets, bool phy_2m)
+    {
+        _tx_octets = tx_octets;
+        _phy_2m = phy_2m;
+    }
+
+    /**
+     * Connection events, the first at anchor then every interval.
+     */
+    void sim_set_connection_events(std::chrono::microseconds anchor, std::chrono::microseconds interval)
+    {
+        _anchor = anchor;
+        _interval = interval;
+    }
+
+private:
+    struct Attribute {
+        GattCharacteristic *characteristic;
+        std::vector<uint8_t> value;
+        bool subscribed;
+        uint64_t notifications;
+    };
+
+    Attribute *find(GattAttribute::Handle_t handle);
+
+    uint32_t airtime_us(uint16_t size) const;
+
+    EventHandler *_handler = nullptr;
+    GattAttribute::Handle_t _next_handle = 1;
+    connection_handle_t _connection = 0;
+    uint16_t _att_mtu = 23;
+    uint16_t _tx_octets = 27;
+    bool _phy_2m = false;
+    std::chrono::microseconds _anchor{0};
+    std::chrono::microseconds _interval{0};
+    std::map<GattAttribute::Handle_t, Attribute> _attributes;
+    std::function<void(GattAttribute::Handle_t, const uint8_t *, uint16_t)> _notify_observer;
+    sim::GattStats _stats;
+};
+
+} // namespace ble
+
+namespace sim {
+
+/**
+ * What the simulated controller and client support.
+ */
+struct LinkCapabilities {
+    uint16_t server_att_mtu = 247;          /* cordio.desired-att-mtu */
+    uint16_t client_att_mtu = 23;
+    uint16_t interval = 24;                 /* 1.25 ms units, chosen by the central */
+    bool accept_parameters = true;          /* central applies the requested parameters */
+    bool data_length_extension = false;     /* BlueNRG-MS is a Bluetooth 4.1 controller */
+    bool phy_2m = false;
+};
+
+}
+
+namespace ble {
+
+class Gap {
+public:
+    class EventHandler {
+    public:
+        virtual void onConnectionComplete(const ConnectionCompleteEvent &event) {}
+        virtual void onDisconnectionComplete(const DisconnectionCompleteEvent &event) {}
+        virtual void onPhyUpdateComplete(ble_error_t status, connection_handle_t connectionHandle,
+                                         phy_t txPhy, phy_t rxPhy) {}
+        virtual void onDataLengthChange(connection_handle_t connectionHandle, uint16_t txSize, uint16_t rxSize) {}
+        virtual void onConnectionParametersUpdateComplete(const ConnectionParametersUpdateCompleteEvent &event) {}
+
+    protected:
+        ~EventHandler() = default;
+    };
+
+    explicit Gap(GattServer &server) : _server(server) {}
+
+    void setEventHandler(EventHandler *handler)
+    {
+        _handler = handler;
+    }
+
+    EventHandler *getEventHandler()
+    {
+        return _handler;
+    }
+
+    bool isFeatureSupported(controller_supported_features_t::type feature) const;
+
+    ble_error_t setPhy(connection_handle_t connection, const phy_set_t *txPhys, const phy_set_t *rxPhys,
+                       coded_symbol_per_bit_t::type codedSymbol);
+
+    ble_error_t updateConnectionParameters(connection_handle_t connectionHandle,
+                                           conn_interval_t minConnectionInterval,
+                                           conn_interval_t maxConnectionInterval,
+                                           slave_latency_t slaveLatency,
+                                           supervision_timeout_t supervisionTimeout,
+                                           conn_event_length_t minConnectionEventLength = conn_event_length_t(0),
+                                           conn_event_length_t maxConnectionEventLength = conn_event_length_t(0xFFFF));
+
+    /**
+     * Set what the controller and the simulated client support, before the
+     * firmware starts.
+     */
+    void sim_set_capabilities(const sim::LinkCapabilities &capabilities)
+    {
+        _capabilities = capabilities;
+    }
+
+    /**
+     * Connect the simulated client, the host requests the longest link layer
+     * packets right away when both ends support them.
+     */
+    void sim_connect(connection_handle_t connection = 0);
+
+    const sim::LinkCapabilities &sim_capabilities() const
+    {
+        return _capabilities;
+    }
+
+    /**
+     * Connection events the peripheral listened to since connected, fewer
+     * than the intervals elapsed when it uses slave latency while idle.
+     */
+    uint64_t sim_connection_events() const;
+
+private:
+    GattServer &_server;
+    EventHandler *_handler = nullptr;
+    sim::LinkCapabilities _capabilities;
+    uint16_t _tx_octets = 27;
+    bool _phy_2m = false;
+    conn_interval_t _interval;
+    slave_latency_t _latency;
+    std::chrono::microseconds _parameters_since{0};
+    uint64_t _events_before = 0;
+};
+
+class GattClient {
+public:
+    explicit GattClient(Gap &gap, GattServer &server) : _gap(gap), _server(server) {}
+
+    /**
+     * Exchange the ATT MTU with the simulated client.
+     */
+    ble_error_t negotiateAttMtu(connection_handle_t connection);
+
+private:
+    Gap &_gap;
+    GattServer &_server;
+};
+
+} // namespace ble
+
+using ble::GattServer;
+
+class BLE {
+public:
+    static BLE &Instance();
+
+    ble::GattServer &gattServer()
+    {
+        return _gatt_server;
+    }
+
+    ble::Gap &gap()
+    {
+        return _gap;
+    }
+
+    ble::GattClient &gattClient()
+    {
+        return _gatt_client;
+    }
+
+private:
+    ble::GattServer _gatt_server;
+    ble::Gap _gap{_gatt_server};
+    ble::GattClient _gatt_client{_gap, _gatt_server};
+};
+
+#endif // RADAR_SIM_BLE_BLE_H
@@ -0,0 +1,62 @@
+/*
+ * Host stand-in for the mbed-os ChainableGapEventHandler.
+ */
+#ifndef RADAR_SIM_BLE_GAP_CHAINABLE_GAP_EVENT_HANDLER_H
+#define RADAR_SIM_BLE_GAP_CHAINABLE_GAP_EVENT_HANDLER_H
+
+#include <vector>
+
+#include "ble/BLE.h"
+
+/**
+ * Forwards the Gap events to every handler added, in the order they were added.
+ */
+class ChainableGapEventHandler : public ble::Gap::EventHandler {
+public:
+    ble_error_t addEventHandler(ble::Gap::EventHandler *handler)
+    {
+        _handlers.push_back(handler);
+        return BLE_ERROR_NONE;
+    }
+
+    void onConnectionComplete(const ble::ConnectionCompleteEvent &event) override
+    {
+        for (ble::Gap::EventHandler *handler : _handlers) {
+            handler->onConnectionComplete(event);
+        }
+    }
+
+    void onDisconnectionComplete(const ble::DisconnectionCompleteEvent &event) override
+    {
+        for (ble::Gap::EventHandler *handler : _handlers) {
+            handler->onDisconnectionComplete(event);
+        }
+    }
+
+    void onPhyUpdateComplete(ble_error_t status, ble::connection_handle_t connectionHandle,
+                             ble::phy_t txPhy, ble::phy_t rxPhy) override
+    {
+        for (ble::Gap::EventHandler *handler : _handlers) {
+            handler->onPhyUpdateComplete(status, connectionHandle, txPhy, rxPhy);
+        }
+    }
+
+    void onDataLengthChange(ble::connection_handle_t connectionHandle, uint16_t txSize, uint16_t rxSize) override
+    {
+        for (ble::Gap::EventHandler *handler : _handlers) {
+            handler->onDataLengthChange(connectionHandle, txSize, rxSize);
+        }
+    }
+
+    void onConnectionParametersUpdateComplete(const ble::ConnectionParametersUpdateCompleteEvent &event) override
+    {
+        for (ble::Gap::EventHandler *handler : _handlers) {
+            handler->onConnectionParametersUpdateComplete(event);
+        }
+    }
+
+private:
+    std::vector<ble::Gap::EventHandler *> _handlers;
+};
+
+#endif // RADAR_SIM_BLE_GAP_CHAINABLE_GAP_EVENT_HANDLER_H
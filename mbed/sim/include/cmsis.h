@@ -0,0 +1,65 @@
+/*
+ * Host stand-in for the CMSIS core registers used by the radar firmware.
+ *
+ * Only the DWT cycle counter is provided. It counts at SystemCoreClock
+ * through the virtual time of the simulation, which accounts for waits,
+ * plus the host time spent since the start, which accounts for the code
+ * run. Host cycles are not MCU cycles: compare stages with each other and
+ * runs on the same host only.
+ */
+#ifndef RADAR_SIM_CMSIS_H
+#define RADAR_SIM_CMSIS_H
+
+#include <chrono>
+#include <cstdint>
+
+#include "sim/virtual_clock.h"
+
+/* STM32F401 at full speed */
+static const uint32_t SystemCoreClock = 84000000;
+
+class CycleCountRegister {
+public:
+    operator uint32_t() const
+    {
+        using namespace std::chrono;
+        static const steady_clock::time_point host_start = steady_clock::now();
+        uint64_t host_ns = duration_cast<nanoseconds>(steady_clock::now() - host_start).count();
+        uint64_t virtual_us = sim::VirtualClock::instance().now().count();
+        return static_cast<uint32_t>((virtual_us * 1000 + host_ns) * (SystemCoreClock / 1000000) / 1000);
+    }
+
+    CycleCountRegister &operator=(uint32_t value)
+    {
+        return *this;
+    }
+};
+
+struct DWT_Type {
+    uint32_t CTRL;
+    CycleCountRegister CYCCNT;
+};
+
+struct CoreDebug_Type {
+    uint32_t DEMCR;
+};
+
+#define DWT_CTRL_CYCCNTENA_Msk (1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+inline DWT_Type *sim_dwt()
+{
+    static DWT_Type dwt = {};
+    return &dwt;
+}
+
+inline CoreDebug_Type *sim_core_debug()
+{
+    static CoreDebug_Type core_debug = {};
+    return &core_debug;
+}
+
+#define DWT (sim_dwt())
+#define CoreDebug (sim_core_debug())
+
+#endif // RADAR_SIM_CMSIS_H
@@ -0,0 +1,67 @@
+/*
+ * Host stand-in for events::EventQueue.
+ *
+ * Events are posted to the simulator virtual clock; dispatching the queue
+ * advances virtual time instead of waiting for it.
+ */
+#ifndef RADAR_SIM_EVENTS_EVENTQUEUE_H
+#define RADAR_SIM_EVENTS_EVENTQUEUE_H
+
+#include <chrono>
+#include <utility>
+
+#include "platform/Callback.h"
+#include "sim/virtual_clock.h"
+
+namespace events {
+
+class EventQueue {
+public:
+    using duration = std::chrono::duration<int, std::milli>;
+
+    /**
+     * Post f to run as soon as the queue is dispatched.
+     */
+    template<typename F>
+    int call(F f)
+    {
+        return sim::VirtualClock::instance().schedule_in(std::chrono::microseconds::zero(), std::move(f));
+    }
+
+    /**
+     * Post f to run after delay.
+     */
+    template<typename F>
+    int call_in(duration delay, F f)
+    {
+        return sim::VirtualClock::instance().schedule_in(delay, std::move(f));
+    }
+
+    /**
+     * Post f to run every period, the first call happens after one period.
+     */
+    template<typename F>
+    int call_every(duration period, F f)
+    {
+        return sim::VirtualClock::instance().schedule_in(period, std::move(f), period);
+    }
+
+    bool cancel(int id)
+    {
+        return sim::VirtualClock::instance().cancel(id);
+    }
+
+    /**
+     * Run the queue for ms of virtual time.
+     */
+    void dispatch_for(duration ms)
+    {
+        sim::VirtualClock::instance().run_for(ms);
+    }
+};
+
+} // namespace events
+
+using events::EventQueue;
+
+#endif // RADAR_SIM_EVENTS_EVENTQUEUE_H
@@ -0,0 +1,403 @@
+/*
+ * Host stand-in for the mbed-os drivers used by the radar firmware.
+ *
+ * Pins keep their level in memory and expose sim_* hooks so that the models
+ * of the simulator can observe outputs and drive inputs. Time is read from
+ * the simulator virtual clock.
+ */
+#ifndef RADAR_SIM_MBED_H
+#define RADAR_SIM_MBED_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <utility>
+
+#include "platform/Callback.h"
+#include "platform/Span.h"
+#include "platform/mbed_toolchain.h"
+#include "events/EventQueue.h"
+#include "sim/virtual_clock.h"
+
+typedef enum {
+    D0, D1, D2, D3, D4, D5, D6, D7, D8, D9, D10, D11, D12, D13, D14, D15,
+    A0, A1, A2, A3, A4, A5,
+    NC = -1
+} PinName;
+
+/* Events of the asynchronous serial transfers */
+#define SERIAL_EVENT_TX_COMPLETE (1 << 2)
+
+namespace mbed {
+
+/**
+ * Busy wait, lets virtual time pass without running other events.
+ */
+inline void wait_us(int us)
+{
+    sim::VirtualClock::instance().advance(std::chrono::microseconds(us));
+}
+
+/**
+ * Interrupts and threads are all serialized on the virtual clock so there is
+ * nothing to lock.
+ */
+class CriticalSectionLock {
+public:
+    CriticalSectionLock() {}
+};
+
+class DigitalOut {
+public:
+    explicit DigitalOut(PinName pin, int value = 0) : _pin(pin), _value(value) {}
+
+    void write(int value)
+    {
+        value = value ? 1 : 0;
+        if (value == _value) {
+            return;
+        }
+        _value = value;
+        if (_observer) {
+            _observer(_value);
+        }
+    }
+
+    int read() const
+    {
+        return _value;
+    }
+
+    DigitalOut &operator=(int value)
+    {
+        write(value);
+        return *this;
+    }
+
+    operator int() const
+    {
+        return read();
+    }
+
+    /**
+     * Get notified of every level change of the pin.
+     */
+    void sim_on_change(std::function<void(int)> observer)
+    {
+        _observer = std::move(observer);
+    }
+
+private:
+    PinName _pin;
+    int _value;
+    std::function<void(int)> _observer;
+};
+
+class InterruptIn {
+public:
+    explicit InterruptIn(PinName pin) : _pin(pin) {}
+
+    int read() const
+    {
+        return _value;
+    }
+
+    operator int() const
+    {
+        return read();
+    }
+
+    void rise(Callback<void()> func)
+    {
+        _rise = std::move(func);
+    }
+
+    void fall(Callback<void()> func)
+    {
+        _fall = std::move(func);
+    }
+
+    /**
+     * Set the level seen on the pin and fire the matching edge handler.
+     */
+    void sim_drive(int value)
+    {
+        value = value ? 1 : 0;
+        if (value == _value) {
+            return;
+        }
+        _value = value;
+        if (_value && _rise) {
+            _rise();
+        } else if (!_value && _fall) {
+            _fall();
+        }
+    }
+
+private:
+    PinName _pin;
+    int _value = 0;
+    Callback<void()> _rise;
+    Callback<void()> _fall;
+};
+
+class PwmOut {
+public:
+    explicit PwmOut(PinName pin) : _pin(pin) {}
+
+    void period_ms(int ms)
+    {
+        _period_us = ms * 1000;
+    }
+
+    void period_us(int us)
+    {
+        _period_us = us;
+    }
+
+    void pulsewidth_us(int us)
+    {
+        _pulsewidth_us = us;
+        if (_observer) {
+            _observer(us);
+        }
+    }
+
+    int read_period_us() const
+    {
+        return _period_us;
+    }
+
+    int read_pulsewidth_us() const
+    {
+        return _pulsewidth_us;
+    }
+
+    /**
+     * Get notified of every pulse width update.
+     */
+    void sim_on_change(std::function<void(int)> observer)
+    {
+        _observer = std::move(observer);
+    }
+
+private:
+    PinName _pin;
+    int _period_us = 20000;
+    int _pulsewidth_us = 0;
+    std::function<void(int)> _observer;
+};
+
+class AnalogIn {
+public:
+    explicit AnalogIn(PinName pin) : _pin(pin) {}
+
+    /**
+     * Sample normalized to [0, 0xFFFF] of the reference voltage.
+     */
+    unsigned short read_u16()
+    {
+        return _sample;
+    }
+
+    /**
+     * Drive the pin at volts, out of a reference of reference_volts.
+     */
+    void sim_set_voltage(float volts, float reference_volts = 3.3f)
+    {
+        float ratio = volts / reference_volts;
+        ratio = ratio < 0.0f ? 0.0f : ratio > 1.0f ? 1.0f : ratio;
+        _sample = static_cast<unsigned short>(ratio * 0xFFFF + 0.5f);
+    }
+
+private:
+    PinName _pin;
+    unsigned short _sample = 0;
+};
+
+class Timer {
+public:
+    void start()
+    {
+        if (!_running) {
+            _running = true;
+            _started_at = sim::VirtualClock::instance().now();
+        }
+    }
+
+    void stop()
+    {
+        if (_running) {
+            _accumulated += sim::VirtualClock::instance().now() - _started_at;
+            _running = false;
+        }
+    }
+
+    void reset()
+    {
+        _accumulated = std::chrono::microseconds::zero();
+        _started_at = sim::VirtualClock::instance().now();
+    }
+
+    std::chrono::microseconds elapsed_time() const
+    {
+        if (_running) {
+            return _accumulated + (sim::VirtualClock::instance().now() - _started_at);
+        }
+        return _accumulated;
+    }
+
+private:
+    bool _running = false;
+    std::chrono::microseconds _started_at{0};
+    std::chrono::microseconds _accumulated{0};
+};
+
+class Timeout {
+public:
+    ~Timeout()
+    {
+        detach();
+    }
+
+    void attach(Callback<void()> func, std::chrono::microseconds delay)
+    {
+        detach();
+        _id = sim::VirtualClock::instance().schedule_in(delay, [this, func]() {
+            _id = 0;
+            func();
+        });
+    }
+
+    void detach()
+    {
+        if (_id) {
+            sim::VirtualClock::instance().cancel(_id);
+            _id = 0;
+        }
+    }
+
+private:
+    int _id = 0;
+};
+
+typedef Callback<void(int)> event_callback_t;
+
+/**
+ * UART, 8N1, with the asynchronous transfers of DEVICE_SERIAL_ASYNCH.
+ *
+ * A transfer lasts the time of its bytes at the baud rate, they are given to
+ * the transmit observer once sent. Bytes received are queued and the RX
+ * handler runs until it has read them all.
+ */
+class SerialBase {
+public:
+    enum IrqType {
+        RxIrq = 0,
+        TxIrq,
+        IrqCnt
+    };
+
+    void baud(int baudrate)
+    {
+        _baud = baudrate;
+    }
+
+    void attach(Callback<void()> func, IrqType type = RxIrq)
+    {
+        if (type == RxIrq) {
+            _rx_irq = std::move(func);
+        }
+    }
+
+    bool readable() const
+    {
+        return !_rx.empty();
+    }
+
+    /**
+     * Start sending length bytes of buffer, which must stay valid until the
+     * callback.
+     *
+     * @return 0 if the transfer started, -1 while another one runs.
+     */
+    int write(const uint8_t *buffer, int length, const event_callback_t &callback,
+              int event = SERIAL_EVENT_TX_COMPLETE)
+    {
+        if (_tx_id) {
+            return -1;
+        }
+        std::chrono::microseconds duration(static_cast<int64_t>(length) * 10 * 1000000 / _baud);
+        _tx_id = sim::VirtualClock::instance().schedule_in(duration, [this, buffer, length, callback, event]() {
+            _tx_id = 0;
+            if (_transmit) {
+                _transmit(buffer, static_cast<size_t>(length));
+            }
+            if (event & SERIAL_EVENT_TX_COMPLETE) {
+                callback(SERIAL_EVENT_TX_COMPLETE);
+            }
+        });
+        return 0;
+    }
+
+    /**
+     * Get the bytes of every transfer as it completes.
+     */
+    void sim_on_transmit(std::function<void(const uint8_t *, size_t)> observer)
+    {
+        _transmit = std::move(observer);
+    }
+
+    /**
+     * Receive bytes on the RX pin, the RX handler is called.
+     */
+    void sim_receive(const uint8_t *data, size_t size)
+    {
+        _rx.insert(_rx.end(), data, data + size);
+        if (_rx_irq && !_rx.empty()) {
+            _rx_irq();
+        }
+    }
+
+    int sim_baud() const
+    {
+        return _baud;
+    }
+
+protected:
+    SerialBase(PinName tx, PinName rx, int baud) : _tx(tx), _rx_pin(rx), _baud(baud) {}
+
+    ~SerialBase()
+    {
+        if (_tx_id) {
+            sim::VirtualClock::instance().cancel(_tx_id);
+        }
+    }
+
+    int _base_getc()
+    {
+        if (_rx.empty()) {
+            return -1;
+        }
+        int c = _rx.front();
+        _rx.pop_front();
+        return c;
+    }
+
+private:
+    PinName _tx;
+    PinName _rx_pin;
+    int _baud;
+    int _tx_id = 0;
+    Callback<void()> _rx_irq;
+    std::deque<uint8_t> _rx;
+    std::function<void(const uint8_t *, size_t)> _transmit;
+};
+
+} // namespace mbed
+
+using namespace mbed;
+
+#endif // RADAR_SIM_MBED_H
@@ -0,0 +1,76 @@
+/*
+ * Host stand-in for mbed::Callback.
+ *
+ * Only the subset used by the radar firmware is provided.
+ */
+#ifndef RADAR_SIM_PLATFORM_CALLBACK_H
+#define RADAR_SIM_PLATFORM_CALLBACK_H
+
+#include <functional>
+#include <utility>
+
+namespace mbed {
+
+template<typename F>
+class Callback;
+
+template<typename R, typename... Args>
+class Callback<R(Args...)> {
+public:
+    Callback() = default;
+
+    Callback(std::nullptr_t) {}
+
+    Callback(R (*func)(Args...)) : _func(func) {}
+
+    template<typename T, typename U>
+    Callback(U *obj, R (T::*method)(Args...)) :
+        _func([obj, method](Args... args) { return (obj->*method)(std::forward<Args>(args)...); }) {}
+
+    template<typename T, typename U>
+    Callback(const U *obj, R (T::*method)(Args...) const) :
+        _func([obj, method](Args... args) { return (obj->*method)(std::forward<Args>(args)...); }) {}
+
+    template<typename F, typename = decltype(std::declval<F &>()(std::declval<Args>()...))>
+    Callback(F func) : _func(std::move(func)) {}
+
+    R call(Args... args) const
+    {
+        return _func(std::forward<Args>(args)...);
+    }
+
+    R operator()(Args... args) const
+    {
+        return _func(std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const
+    {
+        return static_cast<bool>(_func);
+    }
+
+private:
+    std::function<R(Args...)> _func;
+};
+
+template<typename R, typename... Args>
+Callback<R(Args...)> callback(R (*func)(Args...))
+{
+    return Callback<R(Args...)>(func);
+}
+
+template<typename T, typename U, typename R, typename... Args>
+Callback<R(Args...)> callback(U *obj, R (T::*method)(Args...))
+{
+    return Callback<R(Args...)>(obj, method);
+}
+
+template<typename T, typename U, typename R, typename... Args>
+Callback<R(Args...)> callback(const U *obj, R (T::*method)(Args...) const)
+{
+    return Callback<R(Args...)>(obj, method);
+}
+
+} // namespace mbed
+
+#endif // RADAR_SIM_PLATFORM_CALLBACK_H
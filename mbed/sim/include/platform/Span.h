@@ -0,0 +1,101 @@
+/*
+ * Host stand-in for mbed::Span, dynamic extent only.
+ */
+#ifndef RADAR_SIM_PLATFORM_SPAN_H
+#define RADAR_SIM_PLATFORM_SPAN_H
+
+#include <cstddef>
+#include <type_traits>
+
+namespace mbed {
+
+#define SPAN_DYNAMIC_EXTENT -1
+
+template<typename ElementType, ptrdiff_t Extent = SPAN_DYNAMIC_EXTENT>
+class Span {
+public:
+    typedef ElementType element_type;
+    typedef ptrdiff_t index_type;
+    typedef element_type *pointer;
+    typedef element_type &reference;
+    typedef element_type *iterator;
+
+    Span() = default;
+
+    Span(pointer ptr, index_type count) : _data(ptr), _size(count) {}
+
+    Span(pointer first, pointer last) : _data(first), _size(last - first) {}
+
+    template<size_t N>
+    Span(element_type (&elements)[N]) : _data(elements), _size(N) {}
+
+    template<typename OtherElementType, ptrdiff_t OtherExtent,
+             typename = typename std::enable_if<std::is_convertible<OtherElementType (*)[], ElementType (*)[]>::value>::type>
+    Span(const Span<OtherElementType, OtherExtent> &other) : _data(other.data()), _size(other.size()) {}
+
+    index_type size() const
+    {
+        return _size;
+    }
+
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    pointer data() const
+    {
+        return _data;
+    }
+
+    reference operator[](index_type index) const
+    {
+        return _data[index];
+    }
+
+    iterator begin() const
+    {
+        return _data;
+    }
+
+    iterator end() const
+    {
+        return _data + _size;
+    }
+
+    Span first(index_type count) const
+    {
+        return Span(_data, count);
+    }
+
+    Span subspan(index_type offset, index_type count = SPAN_DYNAMIC_EXTENT) const
+    {
+        return Span(_data + offset, count == SPAN_DYNAMIC_EXTENT ? _size - offset : count);
+    }
+
+private:
+    pointer _data = nullptr;
+    index_type _size = 0;
+};
+
+template<typename T>
+Span<T> make_Span(T *ptr, ptrdiff_t count)
+{
+    return Span<T>(ptr, count);
+}
+
+template<typename T, size_t N>
+Span<T> make_Span(T (&elements)[N])
+{
+    return Span<T>(elements);
+}
+
+template<typename T>
+Span<const T> make_const_Span(const T *ptr, ptrdiff_t count)
+{
+    return Span<const T>(ptr, count);
+}
+
+} // namespace mbed
+
+#endif // RADAR_SIM_PLATFORM_SPAN_H
@@ -0,0 +1,12 @@
+/*
+ * Host stand-in for the mbed toolchain attribute macros.
+ */
+#ifndef RADAR_SIM_PLATFORM_MBED_TOOLCHAIN_H
+#define RADAR_SIM_PLATFORM_MBED_TOOLCHAIN_H
+
+#define MBED_PACKED(struct) struct __attribute__((packed))
+#define MBED_ALIGN(N) __attribute__((aligned(N)))
+#define MBED_FORCEINLINE inline __attribute__((always_inline))
+#define MBED_UNUSED __attribute__((__unused__))
+
+#endif // RADAR_SIM_PLATFORM_MBED_TOOLCHAIN_H
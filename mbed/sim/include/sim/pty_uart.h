@@ -0,0 +1,80 @@
+/*
+ * Pseudo terminal standing in for the wire between a UART of the simulated
+ * radar and a host.
+ */
+#ifndef RADAR_SIM_PTY_UART_H
+#define RADAR_SIM_PTY_UART_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "mbed.h"
+
+namespace sim {
+
+/**
+ * Connects a SerialBase to a pseudo terminal, hosts open its slave side as
+ * they would open the tty of a USB serial adapter.
+ *
+ * Bytes sent by the UART are written to the terminal as each transfer
+ * completes, poll() hands the bytes of the host to the UART. Nothing
+ * blocks: bytes the terminal has no room for, while no host reads them,
+ * are dropped and counted like bytes sent down a loose wire.
+ */
+class PtyUart {
+public:
+    explicit PtyUart(mbed::SerialBase &serial);
+    PtyUart(const PtyUart &) = delete;
+    PtyUart &operator=(const PtyUart &) = delete;
+    ~PtyUart();
+
+    /**
+     * Create the terminal, in raw mode.
+     */
+    bool open();
+
+    /**
+     * Path of the slave side, for the host.
+     */
+    const char *path() const
+    {
+        return _path.c_str();
+    }
+
+    /**
+     * Receive what the host wrote.
+     */
+    void poll();
+
+    uint64_t sent() const
+    {
+        return _sent;
+    }
+
+    uint64_t received() const
+    {
+        return _received;
+    }
+
+    uint64_t dropped() const
+    {
+        return _dropped;
+    }
+
+private:
+    void transmit(const uint8_t *data, size_t size);
+
+    mbed::SerialBase &_serial;
+    std::string _path;
+    int _master = -1;
+    /* kept open so that the terminal outlives the hosts opening and closing it */
+    int _slave = -1;
+    uint64_t _sent = 0;
+    uint64_t _received = 0;
+    uint64_t _dropped = 0;
+};
+
+}
+
+#endif // RADAR_SIM_PTY_UART_H
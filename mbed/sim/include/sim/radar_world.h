@@ -0,0 +1,281 @@
+/*
+ * Physical side of the simulated radar: the scene, the servo and the HC-SR04.
+ */
+#ifndef RADAR_SIM_RADAR_WORLD_H
+#define RADAR_SIM_RADAR_WORLD_H
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "mbed.h"
+#include "servo_motion.h"
+
+namespace sim {
+
+/**
+ * Reflectors around the radar, and the air between.
+ */
+class Scene {
+public:
+    /* speed of sound at 20 degrees Celsius, cm/us */
+    static constexpr float SOUND_SPEED_20C = 0.0343f;
+    /* speed of sound gained per degree, cm/us */
+    static constexpr float SOUND_SPEED_PER_DEGREE = 0.0000606f;
+
+    /**
+     * Flat reflector covering [from_deg, to_deg] at distance_cm, moving
+     * away from the radar at speed_cm_s from the start of the simulation.
+     */
+    struct Target {
+        float from_deg;
+        float to_deg;
+        float distance_cm;
+        float speed_cm_s;
+    };
+
+    /**
+     * Reflector seen at every angle not covered by a target, a negative
+     * distance means open space.
+     */
+    void set_background(float distance_cm)
+    {
+        _background_cm = distance_cm;
+    }
+
+    void add_target(const Target &target)
+    {
+        _targets.push_back(target);
+    }
+
+    /**
+     * Air temperature, 20 degrees Celsius by default.
+     */
+    void set_temperature(float celsius)
+    {
+        _temperature = celsius;
+    }
+
+    float temperature() const
+    {
+        return _temperature;
+    }
+
+    /**
+     * Speed of sound in the air of the scene, cm/us.
+     */
+    float sound_speed() const
+    {
+        return SOUND_SPEED_20C + SOUND_SPEED_PER_DEGREE * (_temperature - 20.0f);
+    }
+
+    /**
+     * Closest reflector in the direction angle_deg, negative when nothing
+     * reflects.
+     */
+    float distance_at(float angle_deg) const;
+
+private:
+    float _background_cm = -1.0f;
+    std::vector<Target> _targets;
+    float _temperature = 20.0f;
+};
+
+/**
+ * Hobby servo following the pulse width of a PwmOut.
+ *
+ * A new pulse width is latched at the next PWM frame, frames being aligned
+ * on the start of the simulation. The head then travels at the slew rate of
+ * the profile and rings for its settle time.
+ */
+class ServoModel {
+public:
+    ServoModel(mbed::PwmOut &pwm, const ServoProfile &profile = SERVO_SG90);
+
+    /**
+     * Current position of the head.
+     */
+    float angle() const;
+
+    /**
+     * true once the last command is latched and the head is at rest.
+     */
+    bool settled() const;
+
+private:
+    void on_pulse(int pulse_us);
+    void latch(float angle_deg);
+
+    ServoProfile _profile;
+    float _from_deg = 90.0f;
+    float _to_deg = 90.0f;
+    std::chrono::microseconds _departure = -std::chrono::seconds(1);
+    int _latch_event = 0;
+};
+
+/**
+ * Echo widths per ping, recorded from a run or captured on the board.
+ *
+ * Stored as text, one ping per line: time (us), bearing (degrees) and echo
+ * width (us). On replay a ping gets the width last recorded at its bearing
+ * at the same time into the trace, the trace repeating over its duration.
+ */
+class EchoTrace {
+public:
+    void add(std::chrono::microseconds time, int bearing_deg, std::chrono::microseconds width);
+
+    /**
+     * Width for a ping at bearing_deg at the time now, negative if the
+     * trace never pinged that bearing.
+     */
+    std::chrono::microseconds width_at(int bearing_deg, std::chrono::microseconds now) const;
+
+    bool empty() const
+    {
+        return _pings.empty();
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    bool load(const char *path);
+    bool save(const char *path) const;
+
+private:
+    struct Ping {
+        std::chrono::microseconds time;
+        std::chrono::microseconds width;
+    };
+
+    std::map<int, std::vector<Ping>> _pings;   /* by bearing, in time order */
+    std::chrono::microseconds _duration{0};
+    size_t _size = 0;
+};
+
+class Hcsr04Model;
+
+/**
+ * Bursts in flight around the radar.
+ *
+ * A sensor listening while another one facing within a beam width of it
+ * emits hears that burst, its reading then aliases.
+ */
+class Airspace {
+public:
+    /* widest angle between two sensors hearing each other */
+    static constexpr float BEAM_WIDTH_DEG = 30.0f;
+
+    /**
+     * sensor emits towards bearing_deg and listens until the time until.
+     */
+    void emit(const Hcsr04Model *sensor, float bearing_deg, std::chrono::microseconds until);
+
+    /**
+     * true if another sensor facing close to bearing_deg is still emitting
+     * or listening.
+     */
+    bool crosstalk(const Hcsr04Model *sensor, float bearing_deg) const;
+
+private:
+    struct Burst {
+        const Hcsr04Model *sensor;
+        float bearing_deg;
+        std::chrono::microseconds until;
+    };
+
+    std::vector<Burst> _bursts;
+};
+
+/**
+ * HC-SR04 ranging module.
+ *
+ * A trigger pulse of at least 10us starts a burst, the echo line then goes
+ * high for the round trip time of the sound to the reflector, at the
+ * speed of sound of the scene. The module faces bearing degrees away from
+ * the servo head.
+ */
+class Hcsr04Model {
+public:
+    /* delay between the trigger falling edge and the echo rising edge */
+    static constexpr std::chrono::microseconds BURST_DELAY{460};
+    /* echo width reported when nothing reflects */
+    static constexpr std::chrono::microseconds NO_ECHO_WIDTH{38000};
+    /* farthest reflector detected */
+    static constexpr float MAX_RANGE_CM = 400.0f;
+
+    Hcsr04Model(mbed::DigitalOut &trig, mbed::InterruptIn &echo, const ServoModel &servo, const Scene &scene,
+                Airspace &airspace, float bearing = 0.0f);
+
+    uint64_t pings() const
+    {
+        return _pings;
+    }
+
+    /**
+     * Pings sent while the head was still moving or about to move.
+     */
+    uint64_t unsettled_pings() const
+    {
+        return _unsettled_pings;
+    }
+
+    /**
+     * Pings sent while a neighbouring sensor was emitting or listening.
+     */
+    uint64_t crosstalk_pings() const
+    {
+        return _crosstalk_pings;
+    }
+
+    /**
+     * Fraction of the pings answered by a spurious echo of random width,
+     * e.g. a multipath reflection or acoustic noise.
+     */
+    void set_spike_rate(float rate)
+    {
+        _spike_rate = rate;
+    }
+
+    /**
+     * Take the echo widths from trace instead of the scene, bearings missing
+     * from the trace still come from the scene.
+     */
+    void replay(const EchoTrace *trace)
+    {
+        _replay = trace;
+    }
+
+    /**
+     * Append every ping to trace.
+     */
+    void record(EchoTrace *trace)
+    {
+        _record = trace;
+    }
+
+private:
+    void on_trigger(int level);
+
+    mbed::InterruptIn &_echo;
+    const ServoModel &_servo;
+    const Scene &_scene;
+    Airspace &_airspace;
+    float _bearing;
+    std::chrono::microseconds _trigger_rise{0};
+    bool _busy = false;
+    uint64_t _pings = 0;
+    uint64_t _unsettled_pings = 0;
+    uint64_t _crosstalk_pings = 0;
+    float _spike_rate = 0.0f;
+    std::minstd_rand _random;
+    const EchoTrace *_replay = nullptr;
+    EchoTrace *_record = nullptr;
+};
+
+} // namespace sim
+
+#endif // RADAR_SIM_RADAR_WORLD_H
@@ -0,0 +1,93 @@
+/*
+ * UNIX socket stand-in for the BLE link between the simulated radar and a
+ * gateway.
+ */
+#ifndef RADAR_SIM_SOCKET_LINK_H
+#define RADAR_SIM_SOCKET_LINK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ble/BLE.h"
+#include "radar_protocol.h"
+
+namespace sim {
+
+/**
+ * Serves the GattServer to a gateway over a SOCK_SEQPACKET UNIX socket, in
+ * the messages of socket_protocol.h.
+ *
+ * One gateway at a time. Subscriptions, writes and reads of the gateway go
+ * through the simulated client, notifications are forwarded as they are
+ * sent. Nothing blocks: poll() runs from the virtual clock and a
+ * notification the gateway has no room for is dropped and counted, like
+ * one lost over the air.
+ */
+class SocketLink {
+public:
+    explicit SocketLink(GattServer &server);
+    SocketLink(const SocketLink &) = delete;
+    SocketLink &operator=(const SocketLink &) = delete;
+    ~SocketLink();
+
+    /**
+     * Listen at path, replacing any socket left there.
+     */
+    bool listen(const char *path);
+
+    /**
+     * Accept a gateway and serve its requests.
+     */
+    void poll();
+
+    /**
+     * Forward a notification of the GattServer.
+     */
+    void notify(GattAttribute::Handle_t handle, const uint8_t *data, uint16_t length);
+
+    bool connected() const
+    {
+        return _peer >= 0;
+    }
+
+    uint64_t gateways() const
+    {
+        return _gateways;
+    }
+
+    uint64_t forwarded() const
+    {
+        return _forwarded;
+    }
+
+    uint64_t dropped() const
+    {
+        return _dropped;
+    }
+
+private:
+    struct Characteristic {
+        radar::protocol::Uuid uuid;
+        GattAttribute::Handle_t handle;
+    };
+
+    const Characteristic *find(const uint8_t *uuid) const;
+    const Characteristic *find(GattAttribute::Handle_t handle) const;
+    void serve(const uint8_t *message, size_t size);
+    bool send(uint8_t flags, const Characteristic &characteristic, const uint8_t *data, size_t size);
+    void disconnect();
+
+    GattServer &_server;
+    std::vector<Characteristic> _characteristics;
+    std::string _path;
+    int _listener = -1;
+    int _peer = -1;
+    uint64_t _gateways = 0;
+    uint64_t _forwarded = 0;
+    uint64_t _dropped = 0;
+};
+
+}
+
+#endif // RADAR_SIM_SOCKET_LINK_H
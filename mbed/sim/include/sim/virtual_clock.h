@@ -0,0 +1,117 @@
+/*
+ * Virtual time base of the host simulator.
+ *
+ * Every timed activity of the simulated board (event queue, timers, timeouts
+ * and echo edges) is an event on this clock. Events run in timestamp order on
+ * the calling thread, which makes a run deterministic and lets it go as fast
+ * as the host allows.
+ */
+#ifndef RADAR_SIM_VIRTUAL_CLOCK_H
+#define RADAR_SIM_VIRTUAL_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <utility>
+
+namespace sim {
+
+class VirtualClock {
+public:
+    using duration = std::chrono::microseconds;
+    using time_point = std::chrono::microseconds;
+
+    /**
+     * Clock shared by all the simulated peripherals.
+     */
+    static VirtualClock &instance();
+
+    /**
+     * Current virtual time since the start of the simulation.
+     */
+    time_point now() const
+    {
+        return _now;
+    }
+
+    /**
+     * Schedule fn at the absolute time at.
+     *
+     * @param[in] period If non zero the event is re-armed every period until
+     * it is cancelled.
+     *
+     * @return A non zero identifier usable with cancel().
+     */
+    int schedule(time_point at, std::function<void()> fn, duration period = duration::zero());
+
+    /**
+     * Schedule fn delay after the current time.
+     */
+    int schedule_in(duration delay, std::function<void()> fn, duration period = duration::zero())
+    {
+        return schedule(_now + delay, std::move(fn), period);
+    }
+
+    /**
+     * Remove a pending event.
+     *
+     * @return true if the event was pending.
+     */
+    bool cancel(int id);
+
+    /**
+     * Let time pass without running events, models a busy wait.
+     */
+    void advance(duration d)
+    {
+        _now += d;
+    }
+
+    /**
+     * Run every event due up to and including the time until, then move the
+     * clock to until.
+     */
+    void run_until(time_point until);
+
+    /**
+     * Run the events due within d of the current time.
+     */
+    void run_for(duration d)
+    {
+        run_until(_now + d);
+    }
+
+    /**
+     * Number of events executed so far.
+     */
+    uint64_t events_run() const
+    {
+        return _events_run;
+    }
+
+    /**
+     * Drop every pending event and rewind the clock to zero.
+     */
+    void reset();
+
+private:
+    struct Event {
+        int id;
+        duration period;
+        std::function<void()> fn;
+    };
+
+    using Key = std::pair<int64_t, uint64_t>;
+
+    time_point _now{0};
+    uint64_t _sequence = 0;
+    uint64_t _events_run = 0;
+    int _next_id = 1;
+    std::map<Key, Event> _events;
+    std::map<int, Key> _keys;
+};
+
+} // namespace sim
+
+#endif // RADAR_SIM_VIRTUAL_CLOCK_H
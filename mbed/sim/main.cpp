@@ -0,0 +1,623 @@
+/*
+ * Host simulator of the radar firmware.
+ *
+ * Runs RadarService from mbed/source against simulated pins, a virtual clock
+ * and an in-process GattServer, faster than real time.
+ *
+ * Usage: radar_sim [--seconds N] [--background CM] [--target FROM:TO:CM[:CM_PER_S]]...
+ *                  [--mtu N] [--client all|legacy|frame|objects] [--spikes RATE]
+ *                  [--max-range MM] [--servo-timing SLEW:SETTLE]
+ *                  [--sensor BEARING]... [--fixed] [--diff MARGIN:KEYFRAME]
+ *                  [--controller 4.1|5] [--stop-after S] [--profile]
+ *                  [--record-echoes FILE] [--replay-echoes FILE] [--log FILE]
+ *                  [--socket PATH] [--serial] [--baud N] [--realtime]
+ *                  [--temperature C] [--thermometer] [--calibrate C] [--reference ANGLE:MM]
+ *
+ * The simulated client subscribes to every characteristic (all), to the
+ * angle and distance characteristics (legacy), to the sweep frames (frame) or
+ * to the object lists (objects).
+ *
+ * --servo-timing sets the slew (us per degree) and settle time (us) of the
+ * simulated servo only, the firmware keeps the timing of its servo profile.
+ * Pings sent while the head moves are reported as unsettled.
+ *
+ * Each --sensor adds an HC-SR04 facing BEARING degrees from the head, one
+ * facing the head by default. --fixed leaves the servo out, the sensors then
+ * form a fixed array. Pings hearing the burst of another sensor are reported
+ * as crosstalk.
+ *
+ * --diff writes the background subtraction settings: the margin in mm (0
+ * notifies every sample) and the sweeps between two keyframes.
+ *
+ * --mtu is the largest ATT MTU of the client, the firmware negotiates it on
+ * connection. --controller 5 gives the controller data length extension and
+ * the 2M PHY, the BlueNRG-MS is a 4.1 controller (the default).
+ *
+ * --stop-after writes 0 to the running characteristic S seconds into the
+ * run, the connection then goes back to its idle parameters.
+ *
+ * --profile prints the cycle profile of the measurement and publish stages,
+ * host time converted to cycles of the board clock (see cmsis.h).
+ *
+ * --record-echoes saves the echo width of every ping to FILE, --replay-echoes
+ * answers the pings with the widths of such a trace instead of the scene
+ * (see sim::EchoTrace).
+ *
+ * --log records the sweep frames received by the client to FILE, a sweep log
+ * read back with radar_log (see radar::SweepLogWriter).
+ *
+ * --socket serves the radar to a gateway on the UNIX socket PATH instead of
+ * the simulated client, which then subscribes to nothing (see
+ * sim::SocketLink and radar_gateway). --realtime paces the virtual clock
+ * with the wall clock, as a gateway expects from a radar.
+ *
+ * --serial streams the radar over a simulated UART at --baud (921600 by
+ * default) as a wired unit does, the slave side of its pseudo terminal is
+ * printed for the host to open (see SerialLink and sim::PtyUart).
+ *
+ * --temperature sets the air temperature of the scene (20 degrees by
+ * default), the firmware converts echoes at the speed of sound of 20
+ * degrees until calibrated: --thermometer fits a TMP36 reading the air,
+ * --calibrate writes the temperature C as a client measuring it does and
+ * --reference has the firmware measure the speed of sound on the reflector
+ * at ANGLE, MM away (see SoundCalibrator).
+ *
+ * The firmware log goes to stdout, the run summary to stderr.
+ */
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <vector>
+
+#include "mbed.h"
+#include "ble/BLE.h"
+#include "events/EventQueue.h"
+#include "radar_protocol.h"
+#include "radar_service.h"
+#include "sim/pty_uart.h"
+#include "sim/radar_world.h"
+#include "sim/socket_link.h"
+#include "sim/virtual_clock.h"
+#include "sweep_log.h"
+
+namespace {
+
+/* Virtual time between two polls of the gateway socket, and between two
+ * waits for the wall clock with --realtime */
+constexpr std::chrono::milliseconds SOCKET_POLL_PERIOD(5);
+/* As serial-baud in mbed_app.json */
+constexpr int SERIAL_BAUD = 921600;
+
+void usage(const char *program)
+{
+    fprintf(stderr, "usage: %s [--seconds N] [--background CM] [--target FROM:TO:CM[:CM_PER_S]]... "
+                    "[--mtu N] [--client all|legacy|frame|objects] [--spikes RATE] [--max-range MM] "
+                    "[--servo-timing SLEW:SETTLE] [--sensor BEARING]... [--fixed] [--controller 4.1|5] "
+                    "[--stop-after S] [--profile] [--record-echoes FILE] [--replay-echoes FILE] "
+                    "[--diff MARGIN:KEYFRAME] [--log FILE] [--socket PATH] [--serial] [--baud N] "
+                    "[--realtime] [--temperature C] [--thermometer] [--calibrate C] [--reference ANGLE:MM]\r\n",
+            program);
+}
+
+const UUID RUNNING_UUID(radar::protocol::RUNNING.uuid);
+const UUID ANGLE_UUID(radar::protocol::ANGLE.uuid);
+const UUID DISTANCE_UUID(radar::protocol::DISTANCE.uuid);
+const UUID SWEEP_FRAME_UUID(radar::protocol::SWEEP_FRAME.uuid);
+const UUID MAX_RANGE_UUID(radar::protocol::MAX_RANGE.uuid);
+const UUID BUFFER_STATS_UUID(radar::protocol::BUFFER_STATS.uuid);
+const UUID POLAR_MAP_UUID(radar::protocol::POLAR_MAP.uuid);
+const UUID TRACKS_UUID(radar::protocol::TRACKS.uuid);
+const UUID LINK_UUID(radar::protocol::LINK.uuid);
+const UUID OBJECTS_UUID(radar::protocol::OBJECTS.uuid);
+const UUID PROFILE_UUID(radar::protocol::PROFILE.uuid);
+const UUID BACKGROUND_UUID(radar::protocol::BACKGROUND.uuid);
+const UUID CALIBRATION_UUID(radar::protocol::CALIBRATION.uuid);
+
+bool parse_target(const char *arg, sim::Scene::Target &target)
+{
+    target.speed_cm_s = 0.0f;
+    int fields = sscanf(arg, "%f:%f:%f:%f", &target.from_deg, &target.to_deg, &target.distance_cm, &target.speed_cm_s);
+    return fields == 3 || fields == 4;
+}
+
+bool parse_background(const char *arg, BackgroundConfig &config)
+{
+    unsigned margin;
+    unsigned keyframe;
+    if (sscanf(arg, "%u:%u", &margin, &keyframe) != 2 || margin > UINT16_MAX || keyframe > UINT8_MAX) {
+        return false;
+    }
+    config.margin_mm = static_cast<uint16_t>(margin);
+    config.keyframe_sweeps = static_cast<uint8_t>(keyframe);
+    return true;
+}
+
+bool parse_reference(const char *arg, SoundCalibration &calibration)
+{
+    unsigned angle;
+    unsigned distance;
+    if (sscanf(arg, "%u:%u", &angle, &distance) != 2 || angle > UINT8_MAX || distance > UINT16_MAX) {
+        return false;
+    }
+    calibration.reference_angle = static_cast<uint8_t>(angle);
+    calibration.reference_mm = static_cast<uint16_t>(distance);
+    return true;
+}
+
+bool parse_servo_timing(const char *arg, ServoTiming &timing)
+{
+    unsigned slew;
+    unsigned settle;
+    if (sscanf(arg, "%u:%u", &slew, &settle) != 2 || slew > UINT16_MAX || settle > UINT16_MAX) {
+        return false;
+    }
+    timing.slew_us_per_deg = static_cast<uint16_t>(slew);
+    timing.settle_us = static_cast<uint16_t>(settle);
+    return true;
+}
+
+/**
+ * Print the cycle profile as a client reads it.
+ */
+void print_profile(GattServer &server)
+{
+    uint8_t profile[CycleProfiler::MAX_SIZE];
+    uint16_t length = server.sim_client_read(server.sim_find(PROFILE_UUID), profile, sizeof(profile));
+    radar::protocol::ProfileView view;
+    if (!radar::protocol::decode(radar::protocol::PROFILE, profile, length, view)) {
+        return;
+    }
+
+    static const char *const STAGE_NAMES[PROFILE_STAGES] = {
+        "trigger", "echo wait", "convert", "servo", "publish", "GATT write"
+    };
+    const ProfileHeader &header = view.header();
+    double cycles_per_us = header.core_hz / 1e6;
+
+    fprintf(stderr, "profile:         count    min us   mean us    max us  histogram from 2^%u cycles\r\n",
+            header.first_bucket_log2);
+    for (size_t i = 0; i < view.size() && i < PROFILE_STAGES; ++i) {
+        const StageProfile &stage = view[i];
+        fprintf(stderr, "  %-12s %8lu %9.1f %9.1f %9.1f ", STAGE_NAMES[i], static_cast<unsigned long>(stage.count),
+                stage.min_cycles / cycles_per_us, stage.mean_cycles / cycles_per_us,
+                stage.max_cycles / cycles_per_us);
+        for (size_t b = 0; b < header.buckets && b < PROFILE_BUCKETS; ++b) {
+            fprintf(stderr, " %u", stage.histogram[b]);
+        }
+        fprintf(stderr, "\r\n");
+    }
+}
+
+}
+
+int main(int argc, char **argv)
+{
+    int seconds = 60;
+    sim::Scene scene;
+    bool has_targets = false;
+    sim::LinkCapabilities link_capabilities;
+    int stop_after = 0;
+    bool profile = false;
+    const char *record_path = nullptr;
+    const char *log_path = nullptr;
+    const char *socket_path = nullptr;
+    bool serial = false;
+    int baud = SERIAL_BAUD;
+    bool realtime = false;
+    sim::EchoTrace record;
+    sim::EchoTrace replay;
+    const char *client = "all";
+    float spike_rate = 0.0f;
+    int max_range_mm = 0;
+    ServoProfile servo_profile = SERVO_PROFILE;
+    std::vector<uint8_t> bearings;
+    bool fixed = false;
+    BackgroundConfig background_config = {};
+    bool has_background_config = false;
+    bool thermometer = false;
+    SoundCalibration calibration = {TEMPERATURE_UNKNOWN, 0, 0, 0, 0};
+    bool calibrated = false;
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--seconds") && i + 1 < argc) {
+            seconds = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--background") && i + 1 < argc) {
+            scene.set_background(static_cast<float>(atof(argv[++i])));
+        } else if (!strcmp(argv[i], "--mtu") && i + 1 < argc) {
+            link_capabilities.client_att_mtu = static_cast<uint16_t>(atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--max-range") && i + 1 < argc) {
+            max_range_mm = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--servo-timing") && i + 1 < argc) {
+            if (!parse_servo_timing(argv[++i], servo_profile.timing)) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (!strcmp(argv[i], "--sensor") && i + 1 < argc) {
+            int bearing = atoi(argv[++i]);
+            if (bearing < 0 || bearing > 180 || bearings.size() == MAX_SENSORS) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            bearings.push_back(static_cast<uint8_t>(bearing));
+        } else if (!strcmp(argv[i], "--diff") && i + 1 < argc) {
+            if (!parse_background(argv[++i], background_config)) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            has_background_config = true;
+        } else if (!strcmp(argv[i], "--controller") && i + 1 < argc) {
+            const char *version = argv[++i];
+            if (strcmp(version, "4.1") && strcmp(version, "5")) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            link_capabilities.data_length_extension = !strcmp(version, "5");
+            link_capabilities.phy_2m = !strcmp(version, "5");
+        } else if (!strcmp(argv[i], "--stop-after") && i + 1 < argc) {
+            stop_after = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--record-echoes") && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (!strcmp(argv[i], "--replay-echoes") && i + 1 < argc) {
+            if (!replay.load(argv[++i])) {
+                fprintf(stderr, "cannot read echo trace %s\r\n", argv[i]);
+                return EXIT_FAILURE;
+            }
+        } else if (!strcmp(argv[i], "--log") && i + 1 < argc) {
+            log_path = argv[++i];
+        } else if (!strcmp(argv[i], "--socket") && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else if (!strcmp(argv[i], "--serial")) {
+            serial = true;
+        } else if (!strcmp(argv[i], "--baud") && i + 1 < argc) {
+            baud = atoi(argv[++i]);
+            if (baud <= 0) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        } else if (!strcmp(argv[i], "--temperature") && i + 1 < argc) {
+            scene.set_temperature(static_cast<float>(atof(argv[++i])));
+            calibrated = true;
+        } else if (!strcmp(argv[i], "--thermometer")) {
+            thermometer = true;
+            calibrated = true;
+        } else if (!strcmp(argv[i], "--calibrate") && i + 1 < argc) {
+            calibration.temperature = static_cast<int16_t>(std::lround(atof(argv[++i]) * 100));
+            calibrated = true;
+        } else if (!strcmp(argv[i], "--reference") && i + 1 < argc) {
+            if (!parse_reference(argv[++i], calibration)) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            calibrated = true;
+        } else if (!strcmp(argv[i], "--realtime")) {
+            realtime = true;
+        } else if (!strcmp(argv[i], "--profile")) {
+            profile = true;
+        } else if (!strcmp(argv[i], "--fixed")) {
+            fixed = true;
+        } else if (!strcmp(argv[i], "--spikes") && i + 1 < argc) {
+            spike_rate = static_cast<float>(atof(argv[++i]));
+        } else if (!strcmp(argv[i], "--client") && i + 1 < argc) {
+            client = argv[++i];
+        } else if (!strcmp(argv[i], "--target") && i + 1 < argc) {
+            sim::Scene::Target target;
+            if (!parse_target(argv[++i], target)) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            scene.add_target(target);
+            has_targets = true;
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!has_targets) {
+        // Default scene: a wall in range with a closer object in front of it
+        scene.set_background(25.0f);
+        scene.add_target({60.0f, 80.0f, 12.0f, 0.0f});
+    }
+
+    if (bearings.empty()) {
+        bearings.push_back(0);
+    }
+
+    PwmOut servoPin(D5);
+    DigitalOut ledPin(D10);
+    AnalogIn thermometerPin(A1);
+    // TMP36: 500 mV at 0 degree, 10 mV per degree
+    thermometerPin.sim_set_voltage(0.5f + 0.01f * scene.temperature());
+    static const PinName TRIG_PINS[MAX_SENSORS] = {D6, D7, D8, D11};
+    static const PinName ECHO_PINS[MAX_SENSORS] = {D9, D12, D13, D14};
+    std::deque<DigitalOut> trigPins;
+    std::deque<InterruptIn> echoPins;
+    std::vector<RangingSensor> sensors;
+
+    sim::ServoModel servo(servoPin, servo_profile);
+    sim::Airspace airspace;
+    std::deque<sim::Hcsr04Model> sensor_models;
+    for (size_t i = 0; i < bearings.size(); ++i) {
+        trigPins.emplace_back(TRIG_PINS[i]);
+        echoPins.emplace_back(ECHO_PINS[i]);
+        sensors.push_back({trigPins.back(), echoPins.back(), bearings[i]});
+        sensor_models.emplace_back(trigPins.back(), echoPins.back(), servo, scene, airspace, bearings[i]);
+        sensor_models.back().set_spike_rate(spike_rate);
+        if (!replay.empty()) {
+            sensor_models.back().replay(&replay);
+        }
+        if (record_path) {
+            sensor_models.back().record(&record);
+        }
+    }
+
+    BLE &ble = BLE::Instance();
+    // Both queues run on the virtual clock, in timestamp order
+    events::EventQueue event_queue;
+    events::EventQueue sensor_queue;
+    RadarService radar_service(
+        {fixed ? nullptr : &servoPin, mbed::make_Span(sensors.data(), sensors.size()), ledPin,
+         thermometer ? &thermometerPin : nullptr},
+        sensor_queue
+    );
+    SerialLink serial_link(D1, D0, baud);
+    sim::PtyUart pty(serial_link);
+    if (serial) {
+        if (!pty.open()) {
+            fprintf(stderr, "cannot create a pseudo terminal\r\n");
+            return EXIT_FAILURE;
+        }
+        printf("serial link on %s at %d baud\r\n", pty.path(), baud);
+        fflush(stdout);
+        radar_service.attach_serial(serial_link);
+    }
+
+    ble.gap().sim_set_capabilities(link_capabilities);
+    radar_service.start(ble, event_queue);
+
+    GattServer &server = ble.gattServer();
+    ble.gap().sim_connect();
+    if (socket_path) {
+        // The gateway subscribes to what it needs
+    } else if (!strcmp(client, "legacy")) {
+        server.sim_subscribe(server.sim_find(ANGLE_UUID));
+        server.sim_subscribe(server.sim_find(DISTANCE_UUID));
+    } else if (!strcmp(client, "objects")) {
+        server.sim_subscribe(server.sim_find(OBJECTS_UUID));
+    } else if (!strcmp(client, "frame")) {
+        server.sim_subscribe(server.sim_find(SWEEP_FRAME_UUID));
+    } else {
+        server.sim_connect();
+    }
+
+    if (max_range_mm) {
+        uint16_t max_range = static_cast<uint16_t>(max_range_mm);
+        if (server.sim_client_write(server.sim_find(MAX_RANGE_UUID), reinterpret_cast<uint8_t *>(&max_range),
+                                    sizeof(max_range)) != AUTH_CALLBACK_REPLY_SUCCESS) {
+            fprintf(stderr, "max range %d mm rejected\r\n", max_range_mm);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if ((calibration.temperature != TEMPERATURE_UNKNOWN || calibration.reference_mm) &&
+        server.sim_client_write(server.sim_find(CALIBRATION_UUID), reinterpret_cast<uint8_t *>(&calibration),
+                                sizeof(calibration)) != AUTH_CALLBACK_REPLY_SUCCESS) {
+        fprintf(stderr, "calibration rejected\r\n");
+        return EXIT_FAILURE;
+    }
+
+    if (has_background_config &&
+        server.sim_client_write(server.sim_find(BACKGROUND_UUID), reinterpret_cast<uint8_t *>(&background_config),
+                                sizeof(background_config)) != AUTH_CALLBACK_REPLY_SUCCESS) {
+        fprintf(stderr, "background subtraction settings rejected\r\n");
+        return EXIT_FAILURE;
+    }
+
+    radar::SweepLogWriter log;
+    if (log_path) {
+        uint64_t start_time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()
+        ).count();
+        if (!log.open(log_path, start_time_us)) {
+            fprintf(stderr, "cannot write sweep log %s\r\n", log_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    sim::SocketLink socket_link(server);
+    if (socket_path && !socket_link.listen(socket_path)) {
+        fprintf(stderr, "cannot listen on %s\r\n", socket_path);
+        return EXIT_FAILURE;
+    }
+
+    // Frames as the client receives them, filed under the sweep of their header
+    GattAttribute::Handle_t frame_handle = server.sim_find(SWEEP_FRAME_UUID);
+    server.sim_on_notify([&log, &socket_link, frame_handle](GattAttribute::Handle_t handle,
+                                                            const uint8_t *data, uint16_t length) {
+        socket_link.notify(handle, data, length);
+        if (log.is_open()) {
+            radar::protocol::SweepFrameView frame;
+            if (handle != frame_handle ||
+                !radar::protocol::decode(radar::protocol::SWEEP_FRAME, data, length, frame)) {
+                return;
+            }
+            static_assert(sizeof(radar::SweepLogSample) == sizeof(SweepSample), "frame samples are logged as is");
+            const radar::SweepLogSample *samples = reinterpret_cast<const radar::SweepLogSample *>(frame.begin());
+            size_t count = frame.size();
+            log.append(sim::VirtualClock::instance().now().count(), frame.header().sweep, frame.header().sequence,
+                       samples, count);
+        }
+    });
+
+    auto wall_start = std::chrono::steady_clock::now();
+    if (socket_path || serial || realtime) {
+        // Serve the gateway between the events of the radar, waiting for the wall clock to catch up
+        auto virtual_start = sim::VirtualClock::instance().now();
+        auto poll = [&socket_link, &pty, realtime, wall_start, virtual_start]() {
+            if (realtime) {
+                std::this_thread::sleep_until(wall_start + (sim::VirtualClock::instance().now() - virtual_start));
+            }
+            socket_link.poll();
+            pty.poll();
+        };
+        sim::VirtualClock::instance().schedule_in(SOCKET_POLL_PERIOD, poll, SOCKET_POLL_PERIOD);
+    }
+
+    if (stop_after) {
+        sim::VirtualClock::instance().schedule_in(std::chrono::seconds(stop_after), [&server]() {
+            uint8_t running = 0;
+            server.sim_client_write(server.sim_find(RUNNING_UUID), &running, sizeof(running));
+        });
+    }
+
+    event_queue.dispatch_for(std::chrono::seconds(seconds));
+    auto wall_time = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - wall_start
+    );
+
+    if (record_path && !record.save(record_path)) {
+        fprintf(stderr, "cannot write echo trace %s\r\n", record_path);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t logged_blocks = log.blocks();
+    uint64_t logged_samples = log.samples();
+    if (log_path && !log.close()) {
+        fprintf(stderr, "cannot write sweep log %s\r\n", log_path);
+        return EXIT_FAILURE;
+    }
+
+    const sim::GattStats &stats = server.sim_stats();
+    double virtual_s = sim::VirtualClock::instance().now().count() / 1e6;
+    double wall_s = wall_time.count() / 1e6;
+
+    fprintf(stderr, "virtual time:    %.3f s\r\n", virtual_s);
+    fprintf(stderr, "wall time:       %.3f s (x%.0f)\r\n", wall_s, wall_s > 0 ? virtual_s / wall_s : 0.0);
+    uint64_t pings = 0;
+    uint64_t unsettled_pings = 0;
+    uint64_t crosstalk_pings = 0;
+    for (const sim::Hcsr04Model &sensor : sensor_models) {
+        pings += sensor.pings();
+        unsettled_pings += sensor.unsettled_pings();
+        crosstalk_pings += sensor.crosstalk_pings();
+    }
+    fprintf(stderr, "pings:           %llu (%.1f/s)\r\n", static_cast<unsigned long long>(pings), pings / virtual_s);
+    fprintf(stderr, "  unsettled:     %llu\r\n", static_cast<unsigned long long>(unsettled_pings));
+    fprintf(stderr, "  crosstalk:     %llu\r\n", static_cast<unsigned long long>(crosstalk_pings));
+    fprintf(stderr, "notifications:   %llu (%.1f/s)\r\n",
+            static_cast<unsigned long long>(stats.notifications), stats.notifications / virtual_s);
+    fprintf(stderr, "  angle:         %llu\r\n",
+            static_cast<unsigned long long>(server.sim_notifications(server.sim_find(ANGLE_UUID))));
+    fprintf(stderr, "  distance:      %llu\r\n",
+            static_cast<unsigned long long>(server.sim_notifications(server.sim_find(DISTANCE_UUID))));
+    fprintf(stderr, "  sweep frame:   %llu\r\n",
+            static_cast<unsigned long long>(server.sim_notifications(server.sim_find(SWEEP_FRAME_UUID))));
+    fprintf(stderr, "  objects:       %llu\r\n",
+            static_cast<unsigned long long>(server.sim_notifications(server.sim_find(OBJECTS_UUID))));
+    fprintf(stderr, "notified bytes:  %llu\r\n", static_cast<unsigned long long>(stats.notified_bytes));
+    fprintf(stderr, "airtime:         %.3f s (%.1f%%)\r\n", stats.airtime_us / 1e6,
+            100.0 * stats.airtime_us / 1e6 / virtual_s);
+    fprintf(stderr, "  wait:          %.2f ms per notification\r\n",
+            stats.notifications ? stats.notification_wait_us / 1e3 / stats.notifications : 0.0);
+    uint64_t connection_events = ble.gap().sim_connection_events();
+    fprintf(stderr, "connection events: %llu (%.1f/s)\r\n", static_cast<unsigned long long>(connection_events),
+            connection_events / virtual_s);
+    if (stats.truncated_notifications) {
+        fprintf(stderr, "truncated:       %llu\r\n", static_cast<unsigned long long>(stats.truncated_notifications));
+    }
+    LinkStatus link = {};
+    server.sim_client_read(server.sim_find(LINK_UUID), reinterpret_cast<uint8_t *>(&link), sizeof(link));
+    fprintf(stderr, "link:            ATT MTU %u, %u/%u octets, PHY %u/%u, interval %.2f ms, latency %u\r\n",
+            link.att_mtu, link.tx_octets, link.rx_octets, link.tx_phy, link.rx_phy, link.interval * 1.25,
+            link.latency);
+    SampleBufferStats buffer_stats = {};
+    uint16_t length = sizeof(buffer_stats);
+    server.read(server.sim_find(BUFFER_STATS_UUID), reinterpret_cast<uint8_t *>(&buffer_stats), &length);
+    fprintf(stderr, "sample buffer:   %u pushed, %u dropped, %u/%u peak\r\n",
+            static_cast<unsigned>(buffer_stats.pushed), static_cast<unsigned>(buffer_stats.overflows),
+            buffer_stats.high_watermark, buffer_stats.capacity);
+
+    // What a client connecting now would get in one long read
+    uint8_t map[PolarMap<SWEEP_BINS>::MAX_SIZE];
+    uint16_t map_length = server.sim_client_read(server.sim_find(POLAR_MAP_UUID), map, sizeof(map));
+    unsigned known = 0;
+    unsigned fresh = 0;
+    radar::protocol::PolarMapView cells;
+    if (radar::protocol::decode(radar::protocol::POLAR_MAP, map, map_length, cells)) {
+        for (const radar::protocol::PolarCell &cell : cells) {
+            if (cell.known()) {
+                ++known;
+                fresh += cell.age() <= 1;
+            }
+        }
+    }
+    fprintf(stderr, "polar map:       %u bytes, %u bins known, %u from the last 2 sweeps\r\n",
+            map_length, known, fresh);
+    // Objects of the last complete sweep
+    uint8_t list[ObjectSegmenter<SWEEP_BINS, MAX_OBJECTS>::MAX_SIZE];
+    uint16_t list_length = server.sim_client_read(server.sim_find(OBJECTS_UUID), list, sizeof(list));
+    radar::protocol::ObjectListView objects;
+    if (radar::protocol::decode(radar::protocol::OBJECTS, list, list_length, objects)) {
+        const ObjectListHeader &header = objects.header();
+        fprintf(stderr, "objects:         %u of %u in sweep %u\r\n", header.count, header.total, header.sweep);
+        for (const SweepObject &object : objects) {
+            fprintf(stderr, "  %3u-%3u deg    %u mm (mean %u mm)\r\n", object.start_angle, object.end_angle,
+                    object.min_distance, object.mean_distance);
+        }
+    }
+    // Tracks after the last complete sweep
+    uint8_t tracks[ObjectTracker<MAX_TRACKS>::MAX_SIZE];
+    uint16_t tracks_length = server.sim_client_read(server.sim_find(TRACKS_UUID), tracks, sizeof(tracks));
+    radar::protocol::TrackListView track_list;
+    if (radar::protocol::decode(radar::protocol::TRACKS, tracks, tracks_length, track_list)) {
+        fprintf(stderr, "tracks:          %u in sweep %u\r\n", track_list.header().count, track_list.header().sweep);
+        for (const ObjectTrack &track : track_list) {
+            fprintf(stderr, "  #%-3u %3u deg   %u mm, %+d mm/s, %u sweeps\r\n", track.id, track.bearing,
+                    track.range, track.velocity, track.hits);
+        }
+    }
+    if (calibrated) {
+        SoundCalibration state = {};
+        server.sim_client_read(server.sim_find(CALIBRATION_UUID), reinterpret_cast<uint8_t *>(&state), sizeof(state));
+        fprintf(stderr, "calibration:     %.1f m/s (air %.1f m/s at %.1f C), flags 0x%02x",
+                state.sound_speed / 1e3, scene.sound_speed() * 1e4, scene.temperature(), state.flags);
+        if (state.temperature != TEMPERATURE_UNKNOWN) {
+            fprintf(stderr, ", temperature %.2f C", state.temperature / 100.0);
+        }
+        fprintf(stderr, "\r\n");
+    }
+    if (socket_path) {
+        fprintf(stderr, "socket:          %llu gateways, %llu notifications forwarded, %llu dropped\r\n",
+                static_cast<unsigned long long>(socket_link.gateways()),
+                static_cast<unsigned long long>(socket_link.forwarded()),
+                static_cast<unsigned long long>(socket_link.dropped()));
+    }
+    if (serial) {
+        const SerialFrameDecoder &decoder = serial_link.decoder();
+        uint64_t line_bytes = pty.sent() + pty.dropped();
+        fprintf(stderr, "serial:          %u frames sent, %u dropped, %llu bytes at %d baud (%.1f%% of the line), "
+                        "%llu not read by the host\r\n",
+                static_cast<unsigned>(serial_link.sent()), static_cast<unsigned>(serial_link.dropped()),
+                static_cast<unsigned long long>(line_bytes), baud, 100.0 * line_bytes * 10 / baud / virtual_s,
+                static_cast<unsigned long long>(pty.dropped()));
+        fprintf(stderr, "  received:      %u frames, %u CRC errors, %u framing errors, %u bytes overflowed\r\n",
+                static_cast<unsigned>(decoder.frames()), static_cast<unsigned>(decoder.crc_errors()),
+                static_cast<unsigned>(decoder.framing_errors()), static_cast<unsigned>(serial_link.rx_overflows()));
+    }
+    if (log_path) {
+        fprintf(stderr, "sweep log:       %llu frames, %llu samples in %s\r\n",
+                static_cast<unsigned long long>(logged_blocks), static_cast<unsigned long long>(logged_samples),
+                log_path);
+    }
+    if (profile) {
+        print_profile(server);
+    }
+    fprintf(stderr, "clock events:    %llu\r\n",
+            static_cast<unsigned long long>(sim::VirtualClock::instance().events_run()));
+
+    return EXIT_SUCCESS;
+}
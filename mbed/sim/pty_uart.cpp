@@ -0,0 +1,90 @@
+#include "sim/pty_uart.h"
+
+#include <cerrno>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace sim {
+
+PtyUart::PtyUart(mbed::SerialBase &serial) :
+    _serial(serial)
+{
+}
+
+PtyUart::~PtyUart()
+{
+    _serial.sim_on_transmit(nullptr);
+    if (_slave >= 0) {
+        close(_slave);
+    }
+    if (_master >= 0) {
+        close(_master);
+    }
+}
+
+bool PtyUart::open()
+{
+    _master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (_master < 0 || grantpt(_master) != 0 || unlockpt(_master) != 0 || !ptsname(_master)) {
+        return false;
+    }
+    _path = ptsname(_master);
+    _slave = ::open(_path.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (_slave < 0) {
+        return false;
+    }
+
+    // Frames are binary: no echo, no line editing, no translation of CR and LF
+    termios attributes;
+    if (tcgetattr(_slave, &attributes) != 0) {
+        return false;
+    }
+    cfmakeraw(&attributes);
+    cfsetspeed(&attributes, B921600);
+    if (tcsetattr(_slave, TCSANOW, &attributes) != 0) {
+        return false;
+    }
+
+    _serial.sim_on_transmit([this](const uint8_t *data, size_t size) {
+        transmit(data, size);
+    });
+    return true;
+}
+
+void PtyUart::poll()
+{
+    if (_master < 0) {
+        return;
+    }
+    uint8_t buffer[256];
+    for (;;) {
+        ssize_t size = read(_master, buffer, sizeof(buffer));
+        if (size <= 0) {
+            break;
+        }
+        _received += size;
+        _serial.sim_receive(buffer, static_cast<size_t>(size));
+    }
+}
+
+void PtyUart::transmit(const uint8_t *data, size_t size)
+{
+    size_t written = 0;
+    while (written < size) {
+        ssize_t result = write(_master, data + written, size - written);
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        written += result;
+    }
+    _sent += written;
+    _dropped += size - written;
+}
+
+}
@@ -0,0 +1,259 @@
+#include "sim/radar_world.h"
+#include "sim/virtual_clock.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace sim {
+
+constexpr std::chrono::microseconds Hcsr04Model::BURST_DELAY;
+constexpr std::chrono::microseconds Hcsr04Model::NO_ECHO_WIDTH;
+constexpr float Hcsr04Model::MAX_RANGE_CM;
+constexpr float Airspace::BEAM_WIDTH_DEG;
+constexpr float Scene::SOUND_SPEED_20C;
+constexpr float Scene::SOUND_SPEED_PER_DEGREE;
+
+float Scene::distance_at(float angle_deg) const
+{
+    float distance = _background_cm;
+    float elapsed_s = VirtualClock::instance().now().count() / 1e6f;
+    for (const Target &target : _targets) {
+        if (angle_deg < target.from_deg || angle_deg > target.to_deg) {
+            continue;
+        }
+        float target_cm = target.distance_cm + target.speed_cm_s * elapsed_s;
+        if (target_cm < 0) {
+            continue;
+        }
+        if (distance < 0 || target_cm < distance) {
+            distance = target_cm;
+        }
+    }
+    return distance;
+}
+
+ServoModel::ServoModel(mbed::PwmOut &pwm, const ServoProfile &profile) :
+    _profile(profile)
+{
+    pwm.sim_on_change([this](int pulse_us) { on_pulse(pulse_us); });
+}
+
+float ServoModel::angle() const
+{
+    std::chrono::microseconds elapsed = VirtualClock::instance().now() - _departure;
+    float travel_us = std::fabs(_to_deg - _from_deg) * _profile.timing.slew_us_per_deg;
+    if (elapsed.count() >= travel_us) {
+        return _to_deg;
+    }
+    return _from_deg + (_to_deg - _from_deg) * elapsed.count() / travel_us;
+}
+
+bool ServoModel::settled() const
+{
+    float travel_us = std::fabs(_to_deg - _from_deg) * _profile.timing.slew_us_per_deg;
+    std::chrono::microseconds elapsed = VirtualClock::instance().now() - _departure;
+    return _latch_event == 0 && elapsed.count() >= travel_us + _profile.timing.settle_us;
+}
+
+void ServoModel::on_pulse(int pulse_us)
+{
+    if (pulse_us < _profile.min_pulse_us) {
+        pulse_us = _profile.min_pulse_us;
+    } else if (pulse_us > _profile.max_pulse_us) {
+        pulse_us = _profile.max_pulse_us;
+    }
+    float angle_deg = (pulse_us - _profile.min_pulse_us) * 180.0f / (_profile.max_pulse_us - _profile.min_pulse_us);
+
+    // Only the last width written during a frame is output
+    VirtualClock &clock = VirtualClock::instance();
+    if (_latch_event) {
+        clock.cancel(_latch_event);
+    }
+    int64_t frame = _profile.frame_us;
+    VirtualClock::time_point next_frame((clock.now().count() + frame - 1) / frame * frame);
+    _latch_event = clock.schedule(next_frame, [this, angle_deg]() { latch(angle_deg); });
+}
+
+void ServoModel::latch(float angle_deg)
+{
+    _latch_event = 0;
+    _from_deg = angle();
+    _to_deg = angle_deg;
+    _departure = VirtualClock::instance().now();
+}
+
+void Airspace::emit(const Hcsr04Model *sensor, float bearing_deg, std::chrono::microseconds until)
+{
+    for (Burst &burst : _bursts) {
+        if (burst.sensor == sensor) {
+            burst.bearing_deg = bearing_deg;
+            burst.until = until;
+            return;
+        }
+    }
+    _bursts.push_back({sensor, bearing_deg, until});
+}
+
+bool Airspace::crosstalk(const Hcsr04Model *sensor, float bearing_deg) const
+{
+    std::chrono::microseconds now = VirtualClock::instance().now();
+    for (const Burst &burst : _bursts) {
+        if (burst.sensor != sensor && burst.until > now &&
+            std::fabs(burst.bearing_deg - bearing_deg) < BEAM_WIDTH_DEG) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Hcsr04Model::Hcsr04Model(mbed::DigitalOut &trig, mbed::InterruptIn &echo, const ServoModel &servo, const Scene &scene,
+                         Airspace &airspace, float bearing) :
+    _echo(echo),
+    _servo(servo),
+    _scene(scene),
+    _airspace(airspace),
+    _bearing(bearing)
+{
+    trig.sim_on_change([this](int level) { on_trigger(level); });
+}
+
+void Hcsr04Model::on_trigger(int level)
+{
+    VirtualClock &clock = VirtualClock::instance();
+
+    if (level) {
+        _trigger_rise = clock.now();
+        return;
+    }
+
+    // Short pulses and triggers during a measurement are ignored
+    if (_busy || clock.now() - _trigger_rise < std::chrono::microseconds(10)) {
+        return;
+    }
+
+    _busy = true;
+    ++_pings;
+    if (!_servo.settled()) {
+        ++_unsettled_pings;
+    }
+
+    float bearing = _servo.angle() + _bearing;
+    if (_airspace.crosstalk(this, bearing)) {
+        ++_crosstalk_pings;
+    }
+
+    float distance = _scene.distance_at(bearing);
+    std::chrono::microseconds width = NO_ECHO_WIDTH;
+    if (distance >= 0 && distance <= MAX_RANGE_CM) {
+        width = std::chrono::microseconds(static_cast<int64_t>(2 * distance / _scene.sound_speed()));
+    }
+
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    if (_spike_rate > 0 && uniform(_random) < _spike_rate) {
+        width = std::chrono::microseconds(static_cast<int64_t>(2 * uniform(_random) * MAX_RANGE_CM / _scene.sound_speed()));
+    }
+
+    int bearing_deg = static_cast<int>(std::lround(bearing));
+    if (_replay) {
+        std::chrono::microseconds replayed = _replay->width_at(bearing_deg, clock.now());
+        if (replayed >= std::chrono::microseconds::zero()) {
+            width = replayed;
+        }
+    }
+    if (_record) {
+        _record->add(clock.now(), bearing_deg, width);
+    }
+
+    _airspace.emit(this, bearing, clock.now() + BURST_DELAY + width);
+    clock.schedule_in(BURST_DELAY, [this]() { _echo.sim_drive(1); });
+    clock.schedule_in(BURST_DELAY + width, [this]() {
+        _echo.sim_drive(0);
+        _busy = false;
+    });
+}
+
+void EchoTrace::add(std::chrono::microseconds time, int bearing_deg, std::chrono::microseconds width)
+{
+    _pings[bearing_deg].push_back({time, width});
+    if (time >= _duration) {
+        _duration = time + std::chrono::microseconds(1);
+    }
+    ++_size;
+}
+
+std::chrono::microseconds EchoTrace::width_at(int bearing_deg, std::chrono::microseconds now) const
+{
+    auto it = _pings.find(bearing_deg);
+    if (it == _pings.end() || it->second.empty()) {
+        return std::chrono::microseconds(-1);
+    }
+
+    // Last ping at or before the same time into the trace, the previous
+    // round's last one before the first
+    const std::vector<Ping> &pings = it->second;
+    std::chrono::microseconds at = now % _duration;
+    const Ping *found = &pings.back();
+    for (const Ping &ping : pings) {
+        if (ping.time > at) {
+            break;
+        }
+        found = &ping;
+    }
+    return found->width;
+}
+
+bool EchoTrace::load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    char line[128];
+    bool ok = true;
+    while (fgets(line, sizeof(line), file)) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        long long time_us;
+        int bearing_deg;
+        long long width_us;
+        if (sscanf(line, "%lld %d %lld", &time_us, &bearing_deg, &width_us) != 3 || time_us < 0 || width_us < 0) {
+            ok = false;
+            break;
+        }
+        add(std::chrono::microseconds(time_us), bearing_deg, std::chrono::microseconds(width_us));
+    }
+    fclose(file);
+    return ok && !empty();
+}
+
+bool EchoTrace::save(const char *path) const
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return false;
+    }
+
+    // Back in time order across bearings
+    std::vector<std::pair<std::chrono::microseconds, std::pair<int, std::chrono::microseconds>>> pings;
+    for (const auto &entry : _pings) {
+        for (const Ping &ping : entry.second) {
+            pings.push_back({ping.time, {entry.first, ping.width}});
+        }
+    }
+    std::stable_sort(pings.begin(), pings.end(), [](const decltype(pings)::value_type &a,
+                                                    const decltype(pings)::value_type &b) {
+        return a.first < b.first;
+    });
+
+    fprintf(file, "# radar echo trace: time_us bearing_deg width_us\n");
+    for (const auto &ping : pings) {
+        fprintf(file, "%lld %d %lld\n", static_cast<long long>(ping.first.count()), ping.second.first,
+                static_cast<long long>(ping.second.second.count()));
+    }
+    return fclose(file) == 0;
+}
+
+} // namespace sim
@@ -0,0 +1,178 @@
+#include "sim/socket_link.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "socket_protocol.h"
+
+namespace sim {
+
+namespace {
+
+/* Notifications queued in the kernel for a slow gateway, about 2 s of a
+ * radar streaming at full speed */
+constexpr int SEND_BUFFER_SIZE = 1 << 20;
+
+}
+
+SocketLink::SocketLink(GattServer &server) :
+    _server(server)
+{
+    for (const radar::protocol::Schema &schema : radar::protocol::SCHEMAS) {
+        _characteristics.push_back({radar::protocol::parse_uuid(schema.uuid), _server.sim_find(UUID(schema.uuid))});
+    }
+}
+
+SocketLink::~SocketLink()
+{
+    disconnect();
+    if (_listener >= 0) {
+        close(_listener);
+        unlink(_path.c_str());
+    }
+}
+
+bool SocketLink::listen(const char *path)
+{
+    sockaddr_un address = {};
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    _listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (_listener < 0) {
+        return false;
+    }
+    unlink(path);
+    if (bind(_listener, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+        ::listen(_listener, 1) != 0) {
+        close(_listener);
+        _listener = -1;
+        return false;
+    }
+    _path = path;
+    return true;
+}
+
+void SocketLink::poll()
+{
+    if (_peer < 0 && _listener >= 0) {
+        _peer = accept4(_listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (_peer < 0) {
+            return;
+        }
+        setsockopt(_peer, SOL_SOCKET, SO_SNDBUF, &SEND_BUFFER_SIZE, sizeof(SEND_BUFFER_SIZE));
+        ++_gateways;
+        printf("gateway connected on %s\r\n", _path.c_str());
+    }
+
+    uint8_t message[radar::SOCKET_MESSAGE_MAX_SIZE];
+    while (_peer >= 0) {
+        ssize_t size = recv(_peer, message, sizeof(message), 0);
+        if (size > 0) {
+            serve(message, size);
+        } else if (size == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            printf("gateway disconnected from %s\r\n", _path.c_str());
+            disconnect();
+        } else {
+            break;
+        }
+    }
+}
+
+void SocketLink::notify(GattAttribute::Handle_t handle, const uint8_t *data, uint16_t length)
+{
+    if (_peer < 0) {
+        return;
+    }
+    const Characteristic *characteristic = find(handle);
+    if (!characteristic) {
+        return;
+    }
+    if (send(0, *characteristic, data, length)) {
+        ++_forwarded;
+    } else {
+        ++_dropped;
+    }
+}
+
+const SocketLink::Characteristic *SocketLink::find(const uint8_t *uuid) const
+{
+    for (const Characteristic &characteristic : _characteristics) {
+        if (memcmp(characteristic.uuid.bytes, uuid, sizeof(characteristic.uuid.bytes)) == 0) {
+            return &characteristic;
+        }
+    }
+    return nullptr;
+}
+
+const SocketLink::Characteristic *SocketLink::find(GattAttribute::Handle_t handle) const
+{
+    for (const Characteristic &characteristic : _characteristics) {
+        if (characteristic.handle == handle) {
+            return &characteristic;
+        }
+    }
+    return nullptr;
+}
+
+void SocketLink::serve(const uint8_t *message, size_t size)
+{
+    if (size < sizeof(radar::SocketMessageHeader)) {
+        return;
+    }
+    const radar::SocketMessageHeader *header = reinterpret_cast<const radar::SocketMessageHeader *>(message);
+    const Characteristic *characteristic = find(header->uuid);
+    if (!characteristic) {
+        return;
+    }
+    const uint8_t *value = message + sizeof(radar::SocketMessageHeader);
+    size_t value_size = size - sizeof(radar::SocketMessageHeader);
+
+    switch (static_cast<radar::SocketMessageType>(header->type)) {
+        case radar::SocketMessageType::Subscribe:
+            _server.sim_subscribe(characteristic->handle);
+            break;
+        case radar::SocketMessageType::Write:
+            _server.sim_client_write(characteristic->handle, value, static_cast<uint16_t>(value_size));
+            break;
+        case radar::SocketMessageType::Read: {
+            uint8_t buffer[radar::protocol::MAX_ATTRIBUTE_SIZE];
+            uint16_t length = _server.sim_client_read(characteristic->handle, buffer, sizeof(buffer));
+            send(radar::SOCKET_VALUE_READ, *characteristic, buffer, length);
+            break;
+        }
+        case radar::SocketMessageType::Value:
+            break;
+    }
+}
+
+bool SocketLink::send(uint8_t flags, const Characteristic &characteristic, const uint8_t *data, size_t size)
+{
+    uint8_t message[radar::SOCKET_MESSAGE_MAX_SIZE];
+    if (size > radar::protocol::MAX_ATTRIBUTE_SIZE) {
+        return false;
+    }
+    radar::SocketMessageHeader header = {static_cast<uint8_t>(radar::SocketMessageType::Value), flags, {}};
+    memcpy(header.uuid, characteristic.uuid.bytes, sizeof(header.uuid));
+    memcpy(message, &header, sizeof(header));
+    memcpy(message + sizeof(header), data, size);
+    return ::send(_peer, message, sizeof(header) + size, MSG_NOSIGNAL) >= 0;
+}
+
+void SocketLink::disconnect()
+{
+    if (_peer >= 0) {
+        close(_peer);
+        _peer = -1;
+    }
+}
+
+}
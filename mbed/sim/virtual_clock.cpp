@@ -0,0 +1,78 @@
+#include "sim/virtual_clock.h"
+
+namespace sim {
+
+VirtualClock &VirtualClock::instance()
+{
+    static VirtualClock clock;
+    return clock;
+}
+
+int VirtualClock::schedule(time_point at, std::function<void()> fn, duration period)
+{
+    int id = _next_id++;
+    if (_next_id <= 0) {
+        _next_id = 1;
+    }
+
+    Key key(at.count(), _sequence++);
+    _events.emplace(key, Event{id, period, std::move(fn)});
+    _keys.emplace(id, key);
+    return id;
+}
+
+bool VirtualClock::cancel(int id)
+{
+    auto it = _keys.find(id);
+    if (it == _keys.end()) {
+        return false;
+    }
+
+    _events.erase(it->second);
+    _keys.erase(it);
+    return true;
+}
+
+void VirtualClock::run_until(time_point until)
+{
+    while (!_events.empty()) {
+        auto it = _events.begin();
+        if (it->first.first > until.count()) {
+            break;
+        }
+
+        Event event = std::move(it->second);
+        int64_t at = it->first.first;
+        _events.erase(it);
+        _keys.erase(event.id);
+
+        // Late events, e.g. behind a busy wait, run at the current time
+        if (at > _now.count()) {
+            _now = time_point(at);
+        }
+
+        if (event.period > duration::zero()) {
+            // Re-arm before running so that the event can cancel itself
+            Key key(at + event.period.count(), _sequence++);
+            _keys.emplace(event.id, key);
+            _events.emplace(key, Event{event.id, event.period, event.fn});
+        }
+
+        ++_events_run;
+        event.fn();
+    }
+
+    if (until > _now) {
+        _now = until;
+    }
+}
+
+void VirtualClock::reset()
+{
+    _events.clear();
+    _keys.clear();
+    _now = time_point(0);
+    _events_run = 0;
+}
+
+} // namespace sim
@@ -0,0 +1,122 @@
+#ifndef BACKGROUND_MODEL_H
+#define BACKGROUND_MODEL_H
+
+#include "mbed.h"
+#include "radar_protocol.h"
+#include <cstddef>
+#include <cstdint>
+
+using radar::protocol::BackgroundConfig;
+
+/**
+ * Learns the static scene seen in every direction and tells the samples
+ * worth sending apart.
+ *
+ * The background of a bin is a slow moving average of its readings, in mm
+ * Q4. A sample is foreground while the bin is still being learnt or when it
+ * differs from the background by more than the margin. An object that
+ * stays still long enough ends up in the background.
+ *
+ * Every keyframe sweep all the samples are foreground so that clients
+ * resynchronise with the background.
+ *
+ * @tparam Bins number of angle bins, one per degree.
+ */
+template<size_t Bins>
+class BackgroundModel {
+public:
+    /* readings of a bin before it has a background */
+    static constexpr uint8_t LEARN_SAMPLES = 4;
+    /* new readings weigh 1/8 in the background */
+    static constexpr unsigned WEIGHT_SHIFT = 3;
+
+    explicit BackgroundModel(const BackgroundConfig &config) : _config(config)
+    {
+    }
+
+    void configure(const BackgroundConfig &config)
+    {
+        _config = config;
+    }
+
+    const BackgroundConfig &config() const
+    {
+        return _config;
+    }
+
+    /**
+     * Learn the distance measured at angle during the given sweep.
+     *
+     * @return true if the sample must be sent.
+     */
+    bool update(uint8_t angle, uint16_t distance_mm, uint16_t sweep)
+    {
+        start(sweep);
+
+        if (angle >= Bins) {
+            return true;
+        }
+
+        Bin &bin = _bins[angle];
+        uint32_t distance_q4 = static_cast<uint32_t>(distance_mm) << 4;
+        bool foreground = true;
+
+        if (bin.samples == 0) {
+            bin.background_q4 = distance_q4;
+        } else {
+            uint16_t background = static_cast<uint16_t>((bin.background_q4 + 8) >> 4);
+            uint16_t change = distance_mm > background ? distance_mm - background : background - distance_mm;
+            foreground = bin.samples < LEARN_SAMPLES || change > _config.margin_mm;
+
+            int32_t delta = static_cast<int32_t>(distance_q4) - static_cast<int32_t>(bin.background_q4);
+            bin.background_q4 = static_cast<uint32_t>(static_cast<int32_t>(bin.background_q4) + delta / (1 << WEIGHT_SHIFT));
+        }
+
+        if (bin.samples < LEARN_SAMPLES) {
+            ++bin.samples;
+        }
+
+        return foreground || _config.margin_mm == 0 || keyframe();
+    }
+
+    /**
+     * true if every sample of the current sweep is sent.
+     */
+    bool keyframe() const
+    {
+        return _config.keyframe_sweeps && _since_keyframe == 0;
+    }
+
+private:
+    /*
+     * Count the sweeps since the last keyframe, rather than a modulo of the
+     * sweep counter which would break the period every time it wraps.
+     */
+    void start(uint16_t sweep)
+    {
+        if (_started && sweep == _sweep) {
+            return;
+        }
+
+        if (!_started || _since_keyframe + 1u >= _config.keyframe_sweeps) {
+            _since_keyframe = 0;
+        } else {
+            ++_since_keyframe;
+        }
+        _sweep = sweep;
+        _started = true;
+    }
+
+    struct Bin {
+        uint32_t background_q4;
+        uint8_t samples;
+    };
+
+    BackgroundConfig _config;
+    Bin _bins[Bins] = {};
+    uint16_t _sweep = 0;        /* sweep of the last sample */
+    uint8_t _since_keyframe = 0; /* sweeps since the last keyframe */
+    bool _started = false;
+};
+
+#endif // BACKGROUND_MODEL_H
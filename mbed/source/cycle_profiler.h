@@ -0,0 +1,151 @@
+#ifndef CYCLE_PROFILER_H
+#define CYCLE_PROFILER_H
+
+#include "mbed.h"
+#include "cmsis.h"
+#include "platform/Span.h"
+#include "radar_protocol.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Stages of the measurement and publish path.
+ */
+enum class ProfileStage : uint8_t {
+    Trigger,        /* arming the echo channels and the trigger pulse */
+    EchoWait,       /* end of the trigger to the echoes processed */
+    Convert,        /* echo width to filtered distance and sample */
+    Servo,          /* motion model and pulse width update */
+    Publish,        /* sample into map, background, objects and frame */
+    GattWrite,      /* one characteristic write of the publish path */
+};
+
+using radar::protocol::PROFILE_STAGES;
+using radar::protocol::PROFILE_BUCKETS;
+using radar::protocol::PROFILE_FIRST_BUCKET_LOG2;
+using radar::protocol::StageProfile;
+using radar::protocol::ProfileHeader;
+
+static_assert(static_cast<size_t>(ProfileStage::GattWrite) + 1 == PROFILE_STAGES, "one profile per stage");
+
+/**
+ * Cycle counter of the core, the DWT CYCCNT register.
+ *
+ * It wraps every 2^32 cycles (51 s at 84 MHz), differences stay valid for
+ * stages shorter than that.
+ */
+struct CycleCounter {
+    static void enable()
+    {
+        CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+        DWT->CYCCNT = 0;
+        DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    }
+
+    static uint32_t now()
+    {
+        return DWT->CYCCNT;
+    }
+};
+
+/**
+ * Minimum, maximum, mean and log2 histogram of the cycles spent per stage.
+ *
+ * A stage is recorded from one thread, the start is taken with
+ * CycleCounter::now() and record() closes it. Recording and reading the
+ * profile run in a critical section so that clients never see a stage half
+ * updated.
+ */
+class CycleProfiler {
+public:
+    static constexpr size_t MAX_SIZE = sizeof(ProfileHeader) + PROFILE_STAGES * sizeof(StageProfile);
+
+    CycleProfiler()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        CriticalSectionLock lock;
+        for (size_t i = 0; i < PROFILE_STAGES; ++i) {
+            _stages[i] = Stage{0, UINT32_MAX, 0, 0, {}};
+        }
+    }
+
+    /**
+     * Close a stage started at start.
+     */
+    void record(ProfileStage stage, uint32_t start)
+    {
+        uint32_t cycles = CycleCounter::now() - start;
+
+        CriticalSectionLock lock;
+        Stage &s = _stages[static_cast<size_t>(stage)];
+        ++s.count;
+        s.total += cycles;
+        if (cycles < s.min_cycles) {
+            s.min_cycles = cycles;
+        }
+        if (cycles > s.max_cycles) {
+            s.max_cycles = cycles;
+        }
+        uint16_t &bucket = s.histogram[bucket_of(cycles)];
+        if (bucket != UINT16_MAX) {
+            ++bucket;
+        }
+    }
+
+    /**
+     * Snapshot of every stage for the diagnostics characteristic.
+     */
+    mbed::Span<const uint8_t> bytes()
+    {
+        _profile.header = ProfileHeader{SystemCoreClock, PROFILE_STAGES, PROFILE_BUCKETS, PROFILE_FIRST_BUCKET_LOG2};
+
+        CriticalSectionLock lock;
+        for (size_t i = 0; i < PROFILE_STAGES; ++i) {
+            const Stage &s = _stages[i];
+            StageProfile &out = _profile.stages[i];
+            out.count = s.count;
+            out.min_cycles = s.count ? s.min_cycles : 0;
+            out.max_cycles = s.max_cycles;
+            out.mean_cycles = s.count ? static_cast<uint32_t>(s.total / s.count) : 0;
+            for (size_t b = 0; b < PROFILE_BUCKETS; ++b) {
+                out.histogram[b] = s.histogram[b];
+            }
+        }
+
+        return mbed::Span<const uint8_t>(reinterpret_cast<const uint8_t *>(&_profile), sizeof(_profile));
+    }
+
+private:
+    struct Stage {
+        uint32_t count;
+        uint32_t min_cycles;
+        uint32_t max_cycles;
+        uint64_t total;
+        uint16_t histogram[PROFILE_BUCKETS];
+    };
+
+    MBED_PACKED(struct) Profile {
+        ProfileHeader header;
+        StageProfile stages[PROFILE_STAGES];
+    };
+
+    static size_t bucket_of(uint32_t cycles)
+    {
+        size_t bucket = 0;
+        cycles >>= PROFILE_FIRST_BUCKET_LOG2;
+        while (cycles && bucket < PROFILE_BUCKETS - 1) {
+            cycles >>= 1;
+            ++bucket;
+        }
+        return bucket;
+    }
+
+    Stage _stages[PROFILE_STAGES];
+    Profile _profile;
+};
+
+#endif // CYCLE_PROFILER_H
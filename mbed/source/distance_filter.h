@@ -0,0 +1,127 @@
+#ifndef DISTANCE_FILTER_H
+#define DISTANCE_FILTER_H
+
+#include "mbed.h"
+#include "radar_protocol.h"
+#include <cstddef>
+#include <cstdint>
+
+using radar::protocol::DistanceFilterConfig;
+
+/**
+ * Outlier rejection for the distances measured in each angle bin.
+ *
+ * Each bin keeps the last readings taken in its direction. A new reading is
+ * replaced by the median of that sliding window, which drops isolated
+ * spikes, then smoothed by an exponential moving average. Storage is fixed,
+ * nothing is allocated.
+ *
+ * @tparam Bins number of angle bins.
+ * @tparam MaxWindow largest median window supported.
+ */
+template<size_t Bins, size_t MaxWindow>
+class DistanceFilter {
+    static_assert(MaxWindow >= 1 && MaxWindow <= 255, "invalid median window");
+
+public:
+    DistanceFilter(const DistanceFilterConfig &config)
+    {
+        configure(config);
+    }
+
+    /**
+     * Apply new settings, the history of every bin is cleared.
+     *
+     * @return false if the settings are out of range, nothing changes then.
+     */
+    bool configure(const DistanceFilterConfig &config)
+    {
+        if (config.median_window < 1 || config.median_window > MaxWindow) {
+            return false;
+        }
+
+        _config = config;
+        reset();
+        return true;
+    }
+
+    const DistanceFilterConfig &config() const
+    {
+        return _config;
+    }
+
+    void reset()
+    {
+        for (size_t i = 0; i < Bins; ++i) {
+            _bins[i].count = 0;
+            _bins[i].next = 0;
+        }
+    }
+
+    /**
+     * Add a reading and get the filtered distance of the bin.
+     *
+     * @param[in] bin Angle bin of the reading, ignored when out of range.
+     * @param[in] distance_mm Raw reading.
+     */
+    uint16_t update(size_t bin, uint16_t distance_mm)
+    {
+        if (bin >= Bins) {
+            return distance_mm;
+        }
+
+        Bin &state = _bins[bin];
+        state.window[state.next] = distance_mm;
+        state.next = (state.next + 1) % _config.median_window;
+        bool first = state.count == 0;
+        if (state.count < _config.median_window) {
+            ++state.count;
+        }
+
+        uint32_t median = median_of(state);
+
+        // Average kept in Q8 to not lose the fractional part between updates
+        uint32_t weight = _config.ema_weight;
+        if (first || weight == 0) {
+            state.average_q8 = median << 8;
+        } else {
+            int32_t error = static_cast<int32_t>(median << 8) - static_cast<int32_t>(state.average_q8);
+            state.average_q8 += (error * static_cast<int32_t>(weight)) / 256;
+        }
+
+        return static_cast<uint16_t>((state.average_q8 + 128) >> 8);
+    }
+
+private:
+    struct Bin {
+        uint16_t window[MaxWindow];
+        uint32_t average_q8;
+        uint8_t count;
+        uint8_t next;
+    };
+
+    static uint32_t median_of(const Bin &state)
+    {
+        uint16_t sorted[MaxWindow];
+        for (uint8_t i = 0; i < state.count; ++i) {
+            // Insertion sort, the window is tiny
+            uint16_t value = state.window[i];
+            uint8_t j = i;
+            while (j > 0 && sorted[j - 1] > value) {
+                sorted[j] = sorted[j - 1];
+                --j;
+            }
+            sorted[j] = value;
+        }
+
+        if (state.count % 2) {
+            return sorted[state.count / 2];
+        }
+        return (sorted[state.count / 2 - 1] + sorted[state.count / 2] + 1) / 2;
+    }
+
+    DistanceFilterConfig _config;
+    Bin _bins[Bins] = {};
+};
+
+#endif // DISTANCE_FILTER_H
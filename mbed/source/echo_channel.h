@@ -0,0 +1,152 @@
+#ifndef ECHO_CHANNEL_H
+#define ECHO_CHANNEL_H
+
+#include "mbed.h"
+#include "platform/Callback.h"
+#include <chrono>
+
+/**
+ * Captures the echo of one HC-SR04 with its edge interrupts.
+ *
+ * arm() is called right before the trigger pulse. The edges are then
+ * timestamped in interrupt context and the completion callback is called,
+ * still in interrupt context, once the echo fell or timed out. A missing or
+ * too long echo is reported as out of range.
+ */
+class EchoChannel {
+public:
+    /**
+     * Progress of the measurement in flight.
+     */
+    enum class State {
+        Idle,       /* no measurement in progress */
+        Triggered,  /* ping sent, waiting for the echo to rise */
+        Echoing,    /* echo high, waiting for it to fall */
+        Done        /* echo captured, waiting for release() */
+    };
+
+    /**
+     * Attach the channel to the echo line of a sensor.
+     *
+     * @param[in] echo Echo line of the sensor.
+     * @param[in] timer Running timer the edges are timestamped with.
+     * @param[in] done Called in interrupt context when the echo is captured.
+     */
+    void bind(InterruptIn &echo, Timer &timer, mbed::Callback<void()> done)
+    {
+        _timer = &timer;
+        _done = done;
+        echo.rise(mbed::callback(this, &EchoChannel::on_rise));
+        echo.fall(mbed::callback(this, &EchoChannel::on_fall));
+    }
+
+    /**
+     * Expect an echo of the ping about to be triggered.
+     *
+     * @param[in] rise_timeout Time allowed until the echo rises.
+     * @param[in] echo_timeout Longest echo accepted.
+     */
+    void arm(std::chrono::microseconds rise_timeout, std::chrono::microseconds echo_timeout)
+    {
+        _echo_timeout = echo_timeout;
+        _state = State::Triggered;
+        _timeout.attach(mbed::callback(this, &EchoChannel::on_timeout), rise_timeout);
+    }
+
+    State state() const
+    {
+        return _state;
+    }
+
+    /**
+     * Time the echo went high, valid once Done.
+     */
+    std::chrono::microseconds start() const
+    {
+        return _start;
+    }
+
+    /**
+     * Round trip time, valid once Done.
+     */
+    std::chrono::microseconds width() const
+    {
+        return _width;
+    }
+
+    /**
+     * true if something reflected within range, valid once Done.
+     */
+    bool in_range() const
+    {
+        return _width < _echo_timeout;
+    }
+
+    /**
+     * Make the channel available for the next ping.
+     */
+    void release()
+    {
+        _state = State::Idle;
+    }
+
+private:
+    /**
+     * Echo rising edge, called in interrupt context.
+     */
+    void on_rise(void)
+    {
+        CriticalSectionLock lock;
+        if (_state != State::Triggered) {
+            return;
+        }
+
+        _start = _timer->elapsed_time();
+        _state = State::Echoing;
+        _timeout.attach(mbed::callback(this, &EchoChannel::on_timeout), _echo_timeout);
+    }
+
+    /**
+     * Echo falling edge, called in interrupt context.
+     */
+    void on_fall(void)
+    {
+        CriticalSectionLock lock;
+        if (_state != State::Echoing) {
+            return;
+        }
+
+        _timeout.detach();
+        _width = _timer->elapsed_time() - _start;
+        _state = State::Done;
+        _done();
+    }
+
+    /**
+     * No edge received in time, called in interrupt context.
+     */
+    void on_timeout(void)
+    {
+        CriticalSectionLock lock;
+        if (_state != State::Triggered && _state != State::Echoing) {
+            return;
+        }
+
+        if (_state == State::Triggered) {
+            _start = _timer->elapsed_time();
+        }
+        _width = _echo_timeout;
+        _state = State::Done;
+        _done();
+    }
+
+    Timer *_timer = nullptr;
+    mbed::Callback<void()> _done;
+    volatile State _state = State::Idle;
+    std::chrono::microseconds _echo_timeout{0};
+    std::chrono::microseconds _start{0};
+    std::chrono::microseconds _width{0};
+    Timeout _timeout;
+};
+
+#endif // ECHO_CHANNEL_H
@@ -0,0 +1,63 @@
+#ifndef ECHO_SCALE_H
+#define ECHO_SCALE_H
+
+#include <cstdint>
+
+/**
+ * Conversion between the round trip time of an echo and the distance of
+ * the reflector, in fixed point.
+ *
+ * The one way distance covered per microsecond of round trip is held in
+ * Q16: a sample costs a multiply and a shift, no floating point and no
+ * division. The factor is derived once from the speed of sound, the
+ * division happens then.
+ */
+struct EchoScale {
+    static constexpr unsigned FRACTION_BITS = 16;
+
+    uint32_t mm_per_us_q16;     /* one way mm per us of round trip */
+
+    /**
+     * Scale of echoes travelling at sound_speed_mm_s.
+     */
+    static constexpr EchoScale from_sound_speed(uint32_t sound_speed_mm_s)
+    {
+        // Round trip, and us: 2 * 1000000
+        return EchoScale{static_cast<uint32_t>(
+            ((static_cast<uint64_t>(sound_speed_mm_s) << FRACTION_BITS) + 1000000) / 2000000
+        )};
+    }
+
+    /**
+     * Distance of the reflector of an echo, rounded to the nearest mm.
+     */
+    constexpr uint16_t distance_mm(uint32_t round_trip_us) const
+    {
+        // Beyond any echo the sensors report, keeps the product in 32 bits at
+        // any speed of sound in air
+        if (round_trip_us > UINT16_MAX) {
+            round_trip_us = UINT16_MAX;
+        }
+        return static_cast<uint16_t>((round_trip_us * mm_per_us_q16 + (1u << (FRACTION_BITS - 1))) >> FRACTION_BITS);
+    }
+
+    /**
+     * Round trip time of an echo off a reflector at distance_mm, rounded down.
+     */
+    constexpr uint32_t round_trip_us(uint16_t distance_mm) const
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(distance_mm) << FRACTION_BITS) / mm_per_us_q16);
+    }
+};
+
+/* Speed of sound in dry air at 20 degrees Celsius, the HC-SR04 datasheet figure */
+static constexpr uint32_t SOUND_SPEED_20C_MM_S = 343000;
+
+/* Scale at boot, until calibrated (see SoundCalibrator) */
+static constexpr EchoScale ECHO_SCALE_20C = EchoScale::from_sound_speed(SOUND_SPEED_20C_MM_S);
+
+static_assert(ECHO_SCALE_20C.distance_mm(1749) == 300, "scale off at the default range");
+static_assert(ECHO_SCALE_20C.distance_mm(ECHO_SCALE_20C.round_trip_us(4000)) == 4000,
+              "scale off at the longest range");
+
+#endif // ECHO_SCALE_H
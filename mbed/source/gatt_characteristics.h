@@ -0,0 +1,195 @@
+#ifndef GATT_CHARACTERISTICS_H
+#define GATT_CHARACTERISTICS_H
+
+#include "ble/BLE.h"
+#include "platform/Span.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+/* Values are sent in the in-memory representation of the MCU */
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "characteristic values are little endian");
+
+/**
+ * Characteristic value made of up to Capacity elements of type T, the length
+ * of the value changes with each update.
+ *
+ * Use as the type parameter of ReadWriteNotifyIndicateCharacteristic.
+ */
+template<typename T, size_t Capacity>
+struct VariableLength {
+};
+
+/**
+ * Read, Write, Notify, Indicate  Characteristic declaration helper.
+ *
+ * The value is stored and exchanged as the little endian representation of
+ * T: integers of any width or fixed size structures declared with
+ * MBED_PACKED.
+ *
+ * @tparam T type of data held by the characteristic.
+ */
+template<typename T>
+class ReadWriteNotifyIndicateCharacteristic : public GattCharacteristic {
+    static_assert(std::is_trivially_copyable<T>::value, "characteristic values are copied byte by byte");
+
+public:
+    static const uint8_t DEFAULT_PROPERTIES =
+        GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_READ |
+        GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_WRITE |
+        GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_NOTIFY |
+        GattCharacteristic::BLE_GATT_CHAR_PROPERTIES_INDICATE;
+
+    /**
+     * Construct a characteristic that can be read or written and emit
+     * notification or indication.
+     *
+     * @param[in] uuid The UUID of the characteristic.
+     * @param[in] initial_value Initial value contained by the characteristic.
+     * @param[in] properties Restrict the operations allowed on the
+     * characteristic.
+     */
+    ReadWriteNotifyIndicateCharacteristic(const UUID & uuid, const T& initial_value, uint8_t properties = DEFAULT_PROPERTIES) :
+        GattCharacteristic(
+            /* UUID */ uuid,
+            /* Initial value */ reinterpret_cast<uint8_t *>(&_value),
+            /* Value size */ sizeof(_value),
+            /* Value capacity */ sizeof(_value),
+            /* Properties */ properties,
+            /* Descriptors */ nullptr,
+            /* Num descriptors */ 0,
+            /* variable len */ false
+        ),
+        _value(initial_value) {
+    }
+
+    /**
+     * Get the value of this characteristic.
+     *
+     * @param[in] server GattServer instance that contain the characteristic
+     * value.
+     * @param[in] dst Variable that will receive the characteristic value.
+     *
+     * @return BLE_ERROR_NONE in case of success or an appropriate error code.
+     */
+    ble_error_t get(GattServer &server, T& dst) const
+    {
+        uint16_t value_length = sizeof(dst);
+        return server.read(getValueHandle(), reinterpret_cast<uint8_t *>(&dst), &value_length);
+    }
+
+    /**
+     * Assign a new value to this characteristic.
+     *
+     * @param[in] server GattServer instance that will receive the new value.
+     * @param[in] value The new value to set.
+     * @param[in] local_only Flag that determine if the change should be kept
+     * locally or forwarded to subscribed clients.
+     */
+    ble_error_t set(GattServer &server, const T &value, bool local_only = false) const
+    {
+        return server.write(getValueHandle(), reinterpret_cast<const uint8_t *>(&value), sizeof(value), local_only);
+    }
+
+    /**
+     * Extract the value written by a client.
+     *
+     * @param[in] params Write event received for this characteristic.
+     * @param[out] dst Variable that will receive the value.
+     *
+     * @return true if the write carried a complete value.
+     */
+    bool decode(const GattWriteCallbackParams &params, T &dst) const
+    {
+        if (params.handle != getValueHandle() || params.offset != 0 || params.len != sizeof(dst)) {
+            return false;
+        }
+        memcpy(&dst, params.data, sizeof(dst));
+        return true;
+    }
+
+private:
+    T _value;
+};
+
+/**
+ * Read, Write, Notify, Indicate  Characteristic holding a variable length
+ * array of T.
+ *
+ * @tparam T type of the elements.
+ * @tparam Capacity maximum number of elements.
+ */
+template<typename T, size_t Capacity>
+class ReadWriteNotifyIndicateCharacteristic<VariableLength<T, Capacity>> : public GattCharacteristic {
+    static_assert(std::is_trivially_copyable<T>::value, "characteristic values are copied byte by byte");
+    static_assert(Capacity * sizeof(T) <= UINT16_MAX, "characteristic value too large");
+
+public:
+    static const uint8_t DEFAULT_PROPERTIES =
+        ReadWriteNotifyIndicateCharacteristic<uint8_t>::DEFAULT_PROPERTIES;
+
+    /**
+     * Construct an empty characteristic.
+     *
+     * @param[in] uuid The UUID of the characteristic.
+     * @param[in] properties Restrict the operations allowed on the
+     * characteristic.
+     */
+    ReadWriteNotifyIndicateCharacteristic(const UUID & uuid, uint8_t properties = DEFAULT_PROPERTIES) :
+        GattCharacteristic(
+            /* UUID */ uuid,
+            /* Initial value */ reinterpret_cast<uint8_t *>(_value),
+            /* Value size */ 0,
+            /* Value capacity */ sizeof(_value),
+            /* Properties */ properties,
+            /* Descriptors */ nullptr,
+            /* Num descriptors */ 0,
+            /* variable len */ true
+        ) {
+    }
+
+    /**
+     * Get the elements held by this characteristic.
+     *
+     * @param[in] server GattServer instance that contain the characteristic
+     * value.
+     * @param[in] dst Buffer that will receive the elements.
+     * @param[out] count Number of elements copied in dst.
+     *
+     * @return BLE_ERROR_NONE in case of success or an appropriate error code.
+     */
+    ble_error_t get(GattServer &server, mbed::Span<T> dst, size_t &count) const
+    {
+        uint16_t value_length = dst.size() * sizeof(T);
+        ble_error_t err = server.read(getValueHandle(), reinterpret_cast<uint8_t *>(dst.data()), &value_length);
+        count = err ? 0 : value_length / sizeof(T);
+        return err;
+    }
+
+    /**
+     * Assign new elements to this characteristic.
+     *
+     * @param[in] server GattServer instance that will receive the new value.
+     * @param[in] values The new elements, at most Capacity.
+     * @param[in] local_only Flag that determine if the change should be kept
+     * locally or forwarded to subscribed clients.
+     */
+    ble_error_t set(GattServer &server, mbed::Span<const T> values, bool local_only = false) const
+    {
+        if (values.size() > static_cast<ptrdiff_t>(Capacity)) {
+            return BLE_ERROR_INVALID_PARAM;
+        }
+        return server.write(
+            getValueHandle(),
+            reinterpret_cast<const uint8_t *>(values.data()),
+            values.size() * sizeof(T),
+            local_only
+        );
+    }
+
+private:
+    T _value[Capacity] = {};
+};
+
+#endif // GATT_CHARACTERISTICS_H
@@ -0,0 +1,222 @@
+#ifndef LINK_MANAGER_H
+#define LINK_MANAGER_H
+
+#include "mbed.h"
+#include "platform/Callback.h"
+#include "ble/BLE.h"
+#include "ble/gap/ChainableGapEventHandler.h"
+#include "radar_protocol.h"
+#include <cstdint>
+#include <cstdio>
+
+using radar::protocol::LinkStatus;
+
+/**
+ * Connection parameters requested from the central.
+ */
+struct ConnectionParameters {
+    uint16_t min_interval;  /* 1.25 ms units */
+    uint16_t max_interval;  /* 1.25 ms units */
+    uint16_t latency;       /* connection events */
+    uint16_t timeout;       /* supervision timeout, 10 ms units */
+};
+
+/* notifications leave within 15 ms while the radar streams */
+static constexpr ConnectionParameters ACTIVE_CONNECTION = {6, 12, 0, 400};
+/* the radio wakes every 2.5 s at most while nothing is notified */
+static constexpr ConnectionParameters IDLE_CONNECTION = {400, 500, 3, 600};
+
+/**
+ * Negotiates the fastest link the controller and the peer support.
+ *
+ * Once connected the ATT MTU exchange is started, up to the
+ * cordio.desired-att-mtu of mbed_app.json, and the 2M PHY is requested when
+ * the controller supports it. The host asks for longer link layer packets on
+ * its own when the controller supports the data length extension. Each
+ * negotiated value is reported through the change callback.
+ *
+ * The connection parameters follow the activity set by the service: a short
+ * interval while notifications stream, a long one with slave latency
+ * otherwise. A new connection keeps the parameters of the central until the
+ * activity changes. The central may refuse them, the values in use are
+ * reported.
+ *
+ * The manager is chained after the Gap event handler already registered,
+ * typically the one advertising and accepting connections.
+ */
+class LinkManager : public ble::Gap::EventHandler {
+public:
+    /* data length of a new connection until negotiated */
+    static constexpr uint16_t DEFAULT_OCTETS = 27;
+
+    void start(BLE &ble, mbed::Callback<void(const LinkStatus &)> changed)
+    {
+        _ble = &ble;
+        _changed = changed;
+
+        ble::Gap &gap = ble.gap();
+        if (gap.getEventHandler()) {
+            _gap_handlers.addEventHandler(gap.getEventHandler());
+        }
+        _gap_handlers.addEventHandler(this);
+        gap.setEventHandler(&_gap_handlers);
+
+        printf("controller: 2M PHY %s, data length extension %s\r\n",
+               gap.isFeatureSupported(ble::controller_supported_features_t::LE_2M_PHY) ? "yes" : "no",
+               gap.isFeatureSupported(ble::controller_supported_features_t::LE_DATA_PACKET_LENGTH_EXTENSION) ? "yes" : "no");
+    }
+
+    const LinkStatus &status() const
+    {
+        return _status;
+    }
+
+    /**
+     * Select the connection parameters, requested at once when connected.
+     */
+    void set_active(bool active)
+    {
+        if (active == _active) {
+            return;
+        }
+        _active = active;
+        if (_connected) {
+            request_parameters();
+        }
+    }
+
+    bool connected() const
+    {
+        return _connected;
+    }
+
+    /**
+     * The ATT MTU changed, reported by the GattServer.
+     */
+    void on_att_mtu(uint16_t att_mtu)
+    {
+        _status.att_mtu = att_mtu;
+        report();
+    }
+
+private:
+    void onConnectionComplete(const ble::ConnectionCompleteEvent &event) override
+    {
+        if (event.getStatus() != BLE_ERROR_NONE) {
+            return;
+        }
+
+        _connection = event.getConnectionHandle();
+        _connected = true;
+        _status = LinkStatus{radar::protocol::DEFAULT_ATT_MTU, DEFAULT_OCTETS, DEFAULT_OCTETS, 1, 1,
+                             event.getConnectionInterval().value(), event.getConnectionLatency().value()};
+        report();
+
+        _ble->gattClient().negotiateAttMtu(_connection);
+
+        ble::Gap &gap = _ble->gap();
+        if (gap.isFeatureSupported(ble::controller_supported_features_t::LE_2M_PHY)) {
+            ble::phy_set_t phy_2m(/* 1M */ false, /* 2M */ true, /* coded */ false);
+            gap.setPhy(_connection, &phy_2m, &phy_2m, ble::coded_symbol_per_bit_t::UNDEFINED);
+        }
+
+        // Clients subscribe right after connecting, going idle first would
+        // delay the switch to the short interval by several long ones
+        if (_active) {
+            request_parameters();
+        }
+    }
+
+    void onDisconnectionComplete(const ble::DisconnectionCompleteEvent &event) override
+    {
+        _connected = false;
+        _updating = false;
+        _status = LinkStatus{radar::protocol::DEFAULT_ATT_MTU, DEFAULT_OCTETS, DEFAULT_OCTETS, 1, 1, 0, 0};
+        report();
+    }
+
+    void onConnectionParametersUpdateComplete(const ble::ConnectionParametersUpdateCompleteEvent &event) override
+    {
+        _updating = false;
+        if (event.getStatus() != BLE_ERROR_NONE) {
+            printf("connection parameters rejected: %u\r\n", event.getStatus());
+        } else {
+            _status.interval = event.getConnectionInterval().value();
+            _status.latency = event.getSlaveLatency().value();
+            report();
+        }
+
+        // The activity changed during the procedure
+        if (_connected && _requested_active != _active) {
+            request_parameters();
+        }
+    }
+
+    /**
+     * Only one update procedure runs at a time, a change of activity in the
+     * meantime is requested once it completes.
+     */
+    void request_parameters()
+    {
+        if (_updating) {
+            return;
+        }
+        _updating = true;
+        _requested_active = _active;
+
+        const ConnectionParameters &parameters = _active ? ACTIVE_CONNECTION : IDLE_CONNECTION;
+        ble_error_t err = _ble->gap().updateConnectionParameters(
+            _connection,
+            ble::conn_interval_t(parameters.min_interval),
+            ble::conn_interval_t(parameters.max_interval),
+            ble::slave_latency_t(parameters.latency),
+            ble::supervision_timeout_t(parameters.timeout)
+        );
+        if (err) {
+            printf("connection parameters request failed: %u\r\n", err);
+            _updating = false;
+        }
+    }
+
+    void onPhyUpdateComplete(ble_error_t status, ble::connection_handle_t connectionHandle,
+                             ble::phy_t txPhy, ble::phy_t rxPhy) override
+    {
+        if (status != BLE_ERROR_NONE) {
+            printf("PHY update failed: %u\r\n", status);
+            return;
+        }
+
+        _status.tx_phy = txPhy.value();
+        _status.rx_phy = rxPhy.value();
+        report();
+    }
+
+    void onDataLengthChange(ble::connection_handle_t connectionHandle, uint16_t txSize, uint16_t rxSize) override
+    {
+        _status.tx_octets = txSize;
+        _status.rx_octets = rxSize;
+        report();
+    }
+
+    void report()
+    {
+        printf("link: ATT MTU %u, data length %u/%u, PHY %u/%u, interval %u.%02u ms, latency %u\r\n",
+               _status.att_mtu, _status.tx_octets, _status.rx_octets, _status.tx_phy, _status.rx_phy,
+               _status.interval * 5 / 4, _status.interval * 125 % 100, _status.latency);
+        if (_changed) {
+            _changed(_status);
+        }
+    }
+
+    BLE *_ble = nullptr;
+    ChainableGapEventHandler _gap_handlers;
+    mbed::Callback<void(const LinkStatus &)> _changed;
+    ble::connection_handle_t _connection = 0;
+    bool _connected = false;
+    bool _active = false;
+    bool _requested_active = false;
+    bool _updating = false;
+    LinkStatus _status = {radar::protocol::DEFAULT_ATT_MTU, DEFAULT_OCTETS, DEFAULT_OCTETS, 1, 1, 0, 0};
+};
+
+#endif // LINK_MANAGER_H
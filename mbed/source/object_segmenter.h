@@ -0,0 +1,243 @@
+#ifndef OBJECT_SEGMENTER_H
+#define OBJECT_SEGMENTER_H
+
+#include "mbed.h"
+#include "radar_protocol.h"
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+using radar::protocol::SweepObject;
+using radar::protocol::ObjectListHeader;
+
+
+/**
+ * Groups the echoes of a sweep into objects.
+ *
+ * Echoes of neighbouring bins join the same object when their distances
+ * differ by at most join_mm. Bins skipped by the adaptive sweep do not split
+ * an object as long as the gap stays within max_gap degrees, a bin without
+ * echo always does. Bins measured by the previous sweep and skipped by the
+ * current one, such as the turnaround angle, keep their reading.
+ *
+ * The list of a sweep is a ObjectListHeader followed by the objects, nearest
+ * first, little endian. It is cut to fit a notification at the current ATT
+ * MTU, or to the capacity of a link without MTU, the objects kept stay
+ * available in full to the other stages.
+ *
+ * @tparam Bins number of angle bins, one per degree.
+ * @tparam MaxObjects most objects in a list.
+ */
+template<size_t Bins, size_t MaxObjects>
+class ObjectSegmenter {
+    static_assert(Bins <= 256, "angles are stored on 8 bits");
+    static_assert(MaxObjects <= 255, "counts are stored on 8 bits");
+
+public:
+    static constexpr size_t HEADER_SIZE = sizeof(ObjectListHeader);
+    static constexpr size_t OBJECT_SIZE = sizeof(SweepObject);
+    static constexpr size_t MAX_SIZE = HEADER_SIZE + MaxObjects * OBJECT_SIZE;
+
+    /**
+     * @param[in] join_mm Largest distance step within an object.
+     * @param[in] max_gap Largest run of unvisited bins within an object.
+     */
+    ObjectSegmenter(uint16_t join_mm, uint8_t max_gap) :
+        _join_mm(join_mm),
+        _max_gap(max_gap)
+    {
+        set_att_mtu(radar::protocol::DEFAULT_ATT_MTU);
+    }
+
+    /**
+     * Resize the lists to the MTU negotiated with the client.
+     */
+    void set_att_mtu(uint16_t att_mtu)
+    {
+        size_t capacity = radar::protocol::notification_payload(att_mtu, HEADER_SIZE) / OBJECT_SIZE;
+        _capacity = capacity < MaxObjects ? capacity : MaxObjects;
+    }
+
+    /**
+     * Record a sample of the given sweep.
+     *
+     * @param[in] echo true if something reflected within range.
+     * @param[in] timestamp_us Time of the measurement.
+     */
+    void add(uint8_t angle, uint16_t distance_mm, bool echo, uint16_t sweep, uint32_t timestamp_us)
+    {
+        if (angle >= Bins) {
+            return;
+        }
+
+        _visited.set(angle);
+        _echo.set(angle, echo);
+        _distance[angle] = distance_mm;
+        _sweep[angle] = sweep;
+        _time[angle] = timestamp_us;
+    }
+
+    /**
+     * Segment the bins measured by the given sweep or the previous one into
+     * the object list.
+     *
+     * @return The number of objects kept, the list sent may hold less.
+     */
+    size_t finish(uint16_t sweep)
+    {
+        _list.header.sweep = sweep;
+        _list.header.total = 0;
+        _found = 0;
+
+        Segment segment = {};
+        bool open = false;
+        size_t gap = 0;
+        uint16_t last_distance = 0;
+
+        for (size_t bin = 0; bin < Bins; ++bin) {
+            if (!_visited.test(bin) || static_cast<uint16_t>(sweep - _sweep[bin]) > 1) {
+                if (open && ++gap > _max_gap) {
+                    close(segment);
+                    open = false;
+                }
+                continue;
+            }
+            gap = 0;
+
+            if (!_echo.test(bin)) {
+                if (open) {
+                    close(segment);
+                    open = false;
+                }
+                continue;
+            }
+
+            uint16_t distance = _distance[bin];
+            uint16_t step = distance > last_distance ? distance - last_distance : last_distance - distance;
+            if (open && step > _join_mm) {
+                close(segment);
+                open = false;
+            }
+
+            if (!open) {
+                segment = Segment{static_cast<uint8_t>(bin), static_cast<uint8_t>(bin), distance, 0, 0, _time[bin]};
+                open = true;
+            }
+            segment.end = static_cast<uint8_t>(bin);
+            if (distance < segment.min) {
+                segment.min = distance;
+                segment.time = _time[bin];
+            }
+            segment.sum += distance;
+            ++segment.count;
+            last_distance = distance;
+        }
+
+        if (open) {
+            close(segment);
+        }
+
+        return _found;
+    }
+
+    /**
+     * Objects kept from the last sweep, at most MaxObjects, nearest first.
+     */
+    mbed::Span<const SweepObject> objects() const
+    {
+        return mbed::Span<const SweepObject>(_list.objects, _found);
+    }
+
+    /**
+     * Time the nearest point of each object kept was measured.
+     */
+    mbed::Span<const uint32_t> times_us() const
+    {
+        return mbed::Span<const uint32_t>(_times, _found);
+    }
+
+    /**
+     * Encoded list of the last sweep, cut to a notification at the ATT MTU.
+     */
+    mbed::Span<const uint8_t> bytes()
+    {
+        return bytes(_capacity);
+    }
+
+    /**
+     * Encoded list of the last sweep, cut to capacity objects.
+     */
+    mbed::Span<const uint8_t> bytes(size_t capacity)
+    {
+        _list.header.count = static_cast<uint8_t>(_found < capacity ? _found : capacity);
+        return mbed::Span<const uint8_t>(
+            reinterpret_cast<const uint8_t *>(&_list),
+            HEADER_SIZE + _list.header.count * OBJECT_SIZE
+        );
+    }
+
+private:
+    struct Segment {
+        uint8_t start;
+        uint8_t end;
+        uint16_t min;
+        uint32_t sum;
+        uint16_t count;
+        uint32_t time;      /* measurement of the nearest point */
+    };
+
+    /**
+     * Insert the segment in the list, nearest first, the farthest object is
+     * dropped when the list is full.
+     */
+    void close(const Segment &segment)
+    {
+        if (_list.header.total < 255) {
+            ++_list.header.total;
+        }
+
+        size_t count = _found;
+        size_t position = count;
+        while (position > 0 && _list.objects[position - 1].min_distance > segment.min) {
+            --position;
+        }
+        if (position >= MaxObjects) {
+            return;
+        }
+
+        size_t last = count < MaxObjects ? count : MaxObjects - 1;
+        for (size_t i = last; i > position; --i) {
+            _list.objects[i] = _list.objects[i - 1];
+            _times[i] = _times[i - 1];
+        }
+        _times[position] = segment.time;
+        _list.objects[position] = SweepObject{
+            segment.start,
+            segment.end,
+            segment.min,
+            static_cast<uint16_t>((segment.sum + segment.count / 2) / segment.count)
+        };
+        if (count < MaxObjects) {
+            ++_found;
+        }
+    }
+
+    MBED_PACKED(struct) List {
+        ObjectListHeader header;
+        SweepObject objects[MaxObjects];
+    };
+
+    uint16_t _join_mm;
+    uint8_t _max_gap;
+    size_t _capacity = 0;
+    size_t _found = 0;
+    std::bitset<Bins> _visited;
+    std::bitset<Bins> _echo;
+    uint16_t _distance[Bins] = {};
+    uint16_t _sweep[Bins] = {};
+    uint32_t _time[Bins] = {};
+    uint32_t _times[MaxObjects] = {};
+    List _list = {};
+};
+
+#endif // OBJECT_SEGMENTER_H
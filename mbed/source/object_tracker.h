@@ -0,0 +1,295 @@
+#ifndef OBJECT_TRACKER_H
+#define OBJECT_TRACKER_H
+
+#include "mbed.h"
+#include "object_segmenter.h"
+#include "radar_protocol.h"
+#include <cstddef>
+#include <cstdint>
+
+using radar::protocol::ObjectTrack;
+using radar::protocol::TrackListHeader;
+
+
+/**
+ * Follows the objects found by successive sweeps and estimates their radial
+ * velocity.
+ *
+ * Each object is associated with the closest predicted track within the
+ * gates, the range and velocity of the track are then corrected by an
+ * alpha-beta filter. Ranges and velocities are fixed-point Q4 (mm, mm/s).
+ * Objects without track start a new one, tracks missing for more than
+ * MAX_MISSES sweeps are dropped.
+ *
+ * The list sent holds the confirmed tracks seen by the last sweep, nearest
+ * first, cut to fit a notification at the current ATT MTU or to the
+ * capacity of a link without MTU.
+ *
+ * @tparam MaxTracks most tracks followed at once.
+ */
+template<size_t MaxTracks>
+class ObjectTracker {
+    static_assert(MaxTracks <= 255, "counts are stored on 8 bits");
+
+public:
+    /* weight of the range residual in the range, Q8 */
+    static constexpr int32_t ALPHA_Q8 = 128;
+    /* weight of the range residual in the velocity, Q8 */
+    static constexpr int32_t BETA_Q8 = 32;
+    /* largest range residual of an object joining a track, mm */
+    static constexpr int32_t RANGE_GATE_MM = 200;
+    /* largest bearing of a track outside an object joining it, degrees */
+    static constexpr int32_t BEARING_GATE_DEG = 10;
+    /* association cost of a degree of bearing, in mm of range */
+    static constexpr int32_t BEARING_COST_MM = 10;
+    /* sweeps a track survives without object */
+    static constexpr uint8_t MAX_MISSES = 2;
+    /* sweeps before a track is reported */
+    static constexpr uint8_t MIN_HITS = 2;
+
+    /* most objects associated per sweep */
+    static constexpr size_t MAX_ASSOCIATED = 32;
+
+    static constexpr size_t HEADER_SIZE = sizeof(TrackListHeader);
+    static constexpr size_t TRACK_SIZE = sizeof(ObjectTrack);
+    static constexpr size_t MAX_SIZE = HEADER_SIZE + MaxTracks * TRACK_SIZE;
+
+    ObjectTracker()
+    {
+        set_att_mtu(radar::protocol::DEFAULT_ATT_MTU);
+    }
+
+    /**
+     * Resize the lists to the MTU negotiated with the client.
+     */
+    void set_att_mtu(uint16_t att_mtu)
+    {
+        size_t capacity = radar::protocol::notification_payload(att_mtu, HEADER_SIZE) / TRACK_SIZE;
+        _capacity = capacity < MaxTracks ? capacity : MaxTracks;
+    }
+
+    /**
+     * Update the tracks with the objects of a sweep.
+     *
+     * @param[in] objects Objects of the sweep.
+     * @param[in] times_us Time each object was measured.
+     * @param[in] sweep Sweep the objects were found by.
+     */
+    void update(mbed::Span<const SweepObject> objects, mbed::Span<const uint32_t> times_us, uint16_t sweep)
+    {
+        bool assigned[MAX_ASSOCIATED] = {};
+        size_t count = static_cast<size_t>(objects.size());
+        if (count > MAX_ASSOCIATED) {
+            count = MAX_ASSOCIATED;
+        }
+
+        for (Track &track : _tracks) {
+            track.matched = false;
+        }
+
+        // Greedy association, cheapest pair first
+        for (;;) {
+            Track *best_track = nullptr;
+            size_t best_object = 0;
+            int32_t best_cost = INT32_MAX;
+
+            for (Track &track : _tracks) {
+                if (!track.id || track.matched) {
+                    continue;
+                }
+                for (size_t i = 0; i < count; ++i) {
+                    int32_t cost;
+                    if (!assigned[i] && gate(track, objects[i], times_us[i], cost) && cost < best_cost) {
+                        best_track = &track;
+                        best_object = i;
+                        best_cost = cost;
+                    }
+                }
+            }
+
+            if (!best_track) {
+                break;
+            }
+            correct(*best_track, objects[best_object], times_us[best_object]);
+            assigned[best_object] = true;
+        }
+
+        for (Track &track : _tracks) {
+            if (track.id && !track.matched && ++track.misses > MAX_MISSES) {
+                track.id = 0;
+            }
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            if (!assigned[i]) {
+                open(objects[i], times_us[i]);
+            }
+        }
+
+        encode(sweep);
+    }
+
+    /**
+     * Encoded list of the last update, cut to a notification at the ATT MTU.
+     */
+    mbed::Span<const uint8_t> bytes()
+    {
+        return bytes(_capacity);
+    }
+
+    /**
+     * Encoded list of the last update, cut to capacity tracks.
+     */
+    mbed::Span<const uint8_t> bytes(size_t capacity)
+    {
+        _list.header.count = static_cast<uint8_t>(_reported < capacity ? _reported : capacity);
+        return mbed::Span<const uint8_t>(
+            reinterpret_cast<const uint8_t *>(&_list),
+            HEADER_SIZE + _list.header.count * TRACK_SIZE
+        );
+    }
+
+private:
+    struct Track {
+        uint8_t id;             /* 0 when free */
+        uint8_t hits;
+        uint8_t misses;
+        bool matched;
+        int32_t bearing_q4;     /* degrees */
+        int32_t range_q4;       /* mm */
+        int32_t velocity_q4;    /* mm/s */
+        uint32_t time_us;       /* last correction */
+    };
+
+    static int32_t centre_q4(const SweepObject &object)
+    {
+        return (static_cast<int32_t>(object.start_angle) + object.end_angle) * 8;
+    }
+
+    static int32_t predict_q4(const Track &track, uint32_t time_us)
+    {
+        int64_t dt_us = static_cast<uint32_t>(time_us - track.time_us);
+        return track.range_q4 + static_cast<int32_t>(track.velocity_q4 * dt_us / 1000000);
+    }
+
+    static int32_t distance(int32_t a, int32_t b)
+    {
+        return a > b ? a - b : b - a;
+    }
+
+    /**
+     * true if the object may join the track, with the cost of the pair.
+     */
+    static bool gate(const Track &track, const SweepObject &object, uint32_t time_us, int32_t &cost)
+    {
+        int32_t bearing = (track.bearing_q4 + 8) >> 4;
+        if (bearing < object.start_angle - BEARING_GATE_DEG || bearing > object.end_angle + BEARING_GATE_DEG) {
+            return false;
+        }
+
+        int32_t residual = distance(static_cast<int32_t>(object.min_distance) << 4, predict_q4(track, time_us)) >> 4;
+        if (residual > RANGE_GATE_MM) {
+            return false;
+        }
+
+        cost = residual + BEARING_COST_MM * (distance(centre_q4(object), track.bearing_q4) >> 4);
+        return true;
+    }
+
+    void correct(Track &track, const SweepObject &object, uint32_t time_us)
+    {
+        int64_t dt_us = static_cast<uint32_t>(time_us - track.time_us);
+        int32_t predicted = predict_q4(track, time_us);
+        int32_t residual = (static_cast<int32_t>(object.min_distance) << 4) - predicted;
+
+        track.range_q4 = predicted + residual * ALPHA_Q8 / 256;
+        if (dt_us > 0) {
+            track.velocity_q4 += static_cast<int32_t>(static_cast<int64_t>(residual) * BETA_Q8 * 1000000 / 256 / dt_us);
+        }
+        track.bearing_q4 += (centre_q4(object) - track.bearing_q4) * ALPHA_Q8 / 256;
+        track.time_us = time_us;
+        track.misses = 0;
+        track.matched = true;
+        if (track.hits < 255) {
+            ++track.hits;
+        }
+    }
+
+    void open(const SweepObject &object, uint32_t time_us)
+    {
+        for (Track &track : _tracks) {
+            if (!track.id) {
+                track = Track{next_id(), 1, 0, true, centre_q4(object),
+                              static_cast<int32_t>(object.min_distance) << 4, 0, time_us};
+                return;
+            }
+        }
+    }
+
+    uint8_t next_id()
+    {
+        for (;;) {
+            uint8_t id = _next_id++;
+            if (!id) {
+                continue;
+            }
+
+            bool used = false;
+            for (const Track &track : _tracks) {
+                used = used || track.id == id;
+            }
+            if (!used) {
+                return id;
+            }
+        }
+    }
+
+    /**
+     * Report the confirmed tracks seen by the sweep, nearest first.
+     */
+    void encode(uint16_t sweep)
+    {
+        _list.header.sweep = sweep;
+        size_t count = 0;
+
+        for (const Track &track : _tracks) {
+            if (!track.id || !track.matched || track.hits < MIN_HITS) {
+                continue;
+            }
+
+            int32_t velocity = track.velocity_q4 / 16;
+            ObjectTrack report = {
+                track.id,
+                static_cast<uint8_t>((track.bearing_q4 + 8) >> 4),
+                static_cast<uint16_t>((track.range_q4 + 8) >> 4),
+                static_cast<int16_t>(velocity > INT16_MAX ? INT16_MAX : velocity < INT16_MIN ? INT16_MIN : velocity),
+                track.hits
+            };
+
+            size_t position = count;
+            while (position > 0 && _list.tracks[position - 1].range > report.range) {
+                --position;
+            }
+            for (size_t i = count; i > position; --i) {
+                _list.tracks[i] = _list.tracks[i - 1];
+            }
+            _list.tracks[position] = report;
+            ++count;
+        }
+
+        _reported = count;
+    }
+
+    MBED_PACKED(struct) List {
+        TrackListHeader header;
+        ObjectTrack tracks[MaxTracks];
+    };
+
+    Track _tracks[MaxTracks] = {};
+    uint8_t _next_id = 1;
+    size_t _capacity = 0;
+    size_t _reported = 0;       /* tracks in _list, the ones sent depend on the link */
+    List _list = {};
+};
+
+#endif // OBJECT_TRACKER_H
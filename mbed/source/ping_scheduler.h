@@ -0,0 +1,90 @@
+#ifndef PING_SCHEDULER_H
+#define PING_SCHEDULER_H
+
+#include "radar_hal.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Interleaves the triggers of several sensors so that no sensor can hear the
+ * burst of another one.
+ *
+ * Sensors are grouped into slots. Within a slot every pair of sensors faces
+ * directions at least a beam width apart, they are triggered together and
+ * measure concurrently. Slots are triggered one after the other, each one
+ * after the echoes of the previous one have died out.
+ *
+ * @tparam MaxSensors most sensors handled, one bit each in a slot.
+ */
+template<size_t MaxSensors>
+class PingScheduler {
+    static_assert(MaxSensors >= 1 && MaxSensors <= 8, "slots are stored on 8 bits");
+
+public:
+    /**
+     * Assign the sensors to as few slots as possible.
+     *
+     * @param[in] sensors Sensors of the board, only the first MaxSensors are
+     * used.
+     * @param[in] beam_width Smallest angle between two sensors pinged
+     * together, degrees.
+     */
+    void configure(mbed::Span<const RangingSensor> sensors, int beam_width)
+    {
+        _count = static_cast<size_t>(sensors.size()) < MaxSensors ? static_cast<size_t>(sensors.size()) : MaxSensors;
+        _slot_count = 0;
+
+        for (size_t i = 0; i < _count; ++i) {
+            size_t slot = 0;
+            while (slot < _slot_count && !fits(sensors, i, _slots[slot], beam_width)) {
+                ++slot;
+            }
+            if (slot == _slot_count) {
+                _slots[_slot_count++] = 0;
+            }
+            _slots[slot] |= 1u << i;
+        }
+    }
+
+    /**
+     * Sensors handled.
+     */
+    size_t sensors() const
+    {
+        return _count;
+    }
+
+    size_t slots() const
+    {
+        return _slot_count;
+    }
+
+    /**
+     * Sensors triggered together in the slot, one bit per sensor index.
+     */
+    uint8_t slot(size_t index) const
+    {
+        return _slots[index];
+    }
+
+private:
+    static bool fits(mbed::Span<const RangingSensor> sensors, size_t sensor, uint8_t slot, int beam_width)
+    {
+        for (size_t i = 0; i < sensor; ++i) {
+            if (!(slot & (1u << i))) {
+                continue;
+            }
+            int separation = sensors[sensor].bearing - sensors[i].bearing;
+            if (separation < beam_width && -separation < beam_width) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t _count = 0;
+    size_t _slot_count = 0;
+    uint8_t _slots[MaxSensors] = {};
+};
+
+#endif // PING_SCHEDULER_H
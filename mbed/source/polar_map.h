@@ -0,0 +1,96 @@
+#ifndef POLAR_MAP_H
+#define POLAR_MAP_H
+
+#include "mbed.h"
+#include "radar_protocol.h"
+#include <cstddef>
+#include <cstdint>
+
+using radar::protocol::PolarMapHeader;
+
+/**
+ * Last distance seen in every direction, kept so that a client connecting
+ * or resubscribing gets the whole scene with one read.
+ *
+ * A cell is little endian: the low 12 bits hold the distance in mm
+ * (UNKNOWN when the bin was never measured), the high 4 bits the number of
+ * sweeps since the bin was updated, saturated at MAX_AGE. The encoded map
+ * always fits in one long read.
+ *
+ * @tparam Bins number of angle bins, one per degree.
+ */
+template<size_t Bins>
+class PolarMap {
+public:
+    static constexpr uint16_t UNKNOWN = radar::protocol::POLAR_CELL_UNKNOWN;
+    static constexpr uint16_t MAX_DISTANCE = UNKNOWN - 1;
+    static constexpr uint16_t MAX_AGE = radar::protocol::POLAR_CELL_MAX_AGE;
+    static constexpr unsigned AGE_SHIFT = radar::protocol::POLAR_CELL_AGE_SHIFT;
+    static constexpr size_t MAX_SIZE = sizeof(PolarMapHeader) + Bins * sizeof(uint16_t);
+
+    static_assert(MAX_SIZE <= 512, "an attribute value is at most 512 bytes");
+
+    PolarMap()
+    {
+        _map.header.bins = Bins;
+        for (size_t i = 0; i < Bins; ++i) {
+            _updated[i] = 0;
+            _distance[i] = UNKNOWN;
+            _map.cells[i] = UNKNOWN | (MAX_AGE << AGE_SHIFT);
+        }
+    }
+
+    /**
+     * Record the distance measured at angle during the given sweep.
+     */
+    void update(uint8_t angle, uint16_t distance_mm, uint16_t sweep)
+    {
+        if (angle >= Bins) {
+            return;
+        }
+
+        if (sweep != _map.header.sweep) {
+            // Every cell got older
+            _map.header.sweep = sweep;
+            for (size_t i = 0; i < Bins; ++i) {
+                encode(i);
+            }
+        }
+
+        if (distance_mm > MAX_DISTANCE) {
+            distance_mm = MAX_DISTANCE;
+        }
+        _distance[angle] = distance_mm;
+        _updated[angle] = sweep;
+        encode(angle);
+    }
+
+    /**
+     * Encoded map.
+     */
+    mbed::Span<const uint8_t> bytes() const
+    {
+        return mbed::Span<const uint8_t>(reinterpret_cast<const uint8_t *>(&_map), MAX_SIZE);
+    }
+
+private:
+    void encode(size_t bin)
+    {
+        uint16_t age = static_cast<uint16_t>(_map.header.sweep - _updated[bin]);
+        if (_distance[bin] == UNKNOWN || age > MAX_AGE) {
+            age = MAX_AGE;
+        }
+        _map.cells[bin] = static_cast<uint16_t>(_distance[bin] | (age << AGE_SHIFT));
+    }
+
+    MBED_PACKED(struct) Map {
+        PolarMapHeader header;
+        uint16_t cells[Bins];
+    };
+
+    Map _map = {};
+    uint16_t _distance[Bins];
+    uint16_t _updated[Bins];
+};
+
+#endif // POLAR_MAP_H
@@ -0,0 +1,41 @@
+#ifndef RADAR_HAL_H
+#define RADAR_HAL_H
+
+#include "mbed.h"
+#include "platform/Span.h"
+#include <cstddef>
+#include <cstdint>
+
+/* Most HC-SR04 driven by one board */
+static constexpr size_t MAX_SENSORS = 4;
+
+/**
+ * One HC-SR04 and the direction it faces.
+ */
+struct RangingSensor {
+    DigitalOut &trig;       /* HC-SR04 trigger */
+    InterruptIn &echo;      /* HC-SR04 echo */
+    uint8_t bearing;        /* degrees, direction faced with the head at 0 */
+};
+
+/**
+ * Peripherals driven by the radar.
+ *
+ * The firmware binds them to the board pins in main.cpp. The host simulator
+ * (see mbed/sim) builds the same service against simulated drivers with the
+ * same interface, running on a virtual clock.
+ *
+ * Sensors either share the servo head, each covering the sector that
+ * starts at its bearing, or form a fixed array without servo.
+ *
+ * A thermometer lets the speed of sound follow the air temperature (see
+ * SoundCalibrator).
+ */
+struct RadarHardware {
+    PwmOut *servo;                              /* servo control, nullptr for a fixed array */
+    mbed::Span<const RangingSensor> sensors;    /* up to MAX_SENSORS, bearings in [0, 180] */
+    DigitalOut &led;                            /* proximity indicator */
+    AnalogIn *thermometer;                      /* TMP36 in the air the sensors range through, nullptr if none */
+};
+
+#endif // RADAR_HAL_H
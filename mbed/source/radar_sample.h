@@ -0,0 +1,17 @@
+#ifndef RADAR_SAMPLE_H
+#define RADAR_SAMPLE_H
+
+#include <cstdint>
+
+/**
+ * Measurement handed from the sensor thread to the BLE thread.
+ */
+struct RadarSample {
+    uint32_t timestamp_us;  /* echo rising edge, sensor timer */
+    uint8_t angle;          /* degrees */
+    uint16_t distance_mm;
+    uint16_t sweep;         /* sweeps completed before the sample */
+    bool echo;              /* something reflected within range */
+};
+
+#endif // RADAR_SAMPLE_H
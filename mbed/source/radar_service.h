@@ -0,0 +1,1234 @@
+/* mbed Microcontroller Library
+ * Copyright (c) 2017-2019 ARM Limited
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RADAR_SERVICE_H
+#define RADAR_SERVICE_H
+
+#include "mbed.h"
+#include "platform/Callback.h"
+#include "events/EventQueue.h"
+#include "ble/BLE.h"
+#include "background_model.h"
+#include "cycle_profiler.h"
+#include "distance_filter.h"
+#include "echo_channel.h"
+#include "gatt_characteristics.h"
+#include "link_manager.h"
+#include "object_segmenter.h"
+#include "object_tracker.h"
+#include "radar_hal.h"
+#include "radar_protocol.h"
+#include "ping_scheduler.h"
+#include "polar_map.h"
+#include "range_gate.h"
+#include "radar_sample.h"
+#include "radar_trace.h"
+#if MBED_CONF_APP_SERIAL_TRANSPORT
+#include "serial_link.h"
+#endif
+#include "sound_calibrator.h"
+#include "servo_motion.h"
+#include "spsc_ring_buffer.h"
+#include "sweep_scheduler.h"
+#include "sweep_frame.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+using mbed::callback;
+using namespace std::literals::chrono_literals;
+
+/* Farthest distance of interest at boot, sets the measurement cycle */
+static constexpr uint16_t DEFAULT_MAX_RANGE_MM = 300;
+/* Time allowed between the end of the trigger and the echo rising edge */
+static constexpr std::chrono::microseconds ECHO_RISE_TIMEOUT = 10ms;
+/* Longest time a sample waits in a partial sweep frame */
+static constexpr std::chrono::microseconds SWEEP_FRAME_MAX_AGE = 1s;
+/* Angle bins of the sweep, one per degree */
+static constexpr size_t SWEEP_BINS = 181;
+/* Step through sectors where the previous sweep saw nothing, degrees */
+static constexpr uint8_t SWEEP_COARSE_STEP = 6;
+/* Degrees around an echo swept one by one */
+static constexpr uint8_t SWEEP_FINE_MARGIN = 6;
+/* Largest median window of the distance filter */
+static constexpr size_t FILTER_MAX_WINDOW = 7;
+/* Filter settings at boot: median of 5, new readings weigh 1/4 */
+static constexpr DistanceFilterConfig FILTER_DEFAULT_CONFIG = {5, 64};
+/* Samples buffered between the sensor thread and the BLE thread */
+static constexpr size_t SAMPLE_BUFFER_SIZE = 32;
+/* Servo fitted to the head, the client can refine its timing */
+static constexpr ServoProfile SERVO_PROFILE = SERVO_SG90;
+static constexpr ServoPulseTable SERVO_PULSES = make_servo_pulse_table(SERVO_PROFILE);
+/* Background subtraction at boot: changes beyond 5cm, a full sweep every 10 */
+static constexpr BackgroundConfig BACKGROUND_DEFAULT_CONFIG = {50, 10};
+/* Largest distance step between two bins of the same object */
+static constexpr uint16_t OBJECT_JOIN_MM = 80;
+/* Most objects reported per sweep */
+static constexpr size_t MAX_OBJECTS = 16;
+/* Most objects tracked across sweeps */
+static constexpr size_t MAX_TRACKS = 8;
+/* Smallest angle between two sensors pinged together, HC-SR04 beam width */
+static constexpr int SENSOR_BEAM_WIDTH = 30;
+/* Wait before retrying a ping while the sensor still listens */
+static constexpr std::chrono::microseconds PING_RETRY_DELAY = 1ms;
+/* Trace records kept until drained */
+static constexpr size_t TRACE_BUFFER_SIZE = 64;
+/* Period of the trace drain, to the trace characteristic or the UART */
+static constexpr std::chrono::milliseconds TRACE_DRAIN_PERIOD = 500ms;
+/* Most trace notifications sent by a drain, the rest waits for the next one */
+static constexpr size_t TRACE_DRAIN_BATCHES = 4;
+/* Period of the cycle profile snapshot read by clients */
+static constexpr std::chrono::milliseconds PROFILE_PERIOD = 1s;
+/* Period of the thermometer readings, the air warms up slowly */
+static constexpr std::chrono::milliseconds THERMOMETER_PERIOD = 10s;
+/* Reference voltage of the ADC the thermometer is read with, mV */
+static constexpr uint32_t THERMOMETER_REFERENCE_MV = 3300;
+#if MBED_CONF_APP_SERIAL_TRANSPORT
+/* Characteristics streamed to a wired host, index in SCHEMAS */
+static constexpr uint8_t SERIAL_SWEEP_FRAME = radar::protocol::schema_index(radar::protocol::SWEEP_FRAME);
+static constexpr uint8_t SERIAL_BUFFER_STATS = radar::protocol::schema_index(radar::protocol::BUFFER_STATS);
+static constexpr uint8_t SERIAL_OBJECTS = radar::protocol::schema_index(radar::protocol::OBJECTS);
+static constexpr uint8_t SERIAL_TRACKS = radar::protocol::schema_index(radar::protocol::TRACKS);
+#endif
+
+using radar::protocol::SampleBufferStats;
+
+/* Lists never outgrow the layouts clients decode them with */
+static_assert(SweepFrameBuilder::MAX_SIZE <= radar::protocol::SWEEP_FRAME.max_size(), "sweep frame too large");
+static_assert(PolarMap<SWEEP_BINS>::MAX_SIZE <= radar::protocol::POLAR_MAP.max_size(), "polar map too large");
+static_assert(ObjectSegmenter<SWEEP_BINS, MAX_OBJECTS>::MAX_SIZE <= radar::protocol::OBJECTS.max_size(),
+              "object list too large");
+static_assert(ObjectTracker<MAX_TRACKS>::MAX_SIZE <= radar::protocol::TRACKS.max_size(), "track list too large");
+static_assert(TraceLog<TRACE_BUFFER_SIZE>::MAX_SIZE <= radar::protocol::TRACE.max_size(), "trace batch too large");
+static_assert(CycleProfiler::MAX_SIZE <= radar::protocol::PROFILE.max_size(), "profile too large");
+
+/**
+ * Ultrasonic radar service.
+ *
+ * A servo sweeps an HC-SR04 from 0 to 180 degrees and back, each measured
+ * angle and distance is published through the radar characteristics.
+ * Several sensors can share the head, each covering the sector starting at
+ * its bearing so that the head only sweeps the first sector, or form a fixed
+ * array without servo. Their triggers are interleaved by a PingScheduler so
+ * that sensors facing the same direction never hear each other. The
+ * sweep is adaptive: it only slows down to 1 degree steps around the objects
+ * seen by the previous sweep, see SweepScheduler.
+ *
+ * Servo motion and ranging are pipelined: the next angle is commanded as
+ * soon as an echo is captured and the next ping fires when the head has
+ * settled (see ServoMotion) but never before the sensor is ready again (see
+ * RangeGate).
+ *
+ * Distances are filtered per angle bin (see DistanceFilter) and published
+ * in mm. Samples are also batched into sweep frames carrying several
+ * (angle, distance) pairs in a single notification, see SweepFrameBuilder.
+ * The last distance per angle is kept in a PolarMap that a client reads in
+ * one go when it connects. Once the static scene is learnt (see
+ * BackgroundModel) only the samples departing from it are notified, with a
+ * full keyframe sweep from time to time. At the end of every sweep its
+ * echoes are grouped into objects (see ObjectSegmenter), followed across
+ * sweeps with their radial velocity (see ObjectTracker), and both lists are
+ * notified.
+ *
+ * The link is negotiated to the largest ATT MTU, packet length and PHY the
+ * controller supports (see LinkManager), the batched payloads grow with it.
+ * A short connection interval is requested while the radar runs with a
+ * client subscribed, a long one with slave latency otherwise.
+ *
+ * GATT events are traced in RAM (see TraceLog) rather than printed, the
+ * trace is drained periodically to the trace characteristic when a client
+ * subscribed to it and to the UART otherwise.
+ *
+ * Each stage of the measurement and publish path is timed with the cycle
+ * counter (see CycleProfiler), the profile is readable from the diagnostics
+ * characteristic and any write to it starts a new one.
+ *
+ * Echoes are converted with the speed of sound at the air temperature, read
+ * from the thermometer of the board or written by a client, or measured on a
+ * reference reflector at the request of a client (see SoundCalibrator).
+ *
+ * A wired host can be served over a UART as well (see SerialLink). The radio
+ * no longer limits what it gets: every sample is streamed in sweep frames as
+ * large as the protocol allows, whatever the background, along with the
+ * object and track lists. Its reads and writes name the characteristics by
+ * their index in SCHEMAS and its writes go through the same checks and
+ * handlers as the ones of BLE clients.
+ *
+ * Acquisition and servo stepping run on the sensor event queue, dispatched by
+ * a high priority thread, while GATT updates run on the BLE event queue.
+ * Samples travel between the two through a lock-free ring buffer drained in
+ * batches.
+ */
+class RadarService : public ble::GattServer::EventHandler {
+public:
+    RadarService(const RadarHardware &hw, events::EventQueue &sensor_queue) :
+        _hw(hw),
+        _sensor_queue(&sensor_queue),
+        _angle_char(radar::protocol::ANGLE.uuid, 0, radar::protocol::ANGLE.properties),
+        _distance_char(radar::protocol::DISTANCE.uuid, 0, radar::protocol::DISTANCE.properties),
+        _running_char(radar::protocol::RUNNING.uuid, 0, radar::protocol::RUNNING.properties),
+        _threshold_char(radar::protocol::THRESHOLD.uuid, 0, radar::protocol::THRESHOLD.properties),
+        _sweep_frame_char(radar::protocol::SWEEP_FRAME.uuid, radar::protocol::SWEEP_FRAME.properties),
+        _filter_char(radar::protocol::FILTER.uuid, FILTER_DEFAULT_CONFIG, radar::protocol::FILTER.properties),
+        _max_range_char(radar::protocol::MAX_RANGE.uuid, DEFAULT_MAX_RANGE_MM, radar::protocol::MAX_RANGE.properties),
+        _servo_timing_char(
+            radar::protocol::SERVO_TIMING.uuid,
+            SERVO_PROFILE.timing,
+            radar::protocol::SERVO_TIMING.properties
+        ),
+        _profile_char(radar::protocol::PROFILE.uuid, radar::protocol::PROFILE.properties),
+        _trace_char(radar::protocol::TRACE.uuid, radar::protocol::TRACE.properties),
+        _link_char(radar::protocol::LINK.uuid, _link.status(), radar::protocol::LINK.properties),
+        _tracks_char(radar::protocol::TRACKS.uuid, radar::protocol::TRACKS.properties),
+        _objects_char(radar::protocol::OBJECTS.uuid, radar::protocol::OBJECTS.properties),
+        _background_char(
+            radar::protocol::BACKGROUND.uuid,
+            BACKGROUND_DEFAULT_CONFIG,
+            radar::protocol::BACKGROUND.properties
+        ),
+        _polar_map_char(radar::protocol::POLAR_MAP.uuid, radar::protocol::POLAR_MAP.properties),
+        _buffer_stats_char(
+            radar::protocol::BUFFER_STATS.uuid,
+            SampleBufferStats{0, 0, 0, SAMPLE_BUFFER_SIZE},
+            radar::protocol::BUFFER_STATS.properties
+        ),
+        _calibration_char(
+            radar::protocol::CALIBRATION.uuid,
+            _calibrator.state(),
+            radar::protocol::CALIBRATION.properties
+        ),
+        _clock_service(
+            /* uuid */ radar::protocol::SERVICE_UUID,
+            /* characteristics */ _radar_characteristics,
+            /* numCharacteristics */ sizeof(_radar_characteristics) /
+                                     sizeof(_radar_characteristics[0])
+        )
+    {
+        /* update internal pointers (value, descriptors and characteristics array) */
+        set_characteristic<radar::protocol::schema_index(radar::protocol::ANGLE)>(_angle_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::DISTANCE)>(_distance_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::RUNNING)>(_running_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::THRESHOLD)>(_threshold_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::SWEEP_FRAME)>(_sweep_frame_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::BUFFER_STATS)>(_buffer_stats_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::FILTER)>(_filter_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::MAX_RANGE)>(_max_range_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::SERVO_TIMING)>(_servo_timing_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::POLAR_MAP)>(_polar_map_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::BACKGROUND)>(_background_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::OBJECTS)>(_objects_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::TRACKS)>(_tracks_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::LINK)>(_link_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::TRACE)>(_trace_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::PROFILE)>(_profile_char);
+        set_characteristic<radar::protocol::schema_index(radar::protocol::CALIBRATION)>(_calibration_char);
+
+        /* setup authorization handlers */
+        _angle_char.setWriteAuthorizationCallback(this, &RadarService::authorize_client_write);
+        _distance_char.setWriteAuthorizationCallback(this, &RadarService::authorize_client_write);
+        _running_char.setWriteAuthorizationCallback(this, &RadarService::authorize_client_write);
+        _threshold_char.setWriteAuthorizationCallback(this, &RadarService::authorize_client_write);
+        _filter_char.setWriteAuthorizationCallback(this, &RadarService::authorize_client_write);
+        _max_range_char.setWriteAuthorizationCallback(this, &RadarService::authorize_client_write);
+        _servo_timing_char.setWriteAuthorizationCallback(this, &RadarService::authorize_client_write);
+        _background_char.setWriteAuthorizationCallback(this, &RadarService::authorize_client_write);
+        _calibration_char.setWriteAuthorizationCallback(this, &RadarService::authorize_client_write);
+
+        // The head sweeps until the last sensor reaches 180 degrees
+        _ping_scheduler.configure(_hw.sensors, SENSOR_BEAM_WIDTH);
+        int last_bearing = 0;
+        for (size_t i = 0; i < _ping_scheduler.sensors(); ++i) {
+            if (_hw.sensors[i].bearing > last_bearing) {
+                last_bearing = _hw.sensors[i].bearing;
+            }
+        }
+        _sweep.set_span(_hw.servo && last_bearing < 180 ? 180 - last_bearing : 0);
+    }
+
+#if MBED_CONF_APP_SERIAL_TRANSPORT
+    /**
+     * Serve a wired host over link as well, before start().
+     */
+    void attach_serial(SerialLink &link)
+    {
+        _serial = &link;
+    }
+#endif
+
+    void start(BLE &ble, events::EventQueue &event_queue)
+    {
+        _server = &ble.gattServer();
+        _event_queue = &event_queue;
+
+        // Echo edges, servo frames and trace records are timed against the same timer
+        timer.start();
+        _trace.bind(timer);
+        CycleCounter::enable();
+
+        // Configure servo PWM: frame period and initial position
+        if (_hw.servo) {
+            _hw.servo->period_us(_servo_motion.profile().frame_us);
+            _hw.servo->pulsewidth_us(_servo_motion.pulse_width_us(90)); // Neutral position
+            _servo_motion.start(timer.elapsed_time());
+        }
+
+        for (size_t i = 0; i < _ping_scheduler.sensors(); ++i) {
+            _channels[i].bind(_hw.sensors[i].echo, timer, callback(this, &RadarService::on_echo_done));
+        }
+
+        printf("Registering BLE service\r\n");
+        ble_error_t err = _server->addService(_clock_service);
+
+        if (err) {
+            printf("Error %u during demo service registration.\r\n", err);
+            return;
+        }
+
+        /* register handlers */
+        _server->setEventHandler(this);
+        _link.start(ble, callback(this, &RadarService::on_link_change));
+#if MBED_CONF_APP_SERIAL_TRANSPORT
+        if (_serial) {
+            _serial_frame.set_capacity(SweepFrameBuilder::MAX_SAMPLES);
+            _serial->start(event_queue, callback(this, &RadarService::on_serial_frame));
+        }
+#endif
+
+        if (TraceLog<TRACE_BUFFER_SIZE>::ENABLED) {
+            _event_queue->call_every(TRACE_DRAIN_PERIOD, callback(this, &RadarService::drain_trace));
+        }
+        publish_profile();
+        _event_queue->call_every(PROFILE_PERIOD, callback(this, &RadarService::publish_profile));
+
+        if (_hw.thermometer) {
+            _sensor_queue->call(callback(this, &RadarService::read_temperature));
+            _sensor_queue->call_every(THERMOMETER_PERIOD, callback(this, &RadarService::read_temperature));
+        }
+
+        _running = true;
+        _sensor_queue->call(callback(this, &RadarService::start_sweep));
+        _running_char.set(*_server, _running);
+        update_link_activity();
+    }
+
+
+    /* GattServer::EventHandler */
+private:
+
+    /**
+     * Handler called when a notification or an indication has been sent.
+     */
+    void onDataSent(const GattDataSentCallbackParams &params) override
+    {
+        // Notifying the trace must not feed it
+        if (params.attHandle != _trace_char.getValueHandle()) {
+            RADAR_TRACE_DEBUG(_trace, DataSent, params.attHandle, 0);
+        }
+        if (_trace_blocked) {
+            _trace_blocked = false;
+            _event_queue->call(callback(this, &RadarService::drain_trace));
+        }
+    }
+
+    /**
+     * Handler called after an attribute has been written.
+     */
+    void onDataWritten(const GattWriteCallbackParams &params) override
+    {
+        RADAR_TRACE_INFO(_trace, DataWritten, params.handle, trace_write(params));
+
+        uint8_t running_value;
+        if (_running_char.decode(params, running_value)) {
+            if (running_value == 0) {
+                // The ping in flight completes, no other one is scheduled
+                _running = false;
+            }
+            else if (!_running.exchange(true)) {
+                _sensor_queue->call(callback(this, &RadarService::start_sweep));
+            }
+            _running_char.set(*_server, _running);
+            update_link_activity();
+        }
+
+        uint8_t threshold_value;
+        if (_threshold_char.decode(params, threshold_value)) {
+            // The LED is driven from the sensor thread
+            _sensor_queue->call([this, threshold_value]() {
+                threshold = threshold_value;
+            });
+        }
+
+        DistanceFilterConfig filter_config;
+        if (_filter_char.decode(params, filter_config)) {
+            // The filter belongs to the sensor thread
+            _sensor_queue->call([this, filter_config]() {
+                _filter.configure(filter_config);
+            });
+        }
+
+        uint16_t max_range_value;
+        if (_max_range_char.decode(params, max_range_value)) {
+            // The range gate belongs to the sensor thread
+            _sensor_queue->call([this, max_range_value]() {
+                set_max_range(max_range_value);
+            });
+        }
+
+        BackgroundConfig background_config;
+        if (_background_char.decode(params, background_config)) {
+            _background.configure(background_config);
+        }
+
+        if (params.handle == _profile_char.getValueHandle()) {
+            _profile.reset();
+            publish_profile();
+        }
+
+        ServoTiming servo_timing;
+        if (_servo_timing_char.decode(params, servo_timing)) {
+            // The motion model belongs to the sensor thread
+            _sensor_queue->call([this, servo_timing]() {
+                _servo_motion.set_timing(servo_timing);
+            });
+        }
+
+        SoundCalibration calibration;
+        if (_calibration_char.decode(params, calibration)) {
+            // The calibration belongs to the sensor thread
+            _sensor_queue->call([this, calibration]() {
+                calibrate(calibration);
+            });
+        }
+    }
+
+    /**
+     * Handler called after an attribute has been read.
+     */
+    void onDataRead(const GattReadCallbackParams &params) override
+    {
+        RADAR_TRACE_DEBUG(_trace, DataRead, params.handle, 0);
+    }
+
+    /**
+     * Handler called after a client has subscribed to notification or indication.
+     *
+     * @param handle Handle of the characteristic value affected by the change.
+     */
+    void onUpdatesEnabled(const GattUpdatesEnabledCallbackParams &params) override
+    {
+        RADAR_TRACE_INFO(_trace, UpdatesEnabled, params.attHandle, 0);
+        if (params.attHandle == _trace_char.getValueHandle()) {
+            _trace_subscribed = true;
+            _trace_blocked = false;
+            _event_queue->call(callback(this, &RadarService::drain_trace));
+        }
+        ++_subscriptions;
+        update_link_activity();
+    }
+
+    /**
+     * Handler called after a client has cancelled his subscription from
+     * notification or indication.
+     *
+     * @param handle Handle of the characteristic value affected by the change.
+     */
+    void onUpdatesDisabled(const GattUpdatesDisabledCallbackParams &params) override
+    {
+        RADAR_TRACE_INFO(_trace, UpdatesDisabled, params.attHandle, 0);
+        if (params.attHandle == _trace_char.getValueHandle()) {
+            _trace_subscribed = false;
+        }
+        if (_subscriptions) {
+            --_subscriptions;
+        }
+        update_link_activity();
+    }
+
+    /**
+     * Handler called when an indication confirmation has been received.
+     *
+     * @param handle Handle of the characteristic value that has emitted the
+     * indication.
+     */
+    void onConfirmationReceived(const GattConfirmationReceivedCallbackParams &params) override
+    {
+        RADAR_TRACE_DEBUG(_trace, ConfirmationReceived, params.attHandle, 0);
+    }
+
+    /**
+     * Handler called when the ATT MTU of a connection changed, sweep frames
+     * grow to fill the notifications.
+     */
+    void onAttMtuChange(ble::connection_handle_t connectionHandle, uint16_t attMtuSize) override
+    {
+        RADAR_TRACE_INFO(_trace, AttMtuChanged, attMtuSize, 0);
+        resize_notifications(attMtuSize);
+        _link.on_att_mtu(attMtuSize);
+    }
+
+private:
+    /**
+     * Place characteristic in the service at Index, its position in SCHEMAS:
+     * the serial link addresses characteristics by that position.
+     */
+    template <size_t Index>
+    void set_characteristic(GattCharacteristic &characteristic)
+    {
+        static_assert(Index < radar::protocol::SCHEMA_COUNT, "characteristic missing from SCHEMAS");
+        _radar_characteristics[Index] = &characteristic;
+    }
+
+    /**
+     * Handler called when a write request is received.
+     *
+     * This handler verify that the value submitted by the client is valid before
+     * authorizing the operation.
+     */
+    void authorize_client_write(GattWriteAuthCallbackParams *e)
+    {
+        if (e->handle == _max_range_char.getValueHandle()) {
+            if (e->len != sizeof(uint16_t)) {
+                e->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH;
+                return;
+            }
+
+            uint16_t max_range = e->data[0] | (e->data[1] << 8);
+            if (max_range < RangeGate::MIN_RANGE_MM || max_range > RangeGate::MAX_RANGE_MM) {
+                e->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_WRITE_NOT_PERMITTED;
+                return;
+            }
+        }
+
+        if (e->handle == _background_char.getValueHandle()) {
+            if (e->len != sizeof(BackgroundConfig)) {
+                e->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH;
+                return;
+            }
+        }
+
+        if (e->handle == _servo_timing_char.getValueHandle()) {
+            if (e->len != sizeof(ServoTiming)) {
+                e->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH;
+                return;
+            }
+        }
+
+        if (e->handle == _calibration_char.getValueHandle()) {
+            if (e->len != sizeof(SoundCalibration)) {
+                e->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH;
+                return;
+            }
+
+            const SoundCalibration *calibration = reinterpret_cast<const SoundCalibration *>(e->data);
+            bool temperature_valid = calibration->temperature == TEMPERATURE_UNKNOWN ||
+                                     (calibration->temperature >= SoundCalibrator::MIN_TEMPERATURE &&
+                                      calibration->temperature <= SoundCalibrator::MAX_TEMPERATURE);
+            bool reference_valid = calibration->reference_mm == 0 ||
+                                   (calibration->reference_mm >= RangeGate::MIN_RANGE_MM &&
+                                    calibration->reference_mm <= RangeGate::MAX_RANGE_MM &&
+                                    calibration->reference_angle < SWEEP_BINS);
+            if (!temperature_valid || !reference_valid) {
+                e->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_WRITE_NOT_PERMITTED;
+                return;
+            }
+        }
+
+        if (e->handle == _filter_char.getValueHandle()) {
+            if (e->len != sizeof(DistanceFilterConfig)) {
+                e->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH;
+                return;
+            }
+
+            const DistanceFilterConfig *config = reinterpret_cast<const DistanceFilterConfig *>(e->data);
+            if (config->median_window < 1 || config->median_window > FILTER_MAX_WINDOW) {
+                e->authorizationReply = AUTH_CALLBACK_REPLY_ATTERR_WRITE_NOT_PERMITTED;
+                return;
+            }
+        }
+    }
+
+#if MBED_CONF_APP_SERIAL_TRANSPORT
+    /**
+     * A frame of the wired host.
+     */
+    void on_serial_frame(const SerialFrameHeader &header, mbed::Span<const uint8_t> value)
+    {
+        if (header.characteristic >= radar::protocol::SCHEMA_COUNT) {
+            return;
+        }
+        GattAttribute::Handle_t handle = _radar_characteristics[header.characteristic]->getValueHandle();
+
+        if (header.type == static_cast<uint8_t>(SerialFrameType::Write)) {
+            GattAuthCallbackReply_t reply = write_from_serial(
+                radar::protocol::SCHEMAS[header.characteristic], handle, value
+            );
+            if (reply != AUTH_CALLBACK_REPLY_SUCCESS) {
+                RADAR_TRACE_ERROR(_trace, SerialRejected, header.characteristic, reply);
+            }
+        } else if (header.type == static_cast<uint8_t>(SerialFrameType::Read)) {
+            uint8_t buffer[radar::protocol::MAX_ATTRIBUTE_SIZE];
+            uint16_t length = sizeof(buffer);
+            if (_server->read(handle, buffer, &length) == BLE_ERROR_NONE) {
+                _serial->send(SerialFrameType::Value, header.characteristic,
+                              mbed::Span<const uint8_t>(buffer, length), radar::protocol::SERIAL_VALUE_READ);
+            }
+        }
+    }
+
+    /**
+     * Write a value of the wired host as the BLE stack writes the value of a
+     * client: checked against the characteristic, authorized, stored, then
+     * handled.
+     */
+    GattAuthCallbackReply_t write_from_serial(const radar::protocol::Schema &schema, GattAttribute::Handle_t handle,
+                                              mbed::Span<const uint8_t> value)
+    {
+        if (!(schema.properties & radar::protocol::PROPERTY_WRITE)) {
+            return AUTH_CALLBACK_REPLY_ATTERR_WRITE_NOT_PERMITTED;
+        }
+        if (!schema.is_list() && static_cast<size_t>(value.size()) != schema.header_size) {
+            return AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH;
+        }
+
+        GattWriteAuthCallbackParams auth = {};
+        auth.handle = handle;
+        auth.len = static_cast<uint16_t>(value.size());
+        auth.data = value.data();
+        auth.authorizationReply = AUTH_CALLBACK_REPLY_SUCCESS;
+        authorize_client_write(&auth);
+        if (auth.authorizationReply != AUTH_CALLBACK_REPLY_SUCCESS) {
+            return auth.authorizationReply;
+        }
+
+        if (_server->write(handle, value.data(), auth.len, /* local_only */ true) != BLE_ERROR_NONE) {
+            return AUTH_CALLBACK_REPLY_ATTERR_INVALID_ATT_VAL_LENGTH;
+        }
+        GattWriteCallbackParams params = {};
+        params.handle = handle;
+        params.writeOp = GattWriteCallbackParams::OP_WRITE_CMD;
+        params.len = auth.len;
+        params.data = value.data();
+        onDataWritten(params);
+        return AUTH_CALLBACK_REPLY_SUCCESS;
+    }
+#endif
+
+    /**
+     * Size the batched payloads to fill the notifications at att_mtu.
+     */
+    void resize_notifications(uint16_t att_mtu)
+    {
+        _sweep_frame.set_att_mtu(att_mtu);
+        _objects.set_att_mtu(att_mtu);
+        _tracker.set_att_mtu(att_mtu);
+        _trace.set_att_mtu(att_mtu);
+    }
+
+    /**
+     * A link parameter was negotiated.
+     */
+    void on_link_change(const LinkStatus &status)
+    {
+        if (!_link.connected()) {
+            // Subscriptions of a peer without bond end with the connection,
+            // the next peer starts at the default MTU
+            _subscriptions = 0;
+            update_link_activity();
+            resize_notifications(radar::protocol::DEFAULT_ATT_MTU);
+        }
+        _link_char.set(*_server, status);
+    }
+
+    /**
+     * Refresh the profile read by clients.
+     */
+    void publish_profile()
+    {
+        _profile_char.set(*_server, _profile.bytes(), /* local_only */ true);
+    }
+
+    /**
+     * Empty the trace, in notifications when a client listens to it: a few
+     * batches per run, and a batch the stack refuses is kept until a
+     * notification has been sent.
+     */
+    void drain_trace()
+    {
+        if (!_trace_subscribed) {
+            _trace.print();
+            return;
+        }
+
+        for (size_t i = 0; i < TRACE_DRAIN_BATCHES && !_trace.empty(); ++i) {
+            if (_trace_char.set(*_server, _trace.batch()) != BLE_ERROR_NONE) {
+                // Out of buffers, the batch is kept and sent once one frees
+                _trace_blocked = true;
+                return;
+            }
+            _trace.release();
+        }
+    }
+
+    /**
+     * Length and first bytes of a write, as traced.
+     */
+    static uint32_t trace_write(const GattWriteCallbackParams &params)
+    {
+        uint32_t value = static_cast<uint32_t>(params.len) << 24;
+        for (size_t i = 0; i < params.len && i < 3; ++i) {
+            value |= static_cast<uint32_t>(params.data[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    /**
+     * Ask for a short connection interval only while notifications stream.
+     */
+    void update_link_activity()
+    {
+        _link.set_active(_running && _subscriptions);
+    }
+
+    /**
+     * Derive the measurement cycle from a new maximum range, it applies from
+     * the next ping. Runs on the sensor queue, the change is traced on the
+     * BLE thread.
+     */
+    void set_max_range(uint16_t max_range_mm)
+    {
+        _range_gate = RangeGate::from_max_range(max_range_mm, _calibrator.scale());
+
+        uint16_t range_mm = _range_gate.max_range_mm;
+        uint32_t retrigger_us = static_cast<uint32_t>(_range_gate.retrigger_interval.count());
+        _event_queue->call([this, range_mm, retrigger_us]() {
+            RADAR_TRACE_INFO(_trace, MaxRangeChanged, range_mm, retrigger_us);
+        });
+    }
+
+    /**
+     * Apply a calibration written by a client, runs on the sensor queue.
+     */
+    void calibrate(const SoundCalibration &calibration)
+    {
+        if (calibration.temperature == TEMPERATURE_UNKNOWN && !calibration.reference_mm) {
+            _calibrator.reset();
+        }
+        if (calibration.temperature != TEMPERATURE_UNKNOWN) {
+            _calibrator.set_temperature(calibration.temperature, /* measured */ false);
+        }
+        if (calibration.reference_mm) {
+            _calibrator.start_reference(calibration.reference_angle, calibration.reference_mm, _sweep.sweeps());
+        }
+        apply_calibration(/* notify */ true);
+    }
+
+    /**
+     * Sample the thermometer, runs on the sensor queue.
+     */
+    void read_temperature()
+    {
+        // TMP36: 500 mV at 0 degree, 10 mV per degree
+        uint32_t tenth_mv = _hw.thermometer->read_u16() * (THERMOMETER_REFERENCE_MV * 10) / 0xFFFF;
+        int32_t temperature = static_cast<int32_t>(tenth_mv) - 5000;
+        if (temperature < SoundCalibrator::MIN_TEMPERATURE || temperature > SoundCalibrator::MAX_TEMPERATURE) {
+            // Unplugged or shorted, the speed of sound keeps the last good reading
+            return;
+        }
+        _calibrator.set_temperature(static_cast<int16_t>(temperature), /* measured */ true);
+        apply_calibration(/* notify */ false);
+    }
+
+    /**
+     * Derive the range gate from the speed of sound now in use and refresh
+     * the calibration read by clients, runs on the sensor queue.
+     */
+    void apply_calibration(bool notify)
+    {
+        _range_gate = RangeGate::from_max_range(_range_gate.max_range_mm, _calibrator.scale());
+
+        // The characteristic and the trace belong to the BLE thread
+        SoundCalibration state = _calibrator.state();
+        _event_queue->call([this, state, notify]() {
+            if (notify) {
+                RADAR_TRACE_INFO(_trace, CalibrationChanged, state.flags, state.sound_speed);
+            }
+            _calibration_char.set(*_server, state, /* local_only */ !notify);
+        });
+    }
+
+    /**
+     * Command the head to the current angle and ping once it has settled,
+     * runs on the sensor queue.
+     */
+    void start_sweep(void)
+    {
+        if (_ping_pending || _in_flight) {
+            // Stopped and restarted before the last ping completed, that
+            // ping carries on the sweep
+            return;
+        }
+
+        _slot = 0;
+        schedule_ping(move_head());
+    }
+
+    /**
+     * Command the head to the current angle.
+     *
+     * @return The time at which the head is settled.
+     */
+    std::chrono::microseconds move_head(void)
+    {
+        if (!_hw.servo) {
+            return timer.elapsed_time();
+        }
+
+        uint32_t start = CycleCounter::now();
+        _hw.servo->pulsewidth_us(_servo_motion.pulse_width_us(angle));
+        std::chrono::microseconds settled = _servo_motion.move(angle, timer.elapsed_time());
+        _profile.record(ProfileStage::Servo, start);
+        return settled;
+    }
+
+    /**
+     * Arm the next ping for the time at.
+     */
+    void schedule_ping(std::chrono::microseconds at)
+    {
+        std::chrono::microseconds delay = at - timer.elapsed_time();
+        if (delay < 0us) {
+            delay = 0us;
+        }
+
+        _ping_pending = true;
+        _next_ping.attach(callback(this, &RadarService::on_ping_due), delay);
+    }
+
+    /**
+     * The next ping is due, called in interrupt context.
+     */
+    void on_ping_due(void)
+    {
+        _sensor_queue->call(callback(this, &RadarService::loop));
+    }
+
+    /**
+     * Start a new measurement on the sensors of the current slot.
+     *
+     * The ping is only triggered here, the echoes are captured by the edge
+     * interrupts and processed later by process_echo() so that the event queue
+     * is never blocked during the flight time.
+     */
+    void loop(void)
+    {
+        _ping_pending = false;
+        if (!_running) {
+            return;
+        }
+
+        uint8_t slot = _ping_scheduler.slot(_slot);
+        for (size_t i = 0; i < _ping_scheduler.sensors(); ++i) {
+            if ((slot & (1u << i)) && _hw.sensors[i].echo.read()) {
+                // The sensor is still listening for an echo beyond the gate
+                schedule_ping(timer.elapsed_time() + PING_RETRY_DELAY);
+                return;
+            }
+        }
+
+        uint32_t start = CycleCounter::now();
+        _last_trigger = timer.elapsed_time();
+        _in_flight = slot;
+        for (size_t i = 0; i < _ping_scheduler.sensors(); ++i) {
+            if (slot & (1u << i)) {
+                _channels[i].arm(ECHO_RISE_TIMEOUT, _range_gate.echo_timeout);
+                _hw.sensors[i].trig.write(0);  // Ensure trigger is low
+            }
+        }
+
+        wait_us(2);        // Short delay
+        set_triggers(slot, 1);  // Trigger high for 10µs
+        wait_us(10);
+        set_triggers(slot, 0);  // Trigger low
+
+        _profile.record(ProfileStage::Trigger, start);
+        _trigger_cycles = CycleCounter::now();
+    }
+
+    void set_triggers(uint8_t slot, int level)
+    {
+        for (size_t i = 0; i < _ping_scheduler.sensors(); ++i) {
+            if (slot & (1u << i)) {
+                _hw.sensors[i].trig.write(level);
+            }
+        }
+    }
+
+    /**
+     * An echo is captured, called in interrupt context.
+     */
+    void on_echo_done(void)
+    {
+        _sensor_queue->call(callback(this, &RadarService::process_echo));
+    }
+
+    /**
+     * Once every echo of the slot is captured convert them, move on to the
+     * next slot or the next angle and queue the samples for the BLE thread,
+     * runs on the sensor queue.
+     */
+    void process_echo(void)
+    {
+        uint8_t slot = _in_flight;
+        if (!slot) {
+            // Handled with the other echoes of the slot
+            return;
+        }
+
+        for (size_t i = 0; i < _ping_scheduler.sensors(); ++i) {
+            if ((slot & (1u << i)) && _channels[i].state() != EchoChannel::State::Done) {
+                return;
+            }
+        }
+        _in_flight = 0;
+        _profile.record(ProfileStage::EchoWait, _trigger_cycles);
+
+        for (size_t i = 0; i < _ping_scheduler.sensors(); ++i) {
+            if (slot & (1u << i)) {
+                publish_echo(i);
+            }
+        }
+
+        std::chrono::microseconds ready = _last_trigger + _range_gate.retrigger_interval;
+        if (++_slot < _ping_scheduler.slots()) {
+            // Same angle, the echoes of this slot must die out first
+            if (_running) {
+                schedule_ping(ready);
+            }
+            return;
+        }
+
+        _slot = 0;
+        angle = _sweep.next(angle, _angle_echo);
+        _angle_echo = false;
+    
+        // The head travels while the rest of the cycle elapses
+        std::chrono::microseconds settled = move_head();
+        if (_running) {
+            schedule_ping(settled > ready ? settled : ready);
+        }
+    }
+
+    /**
+     * Convert the echo captured by a sensor and queue the sample for the BLE
+     * thread.
+     */
+    void publish_echo(size_t sensor)
+    {
+        uint32_t start = CycleCounter::now();
+        EchoChannel &channel = _channels[sensor];
+        int bearing = angle + _hw.sensors[sensor].bearing;
+        _angle_echo = _angle_echo || channel.in_range();
+
+        uint32_t round_trip_us = static_cast<uint32_t>(channel.width().count());
+        distance_mm = _filter.update(bearing, _calibrator.scale().distance_mm(round_trip_us));
+        if (_calibrator.pending() &&
+            _calibrator.add_echo(bearing, round_trip_us, channel.in_range(), _sweep.sweeps())) {
+            apply_calibration(/* notify */ true);
+        }
+        distance = distance_mm / 10;
+    
+        //printf("Distance: %d cm\n", distance);
+
+        RadarSample sample = {
+            static_cast<uint32_t>(channel.start().count()),
+            static_cast<uint8_t>(bearing),
+            static_cast<uint16_t>(distance_mm),
+            _sweep.sweeps(),
+            channel.in_range()
+        };
+        channel.release();
+
+        if (distance <= threshold) {
+            _hw.led = 1;
+        }
+        else {
+            _hw.led = 0;   
+        }
+
+        // A dropped sample is accounted by the buffer
+        _samples.push(sample);
+        if (!_drain_pending.exchange(true)) {
+            _event_queue->call(callback(this, &RadarService::drain_samples));
+        }
+        _profile.record(ProfileStage::Convert, start);
+    }
+
+    /**
+     * Publish every sample waiting in the buffer, runs on the BLE queue.
+     */
+    void drain_samples(void)
+    {
+        // Cleared first so that a sample pushed while draining posts again
+        _drain_pending = false;
+
+        RadarSample sample;
+        RadarSample last;
+        bool drained = false;
+        bool published = false;
+        while (_samples.pop(sample)) {
+            uint32_t start = CycleCounter::now();
+            if (publish_sample(sample)) {
+                last = sample;
+                published = true;
+            }
+            _profile.record(ProfileStage::Publish, start);
+            drained = true;
+        }
+
+        if (!drained) {
+            return;
+        }
+
+        // Update BLE characteristic
+        if (published) {
+            uint32_t start = CycleCounter::now();
+            _distance_char.set(*_server, last.distance_mm);
+            _profile.record(ProfileStage::GattWrite, start);
+            start = CycleCounter::now();
+            _angle_char.set(*_server, last.angle);
+            _profile.record(ProfileStage::GattWrite, start);
+        }
+        _polar_map_char.set(*_server, _polar_map.bytes(), /* local_only */ true);
+
+        publish_buffer_stats();
+    }
+
+    /**
+     * Record a sample in the polar map and the objects of its sweep, the
+     * objects and tracks of the previous sweep are notified once it is over.
+     *
+     * The sample is also appended to the sweep frame if it departs from the
+     * background, the frame is sent when full, at each end of the sweep or
+     * when its oldest sample gets too old.
+     *
+     * @return true if the sample is sent.
+     */
+    bool publish_sample(const RadarSample &sample)
+    {
+        if (sample.sweep != _objects_sweep) {
+            _objects.finish(_objects_sweep);
+            _objects_char.set(*_server, _objects.bytes());
+            _tracker.update(_objects.objects(), _objects.times_us(), _objects_sweep);
+            _tracks_char.set(*_server, _tracker.bytes());
+#if MBED_CONF_APP_SERIAL_TRANSPORT
+            if (_serial) {
+                // The UART is not bound by the ATT MTU
+                _serial->send(SerialFrameType::Value, SERIAL_OBJECTS, _objects.bytes(MAX_OBJECTS));
+                _serial->send(SerialFrameType::Value, SERIAL_TRACKS, _tracker.bytes(MAX_TRACKS));
+            }
+#endif
+            _objects_sweep = sample.sweep;
+        }
+        _objects.add(sample.angle, sample.distance_mm, sample.echo, sample.sweep, sample.timestamp_us);
+
+        _polar_map.update(sample.angle, sample.distance_mm, sample.sweep);
+#if MBED_CONF_APP_SERIAL_TRANSPORT
+        if (_serial) {
+            stream_sample(sample);
+        }
+#endif
+        bool foreground = _background.update(sample.angle, sample.distance_mm, sample.sweep);
+
+        // The frame of the previous sweep is over, whether or not the sample is
+        if (!_sweep_frame.empty() && _sweep_frame.sweep() != sample.sweep) {
+            send_sweep_frame();
+        }
+
+        if (foreground) {
+            if (_sweep_frame.empty()) {
+                _sweep_frame_started = sample.timestamp_us;
+            }
+            _sweep_frame.push(sample.angle, sample.distance_mm, sample.sweep);
+        }
+
+        if (_sweep_frame.empty()) {
+            return false;
+        }
+
+        if (frame_due(_sweep_frame, _sweep_frame_started, sample)) {
+            send_sweep_frame();
+        }
+        return foreground;
+    }
+
+    /**
+     * Notify the sweep frame in progress, a frame split by a smaller MTU
+     * takes several notifications.
+     */
+    void send_sweep_frame()
+    {
+        do {
+            uint32_t start = CycleCounter::now();
+            _sweep_frame_char.set(*_server, _sweep_frame.bytes());
+            _profile.record(ProfileStage::GattWrite, start);
+            _sweep_frame.next();
+        } while (!_sweep_frame.empty());
+    }
+
+#if MBED_CONF_APP_SERIAL_TRANSPORT
+    /**
+     * Append a sample to the sweep frame of the wired host, which gets every
+     * sample.
+     */
+    void stream_sample(const RadarSample &sample)
+    {
+        if (!_serial_frame.empty() && _serial_frame.sweep() != sample.sweep) {
+            _serial->send(SerialFrameType::Value, SERIAL_SWEEP_FRAME, _serial_frame.bytes());
+            _serial_frame.next();
+        }
+
+        if (_serial_frame.empty()) {
+            _serial_frame_started = sample.timestamp_us;
+        }
+        _serial_frame.push(sample.angle, sample.distance_mm, sample.sweep);
+
+        if (frame_due(_serial_frame, _serial_frame_started, sample)) {
+            _serial->send(SerialFrameType::Value, SERIAL_SWEEP_FRAME, _serial_frame.bytes());
+            _serial_frame.next();
+        }
+    }
+#endif
+
+    /**
+     * Whether a frame started at started must be sent after sample: when
+     * full or when its oldest sample gets too old. The frames of a sweep are
+     * sent as the next one starts.
+     */
+    static bool frame_due(const SweepFrameBuilder &frame, uint32_t started, const RadarSample &sample)
+    {
+        bool too_old = std::chrono::microseconds(sample.timestamp_us - started) >= SWEEP_FRAME_MAX_AGE;
+        return frame.full() || too_old;
+    }
+
+    /**
+     * Refresh the buffer statistics, clients are only notified when samples
+     * were dropped.
+     */
+    void publish_buffer_stats(void)
+    {
+        SampleBufferStats stats = {
+            _samples.pushed(),
+            _samples.overflows(),
+            static_cast<uint16_t>(_samples.high_watermark()),
+            static_cast<uint16_t>(_samples.capacity())
+        };
+
+        bool overflowed = stats.overflows != _reported_overflows;
+        _reported_overflows = stats.overflows;
+        _buffer_stats_char.set(*_server, stats, /* local_only */ !overflowed);
+#if MBED_CONF_APP_SERIAL_TRANSPORT
+        if (_serial && overflowed) {
+            _serial->send(SerialFrameType::Value, SERIAL_BUFFER_STATS,
+                          mbed::Span<const uint8_t>(reinterpret_cast<const uint8_t *>(&stats), sizeof(stats)));
+        }
+#endif
+    }
+
+
+private:
+    RadarHardware _hw;
+    GattServer *_server = nullptr;
+    events::EventQueue *_event_queue = nullptr;
+    events::EventQueue *_sensor_queue = nullptr;
+
+    std::atomic<bool> _running{false};
+    /* sensor thread only, writes of clients are posted to _sensor_queue */
+    int angle = 0;
+    int distance = 0;
+    int distance_mm = 0;
+    //bool timer_started = false;
+    int threshold = 0;
+    Timer timer;
+    SoundCalibrator _calibrator;
+    RangeGate _range_gate = RangeGate::from_max_range(DEFAULT_MAX_RANGE_MM, _calibrator.scale());
+
+    EchoChannel _channels[MAX_SENSORS];
+    PingScheduler<MAX_SENSORS> _ping_scheduler;
+    size_t _slot = 0;           /* slot pinged at the current angle */
+    uint8_t _in_flight = 0;     /* sensors waiting for their echo */
+    bool _angle_echo = false;   /* a sensor saw something at the current angle */
+
+    ServoMotion _servo_motion{SERVO_PROFILE, SERVO_PULSES};
+    Timeout _next_ping;
+    bool _ping_pending = false;
+    std::chrono::microseconds _last_trigger{0};
+
+    SweepScheduler<SWEEP_BINS> _sweep{SWEEP_COARSE_STEP, SWEEP_FINE_MARGIN};
+    DistanceFilter<SWEEP_BINS, FILTER_MAX_WINDOW> _filter{FILTER_DEFAULT_CONFIG};
+    SpscRingBuffer<RadarSample, SAMPLE_BUFFER_SIZE> _samples;
+    std::atomic<bool> _drain_pending{false};
+    uint32_t _reported_overflows = 0;
+
+    SweepFrameBuilder _sweep_frame;
+    uint32_t _sweep_frame_started = 0;
+
+    PolarMap<SWEEP_BINS> _polar_map;
+    BackgroundModel<SWEEP_BINS> _background{BACKGROUND_DEFAULT_CONFIG};
+
+    ObjectSegmenter<SWEEP_BINS, MAX_OBJECTS> _objects{OBJECT_JOIN_MM, SWEEP_COARSE_STEP};
+    uint16_t _objects_sweep = 0;
+    ObjectTracker<MAX_TRACKS> _tracker;
+
+    LinkManager _link;
+    unsigned _subscriptions = 0;
+
+    TraceLog<TRACE_BUFFER_SIZE> _trace;
+    bool _trace_subscribed = false;
+    bool _trace_blocked = false;    /* a batch waits for the stack to free a buffer */
+
+    CycleProfiler _profile;
+    uint32_t _trigger_cycles = 0;
+
+#if MBED_CONF_APP_SERIAL_TRANSPORT
+    SerialLink *_serial = nullptr;
+    SweepFrameBuilder _serial_frame;
+    uint32_t _serial_frame_started = 0;
+#endif
+
+    ReadWriteNotifyIndicateCharacteristic<uint8_t> _angle_char;
+    ReadWriteNotifyIndicateCharacteristic<uint16_t> _distance_char;
+    ReadWriteNotifyIndicateCharacteristic<uint8_t> _running_char;
+    ReadWriteNotifyIndicateCharacteristic<uint8_t> _threshold_char;
+    ReadWriteNotifyIndicateCharacteristic<VariableLength<uint8_t, SweepFrameBuilder::MAX_SIZE>> _sweep_frame_char;
+    ReadWriteNotifyIndicateCharacteristic<DistanceFilterConfig> _filter_char;
+    ReadWriteNotifyIndicateCharacteristic<uint16_t> _max_range_char;
+    ReadWriteNotifyIndicateCharacteristic<ServoTiming> _servo_timing_char;
+    ReadWriteNotifyIndicateCharacteristic<VariableLength<uint8_t, CycleProfiler::MAX_SIZE>> _profile_char;
+    ReadWriteNotifyIndicateCharacteristic<VariableLength<uint8_t, TraceLog<TRACE_BUFFER_SIZE>::MAX_SIZE>> _trace_char;
+    ReadWriteNotifyIndicateCharacteristic<LinkStatus> _link_char;
+    ReadWriteNotifyIndicateCharacteristic<VariableLength<uint8_t, ObjectTracker<MAX_TRACKS>::MAX_SIZE>> _tracks_char;
+    ReadWriteNotifyIndicateCharacteristic<VariableLength<uint8_t, ObjectSegmenter<SWEEP_BINS, MAX_OBJECTS>::MAX_SIZE>> _objects_char;
+    ReadWriteNotifyIndicateCharacteristic<BackgroundConfig> _background_char;
+    ReadWriteNotifyIndicateCharacteristic<VariableLength<uint8_t, PolarMap<SWEEP_BINS>::MAX_SIZE>> _polar_map_char;
+    ReadWriteNotifyIndicateCharacteristic<SampleBufferStats> _buffer_stats_char;
+    ReadWriteNotifyIndicateCharacteristic<SoundCalibration> _calibration_char;
+
+    /* built from the characteristics above, declared after them */
+    GattCharacteristic* _radar_characteristics[radar::protocol::SCHEMA_COUNT];
+    GattService _clock_service;
+};
+
+#endif // RADAR_SERVICE_H
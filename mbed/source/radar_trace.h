@@ -0,0 +1,226 @@
+#ifndef RADAR_TRACE_H
+#define RADAR_TRACE_H
+
+#include "mbed.h"
+#include "platform/Span.h"
+#include "radar_protocol.h"
+#include "spsc_ring_buffer.h"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+/*
+ * Trace levels, the build keeps the calls at or below
+ * MBED_CONF_APP_TRACE_LEVEL (mbed_app.json, trace-level).
+ */
+#define RADAR_TRACE_LEVEL_NONE 0
+#define RADAR_TRACE_LEVEL_ERROR 1
+#define RADAR_TRACE_LEVEL_INFO 2
+#define RADAR_TRACE_LEVEL_DEBUG 3
+
+#ifdef MBED_CONF_APP_TRACE_LEVEL
+#define RADAR_TRACE_LEVEL MBED_CONF_APP_TRACE_LEVEL
+#else
+#define RADAR_TRACE_LEVEL RADAR_TRACE_LEVEL_INFO
+#endif
+
+/**
+ * What a trace record is about, a and b depend on it.
+ */
+enum class TraceEvent : uint8_t {
+    DataSent,               /* a: attribute handle */
+    DataWritten,            /* a: attribute handle, b: length << 24 | first 3 bytes */
+    DataRead,               /* a: attribute handle */
+    UpdatesEnabled,         /* a: attribute handle */
+    UpdatesDisabled,        /* a: attribute handle */
+    ConfirmationReceived,   /* a: attribute handle */
+    AttMtuChanged,          /* a: ATT MTU */
+    SerialRejected,         /* a: characteristic index, b: GattAuthCallbackReply_t */
+    MaxRangeChanged,        /* a: max range in mm, b: retrigger interval in us */
+    CalibrationChanged,     /* a: SoundCalibration::flags, b: speed of sound in mm/s */
+};
+
+inline const char *trace_event_name(TraceEvent event)
+{
+    switch (event) {
+        case TraceEvent::DataSent: return "sent";
+        case TraceEvent::DataWritten: return "written";
+        case TraceEvent::DataRead: return "read";
+        case TraceEvent::UpdatesEnabled: return "updates enabled";
+        case TraceEvent::UpdatesDisabled: return "updates disabled";
+        case TraceEvent::ConfirmationReceived: return "confirmed";
+        case TraceEvent::AttMtuChanged: return "ATT MTU";
+        case TraceEvent::SerialRejected: return "serial write rejected";
+        case TraceEvent::MaxRangeChanged: return "max range";
+        case TraceEvent::CalibrationChanged: return "speed of sound";
+    }
+    return "?";
+}
+
+using radar::protocol::TraceRecord;
+using radar::protocol::TraceListHeader;
+
+/*
+ * Record at a level, compiled out with its arguments above the build level.
+ */
+#if RADAR_TRACE_LEVEL >= RADAR_TRACE_LEVEL_ERROR
+#define RADAR_TRACE_ERROR(log, event, a, b) (log).record(RADAR_TRACE_LEVEL_ERROR, TraceEvent::event, a, b)
+#else
+#define RADAR_TRACE_ERROR(log, event, a, b) do {} while (0)
+#endif
+
+#if RADAR_TRACE_LEVEL >= RADAR_TRACE_LEVEL_INFO
+#define RADAR_TRACE_INFO(log, event, a, b) (log).record(RADAR_TRACE_LEVEL_INFO, TraceEvent::event, a, b)
+#else
+#define RADAR_TRACE_INFO(log, event, a, b) do {} while (0)
+#endif
+
+#if RADAR_TRACE_LEVEL >= RADAR_TRACE_LEVEL_DEBUG
+#define RADAR_TRACE_DEBUG(log, event, a, b) (log).record(RADAR_TRACE_LEVEL_DEBUG, TraceEvent::event, a, b)
+#else
+#define RADAR_TRACE_DEBUG(log, event, a, b) do {} while (0)
+#endif
+
+#if RADAR_TRACE_LEVEL > RADAR_TRACE_LEVEL_NONE
+
+/**
+ * Binary trace kept in RAM instead of printed where it happens.
+ *
+ * Recording copies a fixed size record in a ring buffer, formatting and
+ * output are left to batch() or print(), run when the thread has nothing
+ * better to do.
+ * Records come from the BLE thread only, the drain runs there as well. A
+ * record arriving on a full buffer is dropped and counted.
+ *
+ * @tparam N records kept, a power of two.
+ */
+template<size_t N>
+class TraceLog {
+public:
+    static constexpr bool ENABLED = true;
+    /* largest batch, a full buffer as far as one attribute value holds */
+    static constexpr size_t MAX_RECORDS = N < radar::protocol::TRACE.max_elements() ? N :
+                                          radar::protocol::TRACE.max_elements();
+    static constexpr size_t MAX_SIZE = sizeof(TraceListHeader) + MAX_RECORDS * sizeof(TraceRecord);
+
+    TraceLog()
+    {
+        set_att_mtu(radar::protocol::DEFAULT_ATT_MTU);
+    }
+
+    /**
+     * Time records with timer.
+     */
+    void bind(Timer &timer)
+    {
+        _timer = &timer;
+    }
+
+    void record(uint8_t level, TraceEvent event, uint16_t a, uint32_t b)
+    {
+        uint32_t timestamp_us = _timer ? static_cast<uint32_t>(_timer->elapsed_time().count()) : 0;
+        _records.push(TraceRecord{timestamp_us, static_cast<uint8_t>(event), level, a, b});
+    }
+
+    bool empty() const
+    {
+        return _records.empty();
+    }
+
+    /**
+     * Limit the batches to one notification.
+     */
+    void set_att_mtu(uint16_t att_mtu)
+    {
+        size_t capacity = radar::protocol::notification_payload(att_mtu, sizeof(TraceListHeader)) / sizeof(TraceRecord);
+        _batch_capacity = capacity < MAX_RECORDS ? capacity : MAX_RECORDS;
+    }
+
+    /**
+     * Copy the oldest records into a batch, they stay in the log until
+     * release() so that a batch the stack refuses is sent again.
+     *
+     * @return The batch, valid until the next call.
+     */
+    mbed::Span<const uint8_t> batch()
+    {
+        uint32_t dropped = _records.overflows();
+        _batch.header.dropped = dropped > UINT16_MAX ? UINT16_MAX : static_cast<uint16_t>(dropped);
+        _batch.header.count = 0;
+        while (_batch.header.count < _batch_capacity &&
+               _records.peek(_batch.header.count, _batch.records[_batch.header.count])) {
+            ++_batch.header.count;
+        }
+
+        return mbed::Span<const uint8_t>(
+            reinterpret_cast<const uint8_t *>(&_batch),
+            sizeof(TraceListHeader) + _batch.header.count * sizeof(TraceRecord)
+        );
+    }
+
+    /**
+     * Remove the records of the last batch, once sent.
+     */
+    void release()
+    {
+        _records.discard(_batch.header.count);
+        _batch.header.count = 0;
+    }
+
+    /**
+     * Print the waiting records, one line each.
+     */
+    void print()
+    {
+        TraceRecord record;
+        while (_records.pop(record)) {
+            printf("%10lu us %s %u %lu\r\n", static_cast<unsigned long>(record.timestamp_us),
+                   trace_event_name(static_cast<TraceEvent>(record.event)), record.a,
+                   static_cast<unsigned long>(record.b));
+        }
+    }
+
+private:
+    MBED_PACKED(struct) Batch {
+        TraceListHeader header;
+        TraceRecord records[MAX_RECORDS];
+    };
+
+    SpscRingBuffer<TraceRecord, N> _records;
+    Batch _batch;
+    Timer *_timer = nullptr;
+    size_t _batch_capacity = 1;
+};
+
+#else
+
+/**
+ * Tracing disabled: nothing is stored and every call is empty.
+ */
+template<size_t N>
+class TraceLog {
+public:
+    static constexpr bool ENABLED = false;
+    static constexpr size_t MAX_SIZE = sizeof(TraceListHeader);
+
+    void bind(Timer &timer) {}
+    bool empty() const { return true; }
+    void set_att_mtu(uint16_t att_mtu) {}
+
+    mbed::Span<const uint8_t> batch()
+    {
+        return mbed::Span<const uint8_t>(reinterpret_cast<const uint8_t *>(&_header), sizeof(_header));
+    }
+
+    void release() {}
+
+    void print() {}
+
+private:
+    TraceListHeader _header = {0, 0};
+};
+
+#endif
+
+#endif // RADAR_TRACE_H
@@ -0,0 +1,51 @@
+#ifndef RANGE_GATE_H
+#define RANGE_GATE_H
+
+#include "echo_scale.h"
+#include <chrono>
+#include <cstdint>
+
+/**
+ * Timing of the measurement cycle, derived from the farthest distance of
+ * interest.
+ *
+ * Echoes taking longer than the round trip to max_range_mm are cut short
+ * and reported as out of range, the next ping can then be sent as soon as
+ * the burst and residual echoes have died out instead of waiting for the
+ * full range of the sensor. The servo moves to the next angle meanwhile.
+ */
+struct RangeGate {
+    /* shortest and longest range accepted, the HC-SR04 does not see beyond 4m */
+    static constexpr uint16_t MIN_RANGE_MM = 20;
+    static constexpr uint16_t MAX_RANGE_MM = 4000;
+
+    /* delay between the trigger and the rising edge of the echo, us */
+    static constexpr int64_t BURST_DELAY_US = 500;
+    /* time given to echoes of reflectors beyond the gate to fade, us */
+    static constexpr int64_t RETRIGGER_GUARD_US = 5000;
+
+    uint16_t max_range_mm;
+    std::chrono::microseconds echo_timeout;         /* longest echo accepted */
+    std::chrono::microseconds retrigger_interval;   /* shortest time between two pings */
+
+    /**
+     * Derive the measurement cycle from the farthest distance of interest,
+     * clamped to [MIN_RANGE_MM, MAX_RANGE_MM], for echoes timed by scale.
+     */
+    static constexpr RangeGate from_max_range(uint16_t max_range_mm, const EchoScale &scale)
+    {
+        uint16_t range = max_range_mm < MIN_RANGE_MM ? MIN_RANGE_MM :
+                         max_range_mm > MAX_RANGE_MM ? MAX_RANGE_MM : max_range_mm;
+
+        int64_t echo_timeout_us = scale.round_trip_us(range);
+        int64_t retrigger_us = BURST_DELAY_US + echo_timeout_us + RETRIGGER_GUARD_US;
+
+        return RangeGate{
+            range,
+            std::chrono::microseconds(echo_timeout_us),
+            std::chrono::microseconds(retrigger_us)
+        };
+    }
+};
+
+#endif // RANGE_GATE_H
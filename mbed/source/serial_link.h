@@ -0,0 +1,189 @@
+#ifndef SERIAL_LINK_H
+#define SERIAL_LINK_H
+
+#include "mbed.h"
+#include "platform/Callback.h"
+#include "platform/Span.h"
+#include "events/EventQueue.h"
+#include "serial_protocol.h"
+#include "spsc_ring_buffer.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if MBED_CONF_APP_SERIAL_TRANSPORT && !DEVICE_SERIAL_ASYNCH
+#error "the serial transport needs the asynchronous serial API of the target"
+#endif
+
+using radar::protocol::SerialFrameDecoder;
+using radar::protocol::SerialFrameHeader;
+using radar::protocol::SerialFrameType;
+
+/**
+ * Binary link to a wired host over a UART, framed as in serial_protocol.h.
+ *
+ * Frames are encoded into one of two buffers while the other is sent by an
+ * asynchronous transfer (DMA or interrupts, as the target HAL does it): a
+ * frame sent while the line is idle leaves at once, the ones sent while a
+ * transfer runs are batched into the next transfer. A frame the buffer has
+ * no room for is dropped and counted.
+ *
+ * Received bytes are queued by the RX interrupt and decoded on the event
+ * queue, where the frames are handed to the receive callback.
+ *
+ * send() and the receive callback run on the event queue given to start().
+ */
+class SerialLink : public mbed::SerialBase {
+public:
+    /* holds a frame of the longest value, and dozens of sweep frames */
+    static constexpr size_t TX_BUFFER_SIZE = 1024;
+    /* bytes received between two runs of the event queue */
+    static constexpr size_t RX_BUFFER_SIZE = 256;
+
+    static_assert(radar::protocol::SERIAL_ENCODED_MAX_SIZE <= TX_BUFFER_SIZE, "longest frame does not fit");
+
+    using Receiver = mbed::Callback<void(const SerialFrameHeader &, mbed::Span<const uint8_t>)>;
+
+    SerialLink(PinName tx, PinName rx, int baud) :
+        SerialBase(tx, rx, baud)
+    {
+    }
+
+    /**
+     * Start receiving, frames are sent and received on queue.
+     */
+    void start(events::EventQueue &queue, Receiver receiver)
+    {
+        _queue = &queue;
+        _receiver = receiver;
+        attach(callback(this, &SerialLink::on_rx), RxIrq);
+    }
+
+    /**
+     * Queue a frame.
+     *
+     * @param[in] characteristic index in radar::protocol::SCHEMAS.
+     * @param[in] flags SerialFrameHeader::flags.
+     *
+     * @return false if the frame was dropped.
+     */
+    bool send(SerialFrameType type, uint8_t characteristic, mbed::Span<const uint8_t> value, uint8_t flags = 0)
+    {
+        size_t size = value.size();
+        if (!_queue || size > radar::protocol::MAX_ATTRIBUTE_SIZE ||
+            _fill_size + radar::protocol::serial_frame_encoded_size(size) > TX_BUFFER_SIZE) {
+            ++_dropped;
+            return false;
+        }
+
+        SerialFrameHeader header = {static_cast<uint8_t>(type), flags, characteristic};
+        _fill_size += radar::protocol::encode_serial_frame(
+            header, value.data(), size, _buffers[_fill] + _fill_size
+        );
+        ++_fill_frames;
+        ++_sent;
+        flush();
+        return true;
+    }
+
+    /* frames queued */
+    uint32_t sent() const
+    {
+        return _sent;
+    }
+
+    /* frames lost to a full buffer or a failed transfer */
+    uint32_t dropped() const
+    {
+        return _dropped;
+    }
+
+    const SerialFrameDecoder &decoder() const
+    {
+        return _decoder;
+    }
+
+    /* bytes lost to a full receive buffer */
+    uint32_t rx_overflows() const
+    {
+        return _rx.overflows();
+    }
+
+private:
+    /**
+     * Send the filled buffer if the line is idle, runs on the event queue.
+     */
+    void flush()
+    {
+        if (_busy || !_fill_size) {
+            return;
+        }
+
+        _busy = true;
+        if (write(_buffers[_fill], static_cast<int>(_fill_size), callback(this, &SerialLink::on_tx_done),
+                  SERIAL_EVENT_TX_COMPLETE) != 0) {
+            // Every frame of the buffer is lost with it
+            _busy = false;
+            _dropped += _fill_frames;
+        }
+        _fill ^= 1;
+        _fill_size = 0;
+        _fill_frames = 0;
+    }
+
+    /**
+     * The transfer is over, called in interrupt context.
+     */
+    void on_tx_done(int event)
+    {
+        _busy = false;
+        _queue->call(callback(this, &SerialLink::flush));
+    }
+
+    /**
+     * Bytes arrived, called in interrupt context.
+     */
+    void on_rx()
+    {
+        while (readable()) {
+            // A lost byte breaks its frame, the CRC rejects it
+            _rx.push(static_cast<uint8_t>(_base_getc()));
+        }
+        if (!_rx_pending.exchange(true)) {
+            _queue->call(callback(this, &SerialLink::receive));
+        }
+    }
+
+    /**
+     * Decode the bytes received, runs on the event queue.
+     */
+    void receive()
+    {
+        // Cleared first so that a byte received while decoding posts again
+        _rx_pending = false;
+
+        uint8_t byte;
+        while (_rx.pop(byte)) {
+            if (_decoder.push(byte) && _receiver) {
+                _receiver(_decoder.header(), mbed::Span<const uint8_t>(_decoder.value(), _decoder.size()));
+            }
+        }
+    }
+
+    events::EventQueue *_queue = nullptr;
+    Receiver _receiver;
+
+    uint8_t _buffers[2][TX_BUFFER_SIZE];
+    size_t _fill = 0;           /* buffer frames are encoded into */
+    size_t _fill_size = 0;
+    uint32_t _fill_frames = 0;  /* frames encoded into the fill buffer */
+    std::atomic<bool> _busy{false};
+    uint32_t _sent = 0;
+    uint32_t _dropped = 0;
+
+    SpscRingBuffer<uint8_t, RX_BUFFER_SIZE> _rx;
+    std::atomic<bool> _rx_pending{false};
+    SerialFrameDecoder _decoder;
+};
+
+#endif // SERIAL_LINK_H
@@ -0,0 +1,160 @@
+#ifndef SERVO_MOTION_H
+#define SERVO_MOTION_H
+
+#include "mbed.h"
+#include "radar_protocol.h"
+#include <chrono>
+#include <cstdint>
+
+using radar::protocol::ServoTiming;
+
+/**
+ * Characteristics of a servo model.
+ */
+struct ServoProfile {
+    uint16_t min_pulse_us;      /* pulse width at 0 degree */
+    uint16_t max_pulse_us;      /* pulse width at 180 degrees */
+    uint16_t frame_us;          /* PWM period, a new width applies at the next frame */
+    ServoTiming timing;
+};
+
+/* TowerPro SG90, 0.1s/60deg at 4.8V, calibrated on our heads */
+static constexpr ServoProfile SERVO_SG90 = {400, 2600, 20000, {1667, 10000}};
+/* TowerPro MG90S, 0.1s/60deg at 4.8V, metal gears ring longer */
+static constexpr ServoProfile SERVO_MG90S = {500, 2400, 20000, {1667, 15000}};
+/* TowerPro MG996R, 0.17s/60deg at 4.8V */
+static constexpr ServoProfile SERVO_MG996R = {500, 2500, 20000, {2833, 20000}};
+
+/* Pulse widths are tabulated for each whole degree */
+static constexpr int SERVO_MAX_ANGLE = 180;
+
+/**
+ * Pulse width of each angle of a servo.
+ */
+struct ServoPulseTable {
+    uint16_t pulse_us[SERVO_MAX_ANGLE + 1];
+};
+
+/**
+ * Tabulate the pulse widths of profile, at compile time.
+ */
+constexpr ServoPulseTable make_servo_pulse_table(const ServoProfile &profile)
+{
+    ServoPulseTable table = {};
+    for (int angle = 0; angle <= SERVO_MAX_ANGLE; ++angle) {
+        table.pulse_us[angle] = static_cast<uint16_t>(
+            profile.min_pulse_us + angle * (profile.max_pulse_us - profile.min_pulse_us) / SERVO_MAX_ANGLE
+        );
+    }
+    return table;
+}
+
+/**
+ * Predicts when the head of the servo settles at a commanded angle.
+ *
+ * A new pulse width is latched at the next PWM frame, the head then travels
+ * at the slew rate of the servo and rings for the settle time. Pings can
+ * then be scheduled for the moment the head is still at the right angle,
+ * instead of at a fixed rate that either smears readings or wastes time.
+ *
+ * Pulse widths are looked up in a table the compiler builds for the
+ * profile, commanding the head takes no arithmetic. The slew time per us of
+ * pulse is derived in Q16 when the timing changes, a move then costs a
+ * multiply and a shift, no division.
+ */
+class ServoMotion {
+public:
+    /**
+     * @param[in] pulses make_servo_pulse_table(profile), outlives the object.
+     */
+    ServoMotion(const ServoProfile &profile, const ServoPulseTable &pulses) : _profile(profile), _pulses(pulses)
+    {
+        update_slew();
+    }
+
+    const ServoProfile &profile() const
+    {
+        return _profile;
+    }
+
+    void set_timing(const ServoTiming &timing)
+    {
+        _profile.timing = timing;
+        update_slew();
+    }
+
+    /**
+     * Pulse width that puts the head at angle, clamped to [0, 180].
+     */
+    int pulse_width_us(int angle) const
+    {
+        if (angle < 0) {
+            angle = 0;
+        } else if (angle > SERVO_MAX_ANGLE) {
+            angle = SERVO_MAX_ANGLE;
+        }
+        return _pulses.pulse_us[angle];
+    }
+
+    /**
+     * The PWM started at now with the head at an unknown position.
+     */
+    void start(std::chrono::microseconds now)
+    {
+        _frame_origin = now;
+        _pulse_us = -1;
+    }
+
+    /**
+     * Record a command of the head to angle at now.
+     *
+     * @return The time at which the head is settled at angle.
+     */
+    std::chrono::microseconds move(int angle, std::chrono::microseconds now)
+    {
+        int64_t frame = _profile.frame_us;
+        int64_t elapsed = (now - _frame_origin).count();
+        std::chrono::microseconds latched = _frame_origin + std::chrono::microseconds((elapsed + frame - 1) / frame * frame);
+
+        // Travel is measured on the pulse widths actually output, unknown
+        // starting point: assume the longest travel
+        int pulse_us = pulse_width_us(angle);
+        int travel_us = _pulse_us < 0 ? _profile.max_pulse_us - _profile.min_pulse_us :
+                        (pulse_us > _pulse_us ? pulse_us - _pulse_us : _pulse_us - pulse_us);
+        uint64_t slew_us = (static_cast<uint64_t>(travel_us) * _slew_q16 + (1u << SLEW_FRACTION_BITS) - 1) >>
+                           SLEW_FRACTION_BITS;
+
+        _pulse_us = pulse_us;
+        _settled_at = latched + std::chrono::microseconds(slew_us + _profile.timing.settle_us);
+        return _settled_at;
+    }
+
+    std::chrono::microseconds settled_at() const
+    {
+        return _settled_at;
+    }
+
+private:
+    static constexpr unsigned SLEW_FRACTION_BITS = 16;
+
+    /**
+     * Derive the slew time per us of pulse from the profile, rounded up so
+     * that a move is never predicted short.
+     */
+    void update_slew()
+    {
+        uint64_t range_us = _profile.max_pulse_us - _profile.min_pulse_us;
+        uint64_t full_slew = static_cast<uint64_t>(SERVO_MAX_ANGLE) * _profile.timing.slew_us_per_deg;
+        uint64_t slew_q16 = ((full_slew << SLEW_FRACTION_BITS) + range_us - 1) / range_us;
+        _slew_q16 = slew_q16 > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(slew_q16);
+    }
+
+    ServoProfile _profile;
+    const ServoPulseTable &_pulses;
+    uint32_t _slew_q16 = 0;     /* slew time per us of pulse, Q16 us */
+    std::chrono::microseconds _frame_origin{0};
+    std::chrono::microseconds _settled_at{0};
+    int _pulse_us = -1;
+};
+
+#endif // SERVO_MOTION_H
@@ -0,0 +1,215 @@
+#ifndef SOUND_CALIBRATOR_H
+#define SOUND_CALIBRATOR_H
+
+#include "echo_scale.h"
+#include "radar_protocol.h"
+#include <cstdint>
+
+using radar::protocol::SoundCalibration;
+using radar::protocol::TEMPERATURE_UNKNOWN;
+
+/**
+ * Speed of sound the echoes are converted with.
+ *
+ * The sensors time the round trip of their burst, the distance it stands
+ * for drifts with the air temperature: 0.18% per degree, 10 cm at 3 m
+ * between a frosty site and the 20 degrees assumed at boot. The speed
+ * follows the temperature, measured by a thermometer of the board or
+ * written by a client, and can be measured outright on a reflector at a
+ * known distance. That also takes up the humidity and the latency of the
+ * sensor, the temperature then only corrects the drift since.
+ *
+ * Every change derives a new EchoScale: a sample is converted at the same
+ * cost whatever the calibration.
+ */
+class SoundCalibrator {
+public:
+    /* air temperatures accepted, 0.01 degree Celsius */
+    static constexpr int16_t MIN_TEMPERATURE = -4000;
+    static constexpr int16_t MAX_TEMPERATURE = 8500;
+    /* speed of sound gained per degree, mm/s, linear over the range above */
+    static constexpr int32_t SOUND_SPEED_PER_DEGREE = 606;
+    /* speeds accepted from the reference, those of the range above with 5% to spare */
+    static constexpr uint32_t MIN_SOUND_SPEED_MM_S = 290000;
+    static constexpr uint32_t MAX_SOUND_SPEED_MM_S = 410000;
+
+    /* echoes of the reference averaged by a measurement */
+    static constexpr uint8_t REFERENCE_ECHOES = 8;
+    /* sweeps a measurement waits for them before giving up */
+    static constexpr uint16_t REFERENCE_MAX_SWEEPS = 10;
+    /* largest bearing error of an echo of the reference, degrees */
+    static constexpr int REFERENCE_BEARING_TOLERANCE = 1;
+
+    /**
+     * Speed of sound in air at temperature, 0.01 degree Celsius.
+     */
+    static constexpr uint32_t sound_speed_at(int16_t temperature)
+    {
+        return static_cast<uint32_t>(SOUND_SPEED_20C_MM_S + SOUND_SPEED_PER_DEGREE * (temperature - 2000) / 100);
+    }
+
+    const EchoScale &scale() const
+    {
+        return _scale;
+    }
+
+    uint32_t sound_speed() const
+    {
+        return _sound_speed;
+    }
+
+    /**
+     * The air is at temperature, 0.01 degree Celsius.
+     *
+     * @param[in] measured true if read from the thermometer of the board.
+     */
+    void set_temperature(int16_t temperature, bool measured)
+    {
+        _temperature = temperature;
+        _measured = measured;
+        update();
+    }
+
+    /**
+     * Forget the reference and the temperature written, back to the speed
+     * of sound at 20 degrees unless the board measures the temperature.
+     */
+    void reset()
+    {
+        if (!_measured) {
+            _temperature = TEMPERATURE_UNKNOWN;
+        }
+        _reference_speed = 0;
+        _reference_mm = 0;
+        _pending = false;
+        _failed = false;
+        update();
+    }
+
+    /**
+     * Measure the speed of sound on the echoes of a reflector at
+     * distance_mm, bearing angle, from the sweep after sweep.
+     */
+    void start_reference(uint8_t angle, uint16_t distance_mm, uint16_t sweep)
+    {
+        _reference_angle = angle;
+        _reference_mm = distance_mm;
+        _reference_sweep = sweep;
+        _echoes = 0;
+        _round_trip_sum = 0;
+        _pending = true;
+        _failed = false;
+    }
+
+    /**
+     * true while the reference is measured, echoes are then to be handed to
+     * add_echo().
+     */
+    bool pending() const
+    {
+        return _pending;
+    }
+
+    /**
+     * An echo of round_trip_us measured at bearing during sweep, kept if it
+     * can come from the reference.
+     *
+     * @return true if the measurement is over, the scale is then updated
+     * unless it failed.
+     */
+    bool add_echo(int bearing, uint32_t round_trip_us, bool in_range, uint16_t sweep)
+    {
+        if (static_cast<uint16_t>(sweep - _reference_sweep) > REFERENCE_MAX_SWEEPS) {
+            _pending = false;
+            _failed = true;
+            return true;
+        }
+
+        // Anything closer or farther than the speeds accepted is another reflector
+        uint32_t expected_us = _scale.round_trip_us(_reference_mm);
+        uint32_t error_us = round_trip_us > expected_us ? round_trip_us - expected_us : expected_us - round_trip_us;
+        int bearing_error = bearing > _reference_angle ? bearing - _reference_angle : _reference_angle - bearing;
+        if (!in_range || bearing_error > REFERENCE_BEARING_TOLERANCE || error_us > expected_us / 5) {
+            return false;
+        }
+
+        _round_trip_sum += round_trip_us;
+        if (++_echoes < REFERENCE_ECHOES) {
+            return false;
+        }
+
+        _pending = false;
+        uint32_t speed = static_cast<uint32_t>(
+            UINT64_C(2000000) * _reference_mm * REFERENCE_ECHOES / _round_trip_sum
+        );
+        if (speed < MIN_SOUND_SPEED_MM_S || speed > MAX_SOUND_SPEED_MM_S) {
+            _failed = true;
+            return true;
+        }
+        _reference_speed = speed;
+        _reference_temperature = _temperature;
+        update();
+        return true;
+    }
+
+    /**
+     * Calibration as exchanged with clients.
+     */
+    SoundCalibration state() const
+    {
+        uint8_t flags = 0;
+        if (_temperature != TEMPERATURE_UNKNOWN) {
+            flags |= radar::protocol::CALIBRATION_TEMPERATURE;
+        }
+        if (_measured) {
+            flags |= radar::protocol::CALIBRATION_THERMOMETER;
+        }
+        if (_reference_speed) {
+            flags |= radar::protocol::CALIBRATION_REFERENCE;
+        }
+        if (_pending) {
+            flags |= radar::protocol::CALIBRATION_PENDING;
+        }
+        if (_failed) {
+            flags |= radar::protocol::CALIBRATION_FAILED;
+        }
+        return SoundCalibration{_temperature, _reference_mm, _reference_angle, flags, _sound_speed};
+    }
+
+private:
+    /**
+     * Derive the speed of sound and the scale from the reference and the
+     * temperature.
+     */
+    void update()
+    {
+        if (!_reference_speed) {
+            _sound_speed = _temperature != TEMPERATURE_UNKNOWN ? sound_speed_at(_temperature) : SOUND_SPEED_20C_MM_S;
+        } else if (_temperature != TEMPERATURE_UNKNOWN && _reference_temperature != TEMPERATURE_UNKNOWN) {
+            // Drift since the reference was measured
+            _sound_speed = _reference_speed + sound_speed_at(_temperature) - sound_speed_at(_reference_temperature);
+        } else {
+            _sound_speed = _reference_speed;
+        }
+        _scale = EchoScale::from_sound_speed(_sound_speed);
+    }
+
+    uint32_t _sound_speed = SOUND_SPEED_20C_MM_S;
+    EchoScale _scale = ECHO_SCALE_20C;
+
+    int16_t _temperature = TEMPERATURE_UNKNOWN;
+    bool _measured = false;             /* _temperature read from the thermometer */
+
+    uint32_t _reference_speed = 0;      /* measured on the reference, 0 if none */
+    int16_t _reference_temperature = TEMPERATURE_UNKNOWN;
+
+    uint16_t _reference_mm = 0;
+    uint8_t _reference_angle = 0;
+    uint16_t _reference_sweep = 0;      /* sweep the measurement started at */
+    uint8_t _echoes = 0;
+    uint32_t _round_trip_sum = 0;
+    bool _pending = false;
+    bool _failed = false;
+};
+
+#endif // SOUND_CALIBRATOR_H
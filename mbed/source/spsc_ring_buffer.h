@@ -0,0 +1,145 @@
+#ifndef SPSC_RING_BUFFER_H
+#define SPSC_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Lock-free ring buffer between a single producer and a single consumer
+ * running in different threads.
+ *
+ * push() must only be called by the producer and pop() by the consumer. A
+ * push on a full buffer drops the new item and is counted as an overflow.
+ *
+ * @tparam T type of the items, copied in and out.
+ * @tparam N capacity, a power of two.
+ */
+template<typename T, size_t N>
+class SpscRingBuffer {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+    /**
+     * Append an item, producer side.
+     *
+     * @return false if the buffer is full, the item is then dropped.
+     */
+    bool push(const T &item)
+    {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t tail = _tail.load(std::memory_order_acquire);
+        size_t used = head - tail;
+
+        if (used == N) {
+            _overflows.store(_overflows.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        _items[head & (N - 1)] = item;
+        _head.store(head + 1, std::memory_order_release);
+        _pushed.store(_pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        if (used + 1 > _high_watermark.load(std::memory_order_relaxed)) {
+            _high_watermark.store(used + 1, std::memory_order_relaxed);
+        }
+        return true;
+    }
+
+    /**
+     * Remove the oldest item, consumer side.
+     *
+     * @return false if the buffer is empty.
+     */
+    bool pop(T &item)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        item = _items[tail & (N - 1)];
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Copy the item index places after the oldest without removing it,
+     * consumer side.
+     *
+     * @return false if fewer items are waiting.
+     */
+    bool peek(size_t index, T &item) const
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        if (_head.load(std::memory_order_acquire) - tail <= index) {
+            return false;
+        }
+
+        item = _items[(tail + index) & (N - 1)];
+        return true;
+    }
+
+    /**
+     * Remove the count oldest items, consumer side, at most the ones
+     * waiting.
+     */
+    void discard(size_t count)
+    {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t used = _head.load(std::memory_order_acquire) - tail;
+        _tail.store(tail + (count < used ? count : used), std::memory_order_release);
+    }
+
+    /**
+     * Number of items waiting, exact only from the consumer side.
+     */
+    size_t size() const
+    {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    static constexpr size_t capacity()
+    {
+        return N;
+    }
+
+    /**
+     * Items accepted since construction.
+     */
+    uint32_t pushed() const
+    {
+        return _pushed.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Items dropped because the buffer was full.
+     */
+    uint32_t overflows() const
+    {
+        return _overflows.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Highest number of items waiting at once.
+     */
+    size_t high_watermark() const
+    {
+        return _high_watermark.load(std::memory_order_relaxed);
+    }
+
+private:
+    T _items[N];
+    std::atomic<size_t> _head{0};
+    std::atomic<size_t> _tail{0};
+    std::atomic<uint32_t> _pushed{0};
+    std::atomic<uint32_t> _overflows{0};
+    std::atomic<size_t> _high_watermark{0};
+};
+
+#endif // SPSC_RING_BUFFER_H
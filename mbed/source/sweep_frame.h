@@ -0,0 +1,145 @@
+#ifndef SWEEP_FRAME_H
+#define SWEEP_FRAME_H
+
+#include "mbed.h"
+#include "radar_protocol.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+using radar::protocol::SweepSample;
+using radar::protocol::SweepFrameHeader;
+
+/**
+ * Batches the (angle, distance) samples of the sweep into frames sent with a
+ * single notification.
+ *
+ * A frame is a SweepFrameHeader followed by the samples, little endian. The
+ * number of samples per frame follows the ATT MTU so that a frame always
+ * fits in one notification. All the samples of a frame belong to the sweep
+ * of its header, a new sweep needs a new frame.
+ */
+class SweepFrameBuilder {
+public:
+    static constexpr size_t HEADER_SIZE = sizeof(SweepFrameHeader);
+    static constexpr size_t SAMPLE_SIZE = sizeof(SweepSample);
+    /* fills a notification at an ATT MTU of 247 */
+    static constexpr size_t MAX_SAMPLES = radar::protocol::notification_payload(247, HEADER_SIZE) / SAMPLE_SIZE;
+    static constexpr size_t MAX_SIZE = HEADER_SIZE + MAX_SAMPLES * SAMPLE_SIZE;
+
+    SweepFrameBuilder()
+    {
+        set_att_mtu(radar::protocol::DEFAULT_ATT_MTU);
+    }
+
+    /**
+     * Resize the frames to the MTU negotiated with the client. A frame in
+     * progress larger than the new size is split: bytes() holds its first
+     * samples, next() moves on to the rest.
+     */
+    void set_att_mtu(uint16_t att_mtu)
+    {
+        set_capacity(radar::protocol::notification_payload(att_mtu, HEADER_SIZE) / SAMPLE_SIZE);
+    }
+
+    /**
+     * Resize the frames to a number of samples, up to MAX_SAMPLES, for links
+     * without MTU.
+     */
+    void set_capacity(size_t samples)
+    {
+        if (samples > MAX_SAMPLES) {
+            samples = MAX_SAMPLES;
+        }
+        _capacity = samples ? samples : 1;
+        _frame.header.count = static_cast<uint8_t>(_held < _capacity ? _held : _capacity);
+    }
+
+    /**
+     * Add a sample measured during sweep to the frame in progress, which
+     * must be empty or of the same sweep.
+     *
+     * @return true if the frame is full and must be sent.
+     */
+    bool push(uint8_t angle, uint16_t distance, uint16_t sweep)
+    {
+        if (_held == MAX_SAMPLES) {
+            return true;
+        }
+
+        if (_held == 0) {
+            _frame.header.sweep = sweep;
+        }
+
+        _frame.samples[_held++] = SweepSample{angle, distance};
+        if (_held <= _capacity) {
+            _frame.header.count = static_cast<uint8_t>(_held);
+        }
+        return full();
+    }
+
+    /**
+     * true once every sample held has been sent.
+     */
+    bool empty() const
+    {
+        return _held == 0;
+    }
+
+    bool full() const
+    {
+        return _held >= _capacity;
+    }
+
+    /**
+     * Sweep of the samples of the frame in progress.
+     */
+    uint16_t sweep() const
+    {
+        return _frame.header.sweep;
+    }
+
+    /**
+     * Maximum number of samples in a frame at the current MTU.
+     */
+    size_t capacity() const
+    {
+        return _capacity;
+    }
+
+    /**
+     * Encoded frame in progress.
+     */
+    mbed::Span<const uint8_t> bytes() const
+    {
+        return mbed::Span<const uint8_t>(
+            reinterpret_cast<const uint8_t *>(&_frame),
+            HEADER_SIZE + _frame.header.count * SAMPLE_SIZE
+        );
+    }
+
+    /**
+     * Start the next frame once the current one has been sent, with the
+     * samples left over by a split if any.
+     */
+    void next()
+    {
+        size_t sent = _frame.header.count;
+        _held -= sent;
+        memmove(_frame.samples, _frame.samples + sent, _held * SAMPLE_SIZE);
+        ++_frame.header.sequence;
+        _frame.header.count = static_cast<uint8_t>(_held < _capacity ? _held : _capacity);
+    }
+
+private:
+    MBED_PACKED(struct) Frame {
+        SweepFrameHeader header;
+        SweepSample samples[MAX_SAMPLES];
+    };
+
+    Frame _frame = {};
+    size_t _held = 0;           /* samples pushed and not sent, header.count of them in the frame */
+    size_t _capacity = 1;
+};
+
+#endif // SWEEP_FRAME_H
@@ -0,0 +1,141 @@
+#ifndef SWEEP_SCHEDULER_H
+#define SWEEP_SCHEDULER_H
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Chooses the angle of the next ping from what the previous sweep saw.
+ *
+ * The head goes back and forth between 0 and a span of at most Bins - 1,
+ * shorter when several sensors share the head. Sectors where the
+ * previous sweep got no echo are crossed with coarse steps, while bins within
+ * a margin of a previous echo, or right after an echo of the current sweep,
+ * are visited one by one. A quiet scene is then swept several times faster
+ * and the revisit time of the objects goes down accordingly.
+ *
+ * The first sweep visits every bin.
+ *
+ * @tparam Bins number of angle bins, one per degree.
+ */
+template<size_t Bins>
+class SweepScheduler {
+    static_assert(Bins >= 2 && Bins <= 256, "angles are stored on 8 bits");
+
+public:
+    /**
+     * @param[in] coarse_step Step in degrees through empty sectors, 1 makes
+     * the sweep uniform.
+     * @param[in] fine_margin Bins around an echo visited one by one.
+     */
+    SweepScheduler(uint8_t coarse_step, uint8_t fine_margin) :
+        _coarse_step(coarse_step ? coarse_step : 1),
+        _fine_margin(fine_margin)
+    {
+        _previous.set();
+    }
+
+    /**
+     * Limit the travel of the head to [0, span], 0 keeps it still.
+     */
+    void set_span(uint8_t span)
+    {
+        _span = span < Bins - 1 ? span : Bins - 1;
+    }
+
+    uint8_t span() const
+    {
+        return _span;
+    }
+
+    /**
+     * Record the outcome of the ping at angle and get the angle of the next
+     * one.
+     *
+     * @param[in] angle Angle of the ping, in [0, span()].
+     * @param[in] echo true if something reflected within range.
+     */
+    uint8_t next(uint8_t angle, bool echo)
+    {
+        if (echo) {
+            _current.set(angle);
+        }
+        ++_pings;
+
+        const int last = _span;
+        int step = (echo || near_echo(angle)) ? 1 : _coarse_step;
+
+        // Never jump over a sector that needs the fine steps
+        int target = angle;
+        for (int i = 0; i < step; ++i) {
+            target += _ascending ? 1 : -1;
+            if (target <= 0 || target >= last || near_echo(target)) {
+                break;
+            }
+        }
+
+        if (target <= 0 || target >= last) {
+            target = target <= 0 ? 0 : last;
+            end_sweep();
+        }
+
+        return static_cast<uint8_t>(target);
+    }
+
+    bool ascending() const
+    {
+        return _ascending;
+    }
+
+    /**
+     * Sweeps completed, wraps around.
+     */
+    uint16_t sweeps() const
+    {
+        return _sweeps;
+    }
+
+    /**
+     * Pings taken during the last complete sweep.
+     */
+    size_t last_sweep_pings() const
+    {
+        return _last_sweep_pings;
+    }
+
+private:
+    bool near_echo(int angle) const
+    {
+        int from = angle - _fine_margin;
+        int to = angle + _fine_margin;
+        for (int i = from < 0 ? 0 : from; i <= to && i < static_cast<int>(Bins); ++i) {
+            if (_previous.test(i)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void end_sweep()
+    {
+        _ascending = !_ascending;
+        ++_sweeps;
+        _last_sweep_pings = _pings;
+        _pings = 0;
+        _previous = _current;
+        _current.reset();
+    }
+
+    uint8_t _coarse_step;
+    uint8_t _fine_margin;
+    uint8_t _span = Bins - 1;
+    bool _ascending = true;
+    uint16_t _sweeps = 0;
+    size_t _pings = 0;
+    size_t _last_sweep_pings = 0;
+    std::bitset<Bins> _previous;
+    std::bitset<Bins> _current;
+};
+
+#endif // SWEEP_SCHEDULER_H